@@ -0,0 +1,124 @@
+#include "arena.h"
+#include <stdlib.h>
+#include <string.h>
+
+// 分配对齐字节数
+#define ARENA_ALIGNMENT 16
+
+// 内存块头部占用的字节数（按对齐要求取整）
+#define ARENA_HEADER_SIZE ((sizeof(ArenaChunk) + ARENA_ALIGNMENT - 1) & ~(size_t)(ARENA_ALIGNMENT - 1))
+
+// 获取内存块中可分配内存的起始地址
+static unsigned char* chunkData(ArenaChunk* chunk) {
+    return (unsigned char*)chunk + ARENA_HEADER_SIZE;
+}
+
+// 分配一个新的内存块并放到链表头部
+static ArenaChunk* newChunk(Arena* arena, size_t capacity) {
+    ArenaChunk* chunk = (ArenaChunk*)malloc(ARENA_HEADER_SIZE + capacity);
+    if (!chunk) {
+        return NULL;
+    }
+    chunk->previous = arena->current;
+    chunk->capacity = capacity;
+    chunk->used = 0;
+    arena->current = chunk;
+    arena->totalCapacity += capacity;
+    arena->chunkCount++;
+    return chunk;
+}
+
+// 释放所有内存块
+static void freeChunks(Arena* arena) {
+    ArenaChunk* chunk = arena->current;
+    while (chunk) {
+        ArenaChunk* previous = chunk->previous;
+        free(chunk);
+        chunk = previous;
+    }
+    arena->current = NULL;
+    arena->totalCapacity = 0;
+}
+
+// 初始化内存池
+int initArena(Arena* arena, size_t initialSize) {
+    arena->current = NULL;
+    arena->totalCapacity = 0;
+    arena->allocationCount = 0;
+    arena->chunkCount = 0;
+    return newChunk(arena, initialSize > 0 ? initialSize : ARENA_ALIGNMENT) != NULL;
+}
+
+// 释放内存池的所有内存
+void freeArena(Arena* arena) {
+    freeChunks(arena);
+}
+
+// 重置内存池
+void resetArena(Arena* arena) {
+    if (!arena->current) {
+        return;
+    }
+
+    // 只有一块内存时直接清空
+    if (!arena->current->previous) {
+        arena->current->used = 0;
+        return;
+    }
+
+    // 有多块内存时合并为一块，容量为之前的总和
+    size_t capacity = arena->totalCapacity;
+    freeChunks(arena);
+    newChunk(arena, capacity);
+}
+
+// 分配内存
+void* arenaAlloc(Arena* arena, size_t size) {
+    size = (size + ARENA_ALIGNMENT - 1) & ~(size_t)(ARENA_ALIGNMENT - 1);
+    arena->allocationCount++;
+
+    ArenaChunk* chunk = arena->current;
+    if (!chunk || chunk->capacity - chunk->used < size) {
+        // 当前块不够用时新分配一块，容量至少翻倍
+        size_t capacity = chunk ? chunk->capacity * 2 : ARENA_ALIGNMENT;
+        if (capacity < size) {
+            capacity = size;
+        }
+        chunk = newChunk(arena, capacity);
+        if (!chunk) {
+            return NULL;
+        }
+    }
+
+    void* memory = chunkData(chunk) + chunk->used;
+    chunk->used += size;
+    return memory;
+}
+
+// 分配内存并清零
+void* arenaCalloc(Arena* arena, size_t count, size_t size) {
+    void* memory = arenaAlloc(arena, count * size);
+    if (memory) {
+        memset(memory, 0, count * size);
+    }
+    return memory;
+}
+
+// 扩大内存
+void* arenaGrow(Arena* arena, void* old, size_t oldSize, size_t newSize) {
+    // 旧内存恰好是当前块最后一次分配的内存且剩余空间足够时，原地扩大
+    ArenaChunk* chunk = arena->current;
+    size_t alignedOld = (oldSize + ARENA_ALIGNMENT - 1) & ~(size_t)(ARENA_ALIGNMENT - 1);
+    size_t alignedNew = (newSize + ARENA_ALIGNMENT - 1) & ~(size_t)(ARENA_ALIGNMENT - 1);
+    if (old && chunk && (unsigned char*)old + alignedOld == chunkData(chunk) + chunk->used &&
+        chunk->used - alignedOld + alignedNew <= chunk->capacity) {
+        chunk->used = chunk->used - alignedOld + alignedNew;
+        return old;
+    }
+
+    void* memory = arenaAlloc(arena, newSize);
+    if (memory && old) {
+        memcpy(memory, old, oldSize < newSize ? oldSize : newSize);
+    }
+    return memory;
+}
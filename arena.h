@@ -0,0 +1,42 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>
+
+// 内存块链表节点（块头之后紧跟可分配的内存）
+typedef struct ArenaChunk {
+    struct ArenaChunk* previous;    // 之前分配的内存块
+    size_t capacity;                // 可分配的字节数
+    size_t used;                    // 已分配的字节数
+} ArenaChunk;
+
+// 线性分配器（内存池）
+// 一场战斗的所有内存（装备、格子、空间索引、位图、临时缓冲区）都从同一个内存池中分配，
+// 不单独释放，战斗结束后整体重置。重置时如果内存池曾经扩容，会把所有内存块合并为一块，
+// 因此之后同样规模的战斗只在一块内存中线性分配，不再调用malloc
+typedef struct {
+    ArenaChunk* current;    // 当前内存块
+    size_t totalCapacity;   // 所有内存块的容量之和
+    unsigned long long allocationCount;   // 累计分配次数（重置时不清零，性能测试用）
+    unsigned long long chunkCount;        // 累计调用malloc分配内存块的次数（重置时不清零）
+} Arena;
+
+// 初始化内存池，initialSize为第一块内存的大小，成功返回1，内存分配失败返回0
+int initArena(Arena* arena, size_t initialSize);
+
+// 释放内存池的所有内存
+void freeArena(Arena* arena);
+
+// 重置内存池，之前分配的内存全部失效
+void resetArena(Arena* arena);
+
+// 分配size字节的内存（按16字节对齐，内容未初始化），内存不足时返回NULL
+void* arenaAlloc(Arena* arena, size_t size);
+
+// 分配count个size字节的元素并清零，内存不足时返回NULL
+void* arenaCalloc(Arena* arena, size_t count, size_t size);
+
+// 把oldSize字节的旧内存扩大到newSize字节（内容被复制，旧内存直到重置前不会被复用）
+void* arenaGrow(Arena* arena, void* old, size_t oldSize, size_t newSize);
+
+#endif // ARENA_H
@@ -0,0 +1,355 @@
+#include <limits.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "battlefield.h"
+#include "equipment.h"
+#include "simulation.h"
+#include "montecarlo.h"
+#include "scenario.h"
+#include "distance.h"
+#include "platform.h"
+
+// 无界面批量对抗模式
+// 从想定文件（或部署文件）加载战场和双方装备，在多个线程上并行运行多场战斗，不渲染、不暂停，只输出统计结果
+
+#define DEFAULT_RUNS 1
+#define DEFAULT_MAX_TICKS 10000
+
+// 压力测试：每方的装备数从STRESS_MIN_UNITS开始加倍，每个规模模拟STRESS_TICKS步
+#define STRESS_MIN_UNITS 1000
+#define STRESS_TICKS 50
+// 压力测试想定中每方半场的格子数与装备数之比（装备密度保持为1/4）
+#define STRESS_CELLS_PER_UNIT 4
+
+// 获取当前时间（秒）
+static double getTimeSeconds(void) {
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// 显示用法说明
+static void printUsage(const char* program) {
+    printf("用法: %s <想定文件> [次数] [选项]\n", program);
+    printf("      %s --stress N [选项]\n", program);
+    printf("想定文件格式见 scenario.h，部署文件 (team,typeId,x,y,dirX,dirY) 也是合法的想定文件\n");
+    printf("选项:\n");
+    printf("  --max-ticks N   单场战斗最大步数，超过则记为超时 (默认 %d)\n", DEFAULT_MAX_TICKS);
+    printf("  --seed S        主随机数种子，第i场战斗使用随机数流i (默认使用当前时间)\n");
+    printf("  --threads N     工作线程数 (默认使用全部 %d 个CPU核心)\n", platformGetCpuCount());
+    printf("  --types F       装备类型文件 (默认 equipment_types.txt)\n");
+    printf("  --interactions F 装备交互文件 (默认 equipment_interactions.txt)\n");
+    printf("  --legacy-distance 使用旧版本的取整距离规则，便于与旧版本的结果逐位对比\n");
+    printf("  --record DIR    把每场战斗的事件记录写入目录DIR (第i场为 DIR/battle_i.bfev)\n");
+    printf("  --keyframe-interval N 事件记录中每N步写一个关键帧，0表示不写 (默认 %d)\n", DEFAULT_KEYFRAME_INTERVAL);
+    printf("  --branch-at T   先模拟一次共同的前T步，每场战斗从第T步的快照开始，只有之后的随机数流不同\n");
+    printf("  --settings F    设置文件，想定中没有设置的项取自该文件 (默认 %s，不存在时使用内置默认值)\n",
+           DEFAULT_SETTINGS_FILE);
+    printf("  --two-phase     两阶段模式：每步先并行计算所有装备的意图，再按固定规则统一结算，双方没有先手优势\n");
+    printf("                  只运行一场战斗（或压力测试）时意图阶段使用--threads个线程，结果与线程数无关\n");
+    printf("  --target-cache on|off|verify 攻击目标缓存：on使用缓存 (默认)，off每次完整查找，\n");
+    printf("                  verify同时进行两种查找并报告结果不同的次数 (有不同时返回1)\n");
+    printf("  --stats F       每场战斗收集热点路径统计，结束时以一行JSON写入文件F (需要用 make STATS=1 编译)\n");
+    printf("  --stats-interval N 每隔N步也写一行当时的累计统计\n");
+    printf("  --stress N      压力测试：每方装备数从%d加倍到N，装备密度不变，报告每步耗时\n", STRESS_MIN_UNITS);
+}
+
+// 生成压力测试想定：装备密度不变，每方半场的格子数约为装备数的STRESS_CELLS_PER_UNIT倍
+static int makeStressScenario(Scenario* scenario, int unitsPerSide, Rng* rng) {
+    long long cells = (long long)unitsPerSide * STRESS_CELLS_PER_UNIT;
+    int height = (int)sqrt((double)cells);
+    long long halfWidth = cells / height;
+    if (2 * halfWidth > MAX_DISTANCE_COORDINATE) {
+        return 0;
+    }
+    return generateScenario(scenario, 2 * (int)halfWidth, height, unitsPerSide, rng);
+}
+
+// 压力测试：装备密度不变，每方装备数逐级加倍，测量每步的耗时
+// 每步的耗时应当与装备数大致成正比，即每个装备每步的耗时基本不变
+static int runStressTest(int maxUnitsPerSide, uint64_t seed, TickMode tickMode, ThreadPool* tickPool,
+                         TargetCacheMode targetCacheMode) {
+    Rng rng;
+    rngSeed(&rng, seed, 0);
+    printf("压力测试 (种子: %llu, 每个规模 %d 步, %s)\n", (unsigned long long)seed, STRESS_TICKS,
+           tickMode == TICK_TWO_PHASE ? "两阶段模式" : "顺序模式");
+
+    int units = maxUnitsPerSide < STRESS_MIN_UNITS ? maxUnitsPerSide : STRESS_MIN_UNITS;
+    for (; units <= maxUnitsPerSide; units *= 2) {
+        Scenario scenario;
+        if (!makeStressScenario(&scenario, units, &rng)) {
+            printf("无法生成每方 %d 个装备的想定（需要可以移动和攻击的装备类型）\n", units);
+            return 0;
+        }
+
+        Battlefield battlefield;
+        if (!initBattlefieldWithCapacity(&battlefield, scenario.width, scenario.height, getScenarioCapacity(&scenario),
+                                         NULL)) {
+            printf("内存分配失败（每方 %d 个装备，战场 %dx%d）\n", units, scenario.width, scenario.height);
+            freeScenario(&scenario);
+            return 0;
+        }
+        battlefield.headless = 1;
+        battlefield.tickMode = tickMode;
+        battlefield.threadPool = tickPool;
+        battlefield.targetCacheMode = targetCacheMode;
+        applyScenario(&battlefield, &scenario);
+        rngSeed(&battlefield.rng, seed, 1);
+
+        double startTime = getTimeSeconds();
+        int ticks = 0;
+        while (ticks < STRESS_TICKS) {
+            ticks++;
+            if (simulateStep(&battlefield)) {
+                break;
+            }
+        }
+        double elapsed = getTimeSeconds() - startTime;
+
+        double msPerTick = elapsed * 1e3 / ticks;
+        printf("每方 %7d 个装备 (战场 %dx%d): %9.3f 毫秒/步, %6.1f 纳秒/(装备*步)\n", units,
+               scenario.width, scenario.height, msPerTick, msPerTick * 1e6 / (2.0 * units));
+
+        freeBattlefield(&battlefield);
+        freeScenario(&scenario);
+        if (units > INT_MAX / 2) {
+            break;
+        }
+    }
+    return 1;
+}
+
+int main(int argc, char* argv[]) {
+    const char* scenarioFile = NULL;
+    const char* typesFile = "equipment_types.txt";
+    const char* interactionsFile = "equipment_interactions.txt";
+    int runs = DEFAULT_RUNS;
+    int maxTicks = DEFAULT_MAX_TICKS;
+    int threads = 0;
+    unsigned long long seed = (unsigned long long)time(NULL);
+    const char* recordDirectory = NULL;
+    int keyframeInterval = DEFAULT_KEYFRAME_INTERVAL;
+    int branchTick = 0;
+    const char* settingsFile = NULL;
+    int stressUnits = 0;
+    TickMode tickMode = TICK_SEQUENTIAL;
+    const char* statsFileName = NULL;
+    int statsInterval = 0;
+    TargetCacheMode targetCacheMode = TARGET_CACHE_ON;
+
+    // 解析命令行参数
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--max-ticks") == 0 && i + 1 < argc) {
+            maxTicks = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            seed = strtoull(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            threads = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--types") == 0 && i + 1 < argc) {
+            typesFile = argv[++i];
+        } else if (strcmp(argv[i], "--interactions") == 0 && i + 1 < argc) {
+            interactionsFile = argv[++i];
+        } else if (strcmp(argv[i], "--legacy-distance") == 0) {
+            g_distanceMode = DISTANCE_TRUNCATED;
+        } else if (strcmp(argv[i], "--record") == 0 && i + 1 < argc) {
+            recordDirectory = argv[++i];
+        } else if (strcmp(argv[i], "--keyframe-interval") == 0 && i + 1 < argc) {
+            keyframeInterval = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--branch-at") == 0 && i + 1 < argc) {
+            branchTick = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--settings") == 0 && i + 1 < argc) {
+            settingsFile = argv[++i];
+        } else if (strcmp(argv[i], "--stats") == 0 && i + 1 < argc) {
+            statsFileName = argv[++i];
+        } else if (strcmp(argv[i], "--stats-interval") == 0 && i + 1 < argc) {
+            statsInterval = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--two-phase") == 0) {
+            tickMode = TICK_TWO_PHASE;
+        } else if (strcmp(argv[i], "--target-cache") == 0 && i + 1 < argc) {
+            const char* mode = argv[++i];
+            if (strcmp(mode, "on") == 0) {
+                targetCacheMode = TARGET_CACHE_ON;
+            } else if (strcmp(mode, "off") == 0) {
+                targetCacheMode = TARGET_CACHE_OFF;
+            } else if (strcmp(mode, "verify") == 0) {
+                targetCacheMode = TARGET_CACHE_VERIFY;
+            } else {
+                printUsage(argv[0]);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--stress") == 0 && i + 1 < argc) {
+            stressUnits = atoi(argv[++i]);
+            if (stressUnits <= 0) {
+                printUsage(argv[0]);
+                return 1;
+            }
+        } else if (argv[i][0] == '-') {
+            printUsage(argv[0]);
+            return 1;
+        } else if (!scenarioFile) {
+            scenarioFile = argv[i];
+        } else {
+            runs = atoi(argv[i]);
+        }
+    }
+
+    if ((!scenarioFile && stressUnits == 0) || runs <= 0 || maxTicks <= 0 || branchTick < 0) {
+        printUsage(argv[0]);
+        return 1;
+    }
+    if (statsFileName && !BATTLE_STATS_ENABLED) {
+        printf("本程序编译时没有启用热点路径统计，请用 make STATS=1 重新编译\n");
+        return 1;
+    }
+
+    // 装备数据只加载一次，所有战斗共享
+    if (!loadEquipmentTypes(typesFile) || !loadEquipmentInteractions(interactionsFile)) {
+        freeEquipmentTypes();
+        return 1;
+    }
+
+    // 两阶段模式下只有一场战斗（或压力测试）时，把线程用在单场战斗的意图阶段上
+    ThreadPool tickPool;
+    ThreadPool* tickPoolPointer = NULL;
+
+    if (stressUnits > 0) {
+        if (tickMode == TICK_TWO_PHASE && initThreadPool(&tickPool, threads)) {
+            tickPoolPointer = &tickPool;
+        }
+        int ok = runStressTest(stressUnits, seed, tickMode, tickPoolPointer, targetCacheMode);
+        if (tickPoolPointer) {
+            freeThreadPool(tickPoolPointer);
+        }
+        freeEquipmentTypes();
+        return ok ? 0 : 1;
+    }
+
+    if (settingsFile ? !loadBattlefieldConfig(settingsFile) : !loadDefaultBattlefieldConfig()) {
+        freeEquipmentTypes();
+        return 1;
+    }
+
+    // 想定文件只解析一次，所有战斗共享
+    Scenario scenario;
+    if (!parseScenario(&scenario, scenarioFile)) {
+        freeEquipmentTypes();
+        return 1;
+    }
+
+    // 先在一个战场上部署一次，报告无法部署的装备（每场战斗都会同样跳过它们）
+    Battlefield probe;
+    if (!initBattlefieldWithCapacity(&probe, scenario.width, scenario.height, getScenarioCapacity(&scenario), NULL)) {
+        printf("内存分配失败（战场 %dx%d）\n", scenario.width, scenario.height);
+        freeScenario(&scenario);
+        freeEquipmentTypes();
+        return 1;
+    }
+    int rejected = applyScenario(&probe, &scenario);
+    freeBattlefield(&probe);
+    if (rejected > 0) {
+        printf("想定中有 %d 个装备无法部署，已跳过\n", rejected);
+    }
+
+    if (tickMode == TICK_TWO_PHASE && runs == 1 && initThreadPool(&tickPool, threads)) {
+        tickPoolPointer = &tickPool;
+    }
+
+    MonteCarloConfig config;
+    config.scenario = &scenario;
+    config.battles = runs;
+    config.maxTicks = maxTicks;
+    config.threads = threads;
+    config.masterSeed = seed;
+    config.recordDirectory = recordDirectory;
+    config.keyframeInterval = keyframeInterval;
+    config.branchPoint = NULL;
+    config.branchTick = 0;
+    config.tickMode = tickMode;
+    config.tickPool = tickPoolPointer;
+    config.typeCosts = NULL;
+    config.typeCostCount = 0;
+    config.statsFile = NULL;
+    config.statsInterval = statsInterval;
+    long long targetCacheMismatches = 0;
+    config.targetCacheMode = targetCacheMode;
+    config.targetCacheMismatches = targetCacheMode == TARGET_CACHE_VERIFY ? &targetCacheMismatches : NULL;
+
+    // 共同前缀只模拟一次，所有战斗从它的快照分支
+    BattlefieldSnapshot branchPoint;
+    initBattlefieldSnapshot(&branchPoint);
+    if (branchTick > 0) {
+        if (!runBattlePrefix(&config, branchTick, &branchPoint)) {
+            printf("无法生成第 %d 步的分支点（战斗在此之前已经结束或内存分配失败）\n", branchTick);
+            if (tickPoolPointer) {
+                freeThreadPool(tickPoolPointer);
+            }
+            freeScenario(&scenario);
+            freeEquipmentTypes();
+            return 1;
+        }
+        config.branchPoint = &branchPoint;
+        config.branchTick = branchTick;
+    }
+
+    // 统计文件在分支点之后打开，共同前缀不计入每场战斗的统计
+    FILE* statsFile = NULL;
+    if (statsFileName) {
+        statsFile = fopen(statsFileName, "w");
+        if (!statsFile) {
+            printf("无法写入统计文件: %s\n", statsFileName);
+        }
+        config.statsFile = statsFile;
+    }
+
+    MonteCarloResult result;
+    double startTime = getTimeSeconds();
+    int ok = runMonteCarlo(&config, &result);
+    int statsWritten = statsFile != NULL;
+    if (statsFile) {
+        fclose(statsFile);
+    }
+    if (!ok) {
+        printf("内存分配失败\n");
+        if (tickPoolPointer) {
+            freeThreadPool(tickPoolPointer);
+        }
+        freeBattlefieldSnapshot(&branchPoint);
+        freeScenario(&scenario);
+        freeEquipmentTypes();
+        return 1;
+    }
+    double elapsed = getTimeSeconds() - startTime;
+
+    printf("想定文件: %s (战场 %dx%d)\n", scenarioFile, scenario.width, scenario.height);
+    printf("战斗次数: %lld (种子: %llu%s)\n", result.battles, seed, tickMode == TICK_TWO_PHASE ? ", 两阶段模式" : "");
+    if (branchTick > 0) {
+        printf("分支点:   第 %d 步\n", branchTick);
+    }
+    printf("红方获胜: %lld (%.2f%%)\n", result.redWins, 100.0 * result.redWins / runs);
+    printf("蓝方获胜: %lld (%.2f%%)\n", result.blueWins, 100.0 * result.blueWins / runs);
+    printf("平局:     %lld (%.2f%%)\n", result.draws, 100.0 * result.draws / runs);
+    printf("超时:     %lld (%.2f%%)\n", result.timeouts, 100.0 * result.timeouts / runs);
+    printf("平均步数: %.1f (最短 %d, 最长 %d)\n", (double)result.totalTicks / runs,
+           result.minTicks, result.maxTicks);
+    printf("耗时: %.3f 秒 (%.1f 场/秒)\n", elapsed, elapsed > 0 ? runs / elapsed : 0.0);
+    if (recordDirectory) {
+        printf("事件记录: %s (%lld 场写入失败)\n", recordDirectory, result.recordFailures);
+    }
+    if (statsWritten) {
+        printf("热点路径统计: %s\n", statsFileName);
+    }
+    if (targetCacheMode == TARGET_CACHE_VERIFY) {
+        printf("目标缓存校验: %lld 次结果不同\n", targetCacheMismatches);
+    }
+
+    if (tickPoolPointer) {
+        freeThreadPool(tickPoolPointer);
+    }
+    freeBattlefieldSnapshot(&branchPoint);
+    freeScenario(&scenario);
+    freeEquipmentTypes();
+    return targetCacheMismatches > 0 ? 1 : 0;
+}
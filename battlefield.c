@@ -1,71 +1,154 @@
 #include "battlefield.h"
 #include <stdio.h>
 #include <stdlib.h>
-#include <conio.h>
+#include <string.h>
+#include "distance.h"
+#include "platform.h"
+
+// 单元存储的初始容量（不够时自动扩大）
+#define INITIAL_UNIT_CAPACITY 64
+
+// 栅栏的装备类型ID（占用位图和通视检查单独记录栅栏）
+#define FENCE_TYPE_ID 7
+
+// 战场设置
+BattlefieldConfig g_battlefieldConfig = {
+    DEFAULT_BATTLEFIELD_WIDTH, DEFAULT_BATTLEFIELD_HEIGHT, DEFAULT_BUDGET, DEFAULT_BUDGET, 0
+};
+
+// 估算一场战斗需要的内存，用于确定内存池第一块内存的大小
+static size_t estimateBattlefieldMemory(int width, int height, int unitCapacity) {
+    size_t cells = (size_t)width * height * sizeof(Cell);
+    size_t blocks = 2 * (size_t)((width >> CELL_BLOCK_SHIFT) + 1) * ((height >> CELL_BLOCK_SHIFT) + 1) *
+                    sizeof(unsigned long long);
+    size_t bitboards = 4 * (size_t)((width + 63) / 64) * height * sizeof(uint64_t);
+    size_t units = 2 * (size_t)unitCapacity * (sizeof(Equipment) + 8 * sizeof(int));
+    size_t buckets = 2 * (size_t)((width + SPATIAL_BUCKET_SIZE - 1) / SPATIAL_BUCKET_SIZE) *
+                     ((height + SPATIAL_BUCKET_SIZE - 1) / SPATIAL_BUCKET_SIZE) * sizeof(SpatialBucket);
+    // 为桶的扩容和对齐留出余量
+    return cells + blocks + bitboards + units + buckets + 16 * 1024;
+}
 
-#define MAX_EQUIPMENTS_PER_TEAM 50
-#define DEFAULT_BUDGET 10000
+// 初始化战场
+int initBattlefield(Battlefield* battlefield, int width, int height) {
+    return initBattlefieldWithCapacity(battlefield, width, height, INITIAL_UNIT_CAPACITY, NULL);
+}
 
-// 函数声明
-void displayEquipmentInfo(Equipment* equipment);
+// 在指定的内存池中初始化战场
+int initBattlefieldInArena(Battlefield* battlefield, int width, int height, Arena* arena) {
+    return initBattlefieldWithCapacity(battlefield, width, height, INITIAL_UNIT_CAPACITY, arena);
+}
+
+// 初始化战场，每方的单元存储预留unitCapacity个装备的容量
+int initBattlefieldWithCapacity(Battlefield* battlefield, int width, int height, int unitCapacity, Arena* arena) {
+    // 限制战场尺寸，保证任意两点的平方距离不超出int范围
+    if (width > MAX_DISTANCE_COORDINATE) width = MAX_DISTANCE_COORDINATE;
+    if (height > MAX_DISTANCE_COORDINATE) height = MAX_DISTANCE_COORDINATE;
+    if (unitCapacity < INITIAL_UNIT_CAPACITY) unitCapacity = INITIAL_UNIT_CAPACITY;
+
+    // 没有提供内存池时使用战场自己的内存池（按限制后的尺寸估算内存）
+    int ownsArena = 0;
+    if (!arena) {
+        arena = (Arena*)malloc(sizeof(Arena));
+        if (arena && !initArena(arena, estimateBattlefieldMemory(width, height, unitCapacity))) {
+            free(arena);
+            arena = NULL;
+        }
+        ownsArena = 1;
+    }
 
-// 初始化战场
-void initBattlefield(Battlefield* battlefield, int width, int height) {
     battlefield->width = width;
     battlefield->height = height;
-    battlefield->redCount = 0;
-    battlefield->blueCount = 0;
-    battlefield->maxEquipments = MAX_EQUIPMENTS_PER_TEAM;
-    battlefield->redBudget = DEFAULT_BUDGET;
-    battlefield->blueBudget = DEFAULT_BUDGET;
-    battlefield->redRemainingBudget = DEFAULT_BUDGET;
-    battlefield->blueRemainingBudget = DEFAULT_BUDGET;
-
-    // 分配二维格子数组内存
-    battlefield->cells = (Cell**)malloc(height * sizeof(Cell*));
-    for (int i = 0; i < height; i++) {
-        battlefield->cells[i] = (Cell*)malloc(width * sizeof(Cell));
-        for (int j = 0; j < width; j++) {
-            battlefield->cells[i][j].status = CELL_EMPTY;
-            battlefield->cells[i][j].equipment = NULL;
-        }
+    battlefield->maxEquipments = g_battlefieldConfig.maxEquipments;
+    battlefield->redBudget = g_battlefieldConfig.redBudget;
+    battlefield->blueBudget = g_battlefieldConfig.blueBudget;
+    battlefield->redRemainingBudget = g_battlefieldConfig.redBudget;
+    battlefield->blueRemainingBudget = g_battlefieldConfig.blueBudget;
+    battlefield->redHQUnit = -1;
+    battlefield->blueHQUnit = -1;
+    battlefield->headless = 0;
+    battlefield->arena = arena;
+    battlefield->ownsArena = ownsArena;
+    battlefield->renderer = NULL;
+    battlefield->eventLog = NULL;
+    battlefield->tickMode = TICK_SEQUENTIAL;
+    battlefield->threadPool = NULL;
+    battlefield->intents = NULL;
+    battlefield->targetCacheMode = TARGET_CACHE_ON;
+    battlefield->targetCache = NULL;
+    battlefield->cellEpoch = 0;
+    battlefield->blockEpochs = NULL;
+    battlefield->blockColumns = ((width - 1) >> CELL_BLOCK_SHIFT) + 1;
+    battlefield->typeCosts = NULL;
+    battlefield->typeCostCount = 0;
+    battlefield->stats = NULL;
+    rngSeed(&battlefield->rng, 0, 0);
+    battlefield->cells = NULL;
+
+    if (!arena) {
+        return 0;
     }
 
-    // 分配装备数组内存
-    battlefield->redEquipments = (Equipment**)malloc(MAX_EQUIPMENTS_PER_TEAM * sizeof(Equipment*));
-    battlefield->blueEquipments = (Equipment**)malloc(MAX_EQUIPMENTS_PER_TEAM * sizeof(Equipment*));
+    // 分配格子数组内存（一次连续分配，全部初始化为空）
+    battlefield->cells = (Cell*)arenaCalloc(arena, (size_t)width * height, sizeof(Cell));
+    size_t blockCount = (size_t)battlefield->blockColumns * (((height - 1) >> CELL_BLOCK_SHIFT) + 1);
+    battlefield->blockEpochs = (unsigned long long*)arenaCalloc(arena, 2 * blockCount, sizeof(unsigned long long));
+    int ok = battlefield->cells && battlefield->blockEpochs;
+
+    // 分配双方的单元存储
+    ok = ok && initUnitStore(&battlefield->redUnits, unitCapacity, arena);
+    ok = ok && initUnitStore(&battlefield->blueUnits, unitCapacity, arena);
+
+    // 初始化双方的空间索引
+    ok = ok && initSpatialGrid(&battlefield->redIndex, width, height, arena);
+    ok = ok && initSpatialGrid(&battlefield->blueIndex, width, height, arena);
+
+    // 初始化占用位图
+    ok = ok && initBitboard(&battlefield->redOccupancy, width, height, arena);
+    ok = ok && initBitboard(&battlefield->blueOccupancy, width, height, arena);
+    ok = ok && initBitboard(&battlefield->fenceOccupancy, width, height, arena);
+    ok = ok && initBitboard(&battlefield->flyerOccupancy, width, height, arena);
+
+    // 分配失败时释放已分配的部分（外部内存池中的部分由调用者重置内存池时回收）
+    if (!ok) {
+        freeBattlefield(battlefield);
+        return 0;
+    }
+    return 1;
 }
 
 // 释放战场资源
 void freeBattlefield(Battlefield* battlefield) {
-    // 释放装备资源
-    for (int i = 0; i < battlefield->redCount; i++) {
-        free(battlefield->redEquipments[i]);
-    }
-    for (int i = 0; i < battlefield->blueCount; i++) {
-        free(battlefield->blueEquipments[i]);
-    }
-    free(battlefield->redEquipments);
-    free(battlefield->blueEquipments);
-
-    // 释放格子资源
-    for (int i = 0; i < battlefield->height; i++) {
-        free(battlefield->cells[i]);
+    // 所有内存都在内存池中，战场自己的内存池整体释放，外部内存池由调用者重置
+    if (battlefield->ownsArena && battlefield->arena) {
+        freeArena(battlefield->arena);
+        free(battlefield->arena);
     }
-    free(battlefield->cells);
+    battlefield->arena = NULL;
+    battlefield->cells = NULL;
+    battlefield->blockEpochs = NULL;
 }
 
-// 获取战场格子
-Cell* getCell(Battlefield* battlefield, int x, int y) {
-    if (x < 0 || x >= battlefield->width || y < 0 || y >= battlefield->height) {
-        return NULL;
+// 在(x, y)处放置或移除装备后更新占用位图
+static void updateOccupancy(Battlefield* battlefield, Team team, int typeId, int x, int y, int occupied) {
+    EquipmentType* type = getEquipmentTypeById(typeId);
+    int isFence = (typeId == FENCE_TYPE_ID);
+    int isFlyer = (type && type->canFly);
+
+    // 栅栏阻挡双方的射击，它的变化也要使对方的攻击目标缓存失效
+    if (isFence) {
+        markCellChanged(battlefield, x, y, getEnemyTeam(team));
     }
-    return &battlefield->cells[y][x];
-}
 
-// 检查位置是否在战场范围内
-int isPositionValid(Battlefield* battlefield, int x, int y) {
-    return (x >= 0 && x < battlefield->width && y >= 0 && y < battlefield->height);
+    if (occupied) {
+        bitboardSet(getTeamOccupancy(battlefield, team), x, y);
+        if (isFence) bitboardSet(&battlefield->fenceOccupancy, x, y);
+        if (isFlyer) bitboardSet(&battlefield->flyerOccupancy, x, y);
+    } else {
+        bitboardClear(getTeamOccupancy(battlefield, team), x, y);
+        if (isFence) bitboardClear(&battlefield->fenceOccupancy, x, y);
+        if (isFlyer) bitboardClear(&battlefield->flyerOccupancy, x, y);
+    }
 }
 
 // 检查位置是否在本方半场
@@ -80,126 +163,258 @@ int isPositionInOwnHalf(Battlefield* battlefield, int x, int y, Team team) {
     return 0;
 }
 
-// 向战场添加装备
-int addEquipmentToBattlefield(Battlefield* battlefield, Equipment* equipment) {
-    if (!equipment || !isPositionValid(battlefield, equipment->x, equipment->y)) {
-        return 0;
+// 检查装备能否部署到战场上
+const char* checkEquipmentPlacement(Battlefield* battlefield, const Equipment* equipment) {
+    if (!isPositionValid(battlefield, equipment->x, equipment->y)) {
+        return "位置超出边界！";
     }
 
     // 检查是否在本方半场
     if (!isPositionInOwnHalf(battlefield, equipment->x, equipment->y, equipment->team)) {
-        printf("装备只能部署在己方半场！\n");
-        return 0;
+        return "装备只能部署在己方半场！";
     }
 
     // 检查单元格是否已被占用
-    Cell* cell = getCell(battlefield, equipment->x, equipment->y);
-    if (cell->status != CELL_EMPTY) {
-        printf("该位置已被占用！\n");
-        return 0;
+    if (getCell(battlefield, equipment->x, equipment->y) != 0) {
+        return "该位置已被占用！";
     }
 
     // 检查预算是否足够
     EquipmentType* type = getEquipmentTypeById(equipment->typeId);
     if (!type) {
-        return 0;
+        return "无效的装备类型ID！";
     }
 
+    UnitStore* units = getTeamUnits(battlefield, equipment->team);
+    int cost = getEquipmentCost(battlefield, type);
     if (equipment->team == TEAM_RED) {
-        if (type->cost > battlefield->redRemainingBudget) {
-            printf("红方预算不足！\n");
-            return 0;
+        if (cost > battlefield->redRemainingBudget) {
+            return "红方预算不足！";
         }
-        if (battlefield->redCount >= battlefield->maxEquipments) {
-            printf("红方装备数量已达上限！\n");
-            return 0;
+        if (battlefield->maxEquipments > 0 && units->count >= battlefield->maxEquipments) {
+            return "红方装备数量已达上限！";
         }
-        battlefield->redRemainingBudget -= type->cost;
-        battlefield->redEquipments[battlefield->redCount++] = equipment;
-        cell->status = CELL_OCCUPIED_RED;
     } else {
-        if (type->cost > battlefield->blueRemainingBudget) {
-            printf("蓝方预算不足！\n");
-            return 0;
+        if (cost > battlefield->blueRemainingBudget) {
+            return "蓝方预算不足！";
+        }
+        if (battlefield->maxEquipments > 0 && units->count >= battlefield->maxEquipments) {
+            return "蓝方装备数量已达上限！";
         }
-        if (battlefield->blueCount >= battlefield->maxEquipments) {
-            printf("蓝方装备数量已达上限！\n");
-            return 0;
+    }
+    return NULL;
+}
+
+// 向战场添加装备
+int addEquipmentToBattlefield(Battlefield* battlefield, Equipment* equipment) {
+    if (!equipment) {
+        return 0;
+    }
+
+    const char* error = checkEquipmentPlacement(battlefield, equipment);
+    if (error) {
+        if (!battlefield->headless) printf("%s\n", error);
+        return 0;
+    }
+
+    int cost = getEquipmentCost(battlefield, getEquipmentTypeById(equipment->typeId));
+    if (equipment->team == TEAM_RED) {
+        battlefield->redRemainingBudget -= cost;
+    } else {
+        battlefield->blueRemainingBudget -= cost;
+    }
+    return placeUnitOnBattlefield(battlefield, equipment) >= 0;
+}
+
+// 把装备直接放到战场上
+int placeUnitOnBattlefield(Battlefield* battlefield, const Equipment* equipment) {
+    // 复制到本方单元存储，格子记录单元下标
+    int index = appendUnit(getTeamUnits(battlefield, equipment->team), equipment);
+    if (index < 0) {
+        return -1;
+    }
+
+    // 已被摧毁的装备只占用下标，不放到格子上；空间索引内存分配失败时撤销追加，战场保持不变
+    if (equipment->isActive) {
+        if (!spatialInsert(getTeamIndex(battlefield, equipment->team), index, equipment->x, equipment->y)) {
+            removeLastUnit(getTeamUnits(battlefield, equipment->team));
+            return -1;
         }
-        battlefield->blueRemainingBudget -= type->cost;
-        battlefield->blueEquipments[battlefield->blueCount++] = equipment;
-        cell->status = CELL_OCCUPIED_BLUE;
+        setCell(battlefield, equipment->x, equipment->y, makeCell(equipment->team, index));
+        updateOccupancy(battlefield, equipment->team, equipment->typeId, equipment->x, equipment->y, 1);
+    }
+    return index;
+}
+
+// 从战场移除指定队伍中下标为index的装备
+int removeUnitFromBattlefield(Battlefield* battlefield, Team team, int index) {
+    UnitStore* units = getTeamUnits(battlefield, team);
+    int x = units->x[index];
+    int y = units->y[index];
+
+    if (!isPositionValid(battlefield, x, y) || getCell(battlefield, x, y) != makeCell(team, index)) {
+        return 0;
     }
 
-    cell->equipment = equipment;
+    setCell(battlefield, x, y, 0);
+    updateOccupancy(battlefield, team, units->typeId[index], x, y, 0);
+
+    // 从空间索引中移除
+    spatialRemove(getTeamIndex(battlefield, team), index, x, y);
+
+    // 实际上我们不从数组中移除，只是标记为非活跃
+    markUnitDestroyed(units, index);
     return 1;
 }
 
 // 从战场移除装备
 int removeEquipmentFromBattlefield(Battlefield* battlefield, Equipment* equipment) {
-    if (!equipment || !isPositionValid(battlefield, equipment->x, equipment->y)) {
+    if (!equipment) {
         return 0;
     }
 
-    Cell* cell = getCell(battlefield, equipment->x, equipment->y);
-    if (cell->equipment != equipment) {
+    UnitStore* units = getTeamUnits(battlefield, equipment->team);
+    int index = findUnitIndex(units, equipment);
+    if (index < 0 || !removeUnitFromBattlefield(battlefield, equipment->team, index)) {
         return 0;
     }
 
-    cell->status = CELL_EMPTY;
-    cell->equipment = NULL;
+    syncUnitView(units, index);
+    return 1;
+}
 
-    // 实际上我们不从数组中移除，只是标记为非活跃
-    equipment->isActive = 0;
+// 移动装备
+int moveUnitOnBattlefield(Battlefield* battlefield, Team team, int index, int newX, int newY) {
+    UnitStore* units = getTeamUnits(battlefield, team);
+    int oldX = units->x[index];
+    int oldY = units->y[index];
+
+    // 空间索引最先更新，内存分配失败时装备留在原地，格子和占用位图都没有改动
+    if (!spatialMove(getTeamIndex(battlefield, team), index, oldX, oldY, newX, newY)) {
+        return 0;
+    }
+
+    // 从原位置移除
+    setCell(battlefield, oldX, oldY, 0);
+    updateOccupancy(battlefield, team, units->typeId[index], oldX, oldY, 0);
+
+    // 更新装备位置
+    units->x[index] = newX;
+    units->y[index] = newY;
+
+    // 添加到新位置
+    setCell(battlefield, newX, newY, makeCell(team, index));
+    updateOccupancy(battlefield, team, units->typeId[index], newX, newY, 1);
     return 1;
 }
 
+// 统计矩形内指定队伍的装备数量
+int countTeamUnitsInRect(Battlefield* battlefield, Team team, int x1, int y1, int x2, int y2) {
+    return bitboardCountRect(getTeamOccupancy(battlefield, team), NULL, x1, y1, x2, y2);
+}
+
+// 检查直线上是否有装备
+int isSegmentOccupied(Battlefield* battlefield, int x1, int y1, int x2, int y2) {
+    return bitboardAnyOnSegment(&battlefield->redOccupancy, &battlefield->blueOccupancy, x1, y1, x2, y2);
+}
+
+// 用结构数组中的数据刷新双方所有装备的Equipment视图
+void syncEquipmentViews(Battlefield* battlefield) {
+    syncUnitViews(&battlefield->redUnits);
+    syncUnitViews(&battlefield->blueUnits);
+}
+
+// 检查从(x1, y1)到(x2, y2)的射击是否被栅栏挡住：按整数Bresenham直线检查两点之间（不含两端）的格子
+// 目标本身是栅栏时不算被挡住
+static int isFireBlocked(const Battlefield* battlefield, int x1, int y1, int x2, int y2) {
+    return bitboardAnyBetween(&battlefield->fenceOccupancy, NULL, x1, y1, x2, y2);
+}
+
 // 检查是否有路径障碍
 int hasPathObstacle(Battlefield* battlefield, int x1, int y1, int x2, int y2, int ignoreFlying) {
-    // 简化版本：只检查直线上的障碍
-    // 实际游戏中可能需要更复杂的路径查找算法
-    
-    // 忽略飞行单位的障碍检查
+    // 飞行装备的射击不受栅栏阻挡
     if (ignoreFlying) {
         return 0;
     }
 
-    // 计算起点和终点之间的步数
-    int dx = abs(x2 - x1);
-    int dy = abs(y2 - y1);
-    int steps = dx > dy ? dx : dy;
-    
-    if (steps == 0) {
+    BattleStats* stats = battlefield->stats;
+    STATS_COUNT(stats, losChecks, 1);
+    STATS_TIMER_BEGIN(stats, timer);
+    int obstacle = isFireBlocked(battlefield, x1, y1, x2, y2);
+    STATS_TIMER_END(stats, STATS_PHASE_LOS, timer);
+    return obstacle;
+}
+
+// 成批检查从同一位置出发的射击是否被挡住
+int findPathObstacles(Battlefield* battlefield, int x, int y, const int* xs, const int* ys, int count,
+                      unsigned char* blocked, BattleStats* stats) {
+    if (count <= 0) {
         return 0;
     }
+    STATS_COUNT(stats, losChecks, count);
+    STATS_TIMER_BEGIN(stats, timer);
+
+    // 射击方和所有目标的包围矩形内没有栅栏时都不会被挡住，按位图整字检查一次即可
+    int minX = x, maxX = x, minY = y, maxY = y;
+    for (int i = 0; i < count; i++) {
+        if (xs[i] < minX) minX = xs[i];
+        if (xs[i] > maxX) maxX = xs[i];
+        if (ys[i] < minY) minY = ys[i];
+        if (ys[i] > maxY) maxY = ys[i];
+    }
 
-    // 计算每一步的增量
-    float xIncrement = (float)(x2 - x1) / steps;
-    float yIncrement = (float)(y2 - y1) / steps;
-    
-    // 从起点向终点逐步检查
-    float x = x1, y = y1;
-    for (int i = 0; i < steps; i++) {
-        x += xIncrement;
-        y += yIncrement;
-        
-        int checkX = (int)(x + 0.5f);
-        int checkY = (int)(y + 0.5f);
-        
-        if (isPositionValid(battlefield, checkX, checkY)) {
-            Cell* cell = getCell(battlefield, checkX, checkY);
-            if (cell->status != CELL_EMPTY) {
-                // 检查是否是栅栏类型的装备（可以根据实际游戏规则调整）
-                if (cell->equipment && cell->equipment->typeId == 7) { // 假设typeId=7是栅栏
-                    return 1;
-                }
+    int total = 0;
+    if (!bitboardAnyInRect(&battlefield->fenceOccupancy, NULL, minX, minY, maxX, maxY)) {
+        memset(blocked, 0, (size_t)count);
+    } else {
+        for (int i = 0; i < count; i++) {
+            blocked[i] = (unsigned char)isFireBlocked(battlefield, x, y, xs[i], ys[i]);
+            total += blocked[i];
+        }
+    }
+
+    STATS_TIMER_END(stats, STATS_PHASE_LOS, timer);
+    return total;
+}
+
+// 检查(x, y)周围radius范围内（正方形）是否有栅栏
+int hasFenceNear(Battlefield* battlefield, int x, int y, int radius) {
+    return bitboardAnyInRect(&battlefield->fenceOccupancy, NULL, x - radius, y - radius, x + radius, y + radius);
+}
+
+// 检查(x, y)周围radius范围内（正方形）team一方的装备在计数为epoch之后是否有变化
+int hasCellsChangedSince(const Battlefield* battlefield, Team team, int x, int y, int radius, unsigned long long epoch) {
+    // 战场上任何格子都没有变化时不必逐块检查
+    if (battlefield->cellEpoch <= epoch) {
+        return 0;
+    }
+
+    int x1 = x - radius < 0 ? 0 : x - radius;
+    int y1 = y - radius < 0 ? 0 : y - radius;
+    int x2 = x + radius >= battlefield->width ? battlefield->width - 1 : x + radius;
+    int y2 = y + radius >= battlefield->height ? battlefield->height - 1 : y + radius;
+    int side = team == TEAM_BLUE ? 1 : 0;
+    for (int by = y1 >> CELL_BLOCK_SHIFT; by <= y2 >> CELL_BLOCK_SHIFT; by++) {
+        const unsigned long long* row = &battlefield->blockEpochs[2 * by * battlefield->blockColumns + side];
+        for (int bx = x1 >> CELL_BLOCK_SHIFT; bx <= x2 >> CELL_BLOCK_SHIFT; bx++) {
+            if (row[2 * bx] > epoch) {
+                return 1;
             }
         }
     }
-    
     return 0;
 }
 
+// 把所有格子块标记为已变化
+void invalidateCellEpochs(Battlefield* battlefield) {
+    int blockRows = ((battlefield->height - 1) >> CELL_BLOCK_SHIFT) + 1;
+    size_t count = 2 * (size_t)battlefield->blockColumns * blockRows;
+    battlefield->cellEpoch++;
+    for (size_t i = 0; i < count; i++) {
+        battlefield->blockEpochs[i] = battlefield->cellEpoch;
+    }
+}
+
 // 显示装备方向箭头
 char getDirectionChar(int dirX, int dirY) {
     if (dirX == 0 && dirY == -1) return '^';      // 上
@@ -213,221 +428,255 @@ char getDirectionChar(int dirX, int dirY) {
     return ' ';  // 无方向
 }
 
-// 渲染战场
-void renderBattlefield(Battlefield* battlefield, Team viewOnly) {
-    printf("战场状态 (红方: %d, 蓝方: %d)\n", battlefield->redCount, battlefield->blueCount);
-    printf("红方预算: %d/%d, 蓝方预算: %d/%d\n",
-           battlefield->redRemainingBudget, battlefield->redBudget,
-           battlefield->blueRemainingBudget, battlefield->blueBudget);
-
-    // 显示红方大本营血量
-    if (battlefield->redHQDeployed && battlefield->redHeadquarters) {
-        if (battlefield->redHeadquarters->isActive) {
-            printf("红方大本营血量: %d/%d\n", battlefield->redHeadquarters->currentHealth, getEquipmentTypeById(battlefield->redHeadquarters->typeId)->maxHealth);
-        } else {
-            printf("红方大本营: 已被摧毁\n");
-        }
-    } else {
-        printf("红方大本营: 未部署\n");
+// 装备在战场上显示的字符，红方为大写，蓝方为小写
+static char getUnitChar(int typeId, Team team) {
+    char c;
+    switch (typeId) {
+        case 1: c = 'T'; break; // 坦克
+        case 2: c = 'A'; break; // 飞机
+        case 3: c = 'C'; break; // 火炮
+        case 4: c = 'M'; break; // 导弹
+        case 5: c = 'S'; break; // 士兵
+        case 6: c = 'G'; break; // 枪塔
+        case 7: return '#';     // 栅栏
+        case 8: c = 'V'; break; // 装甲车
+        case 9: c = 'H'; break; // 重型机枪
+        case 10: c = 'K'; break; // 反坦克炮
+        default: return team == TEAM_RED ? 'R' : 'b';
     }
+    return team == TEAM_RED ? c : (char)(c - 'A' + 'a');
+}
 
-    // 显示蓝方大本营血量
-    if (battlefield->blueHQDeployed && battlefield->blueHeadquarters) {
-        if (battlefield->blueHeadquarters->isActive) {
-            printf("蓝方大本营血量: %d/%d\n", battlefield->blueHeadquarters->currentHealth, getEquipmentTypeById(battlefield->blueHeadquarters->typeId)->maxHealth);
-        } else {
-            printf("蓝方大本营: 已被摧毁\n");
+// 合成战场图中每个格子显示的字符
+void composeBattlefieldGrid(Battlefield* battlefield, Team viewOnly, char* chars, unsigned char* arrowRanks) {
+    int width = battlefield->width;
+    size_t cells = (size_t)width * battlefield->height;
+    memset(chars, ' ', cells);
+    memset(arrowRanks, 0, cells);
+
+    for (int t = 0; t < 2; t++) {
+        Team team = (t == 0) ? TEAM_RED : TEAM_BLUE;
+        // 只查看指定方的单位时，非指定方的单位显示为空，也不显示其方向
+        if (viewOnly != TEAM_NONE && team != viewOnly) {
+            continue;
+        }
+
+        // 已移出存活列表的装备都已从格子上移除，不必检查
+        UnitStore* units = getTeamUnits(battlefield, team);
+        for (int k = 0; k < units->activeCount; k++) {
+            int i = units->active[k];
+            int x = units->x[i];
+            int y = units->y[i];
+            // 只绘制仍在战场上的装备
+            if (!isPositionValid(battlefield, x, y) || getCell(battlefield, x, y) != makeCell(team, i)) {
+                continue;
+            }
+            chars[y * width + x] = units->alive[i] ? getUnitChar(units->typeId[i], team) : 'x'; // x表示已摧毁
+
+            // 装备朝向的相邻空格子显示方向指示
+            int dirX = units->dirX[i];
+            int dirY = units->dirY[i];
+            if ((dirX == 0 && dirY == 0) || dirX < -1 || dirX > 1 || dirY < -1 || dirY > 1) {
+                continue;
+            }
+            int ax = x + dirX;
+            int ay = y + dirY;
+            if (!isPositionValid(battlefield, ax, ay) || getCell(battlefield, ax, ay) != 0) {
+                continue;
+            }
+
+            // 多个装备指向同一格子时，dirX大的优先，其次dirY大的优先
+            // （与原先从左上到右下检查空格子周围8个方向时的结果相同）
+            int offset = ay * width + ax;
+            unsigned char rank = (unsigned char)((dirX + 1) * 3 + (dirY + 1) + 1);
+            if (rank > arrowRanks[offset]) {
+                arrowRanks[offset] = rank;
+                chars[offset] = getDirectionChar(dirX, dirY);
+            }
         }
-    } else {
-        printf("蓝方大本营: 未部署\n");
     }
+}
 
-    // 打印X坐标标题
-    printf("   ");
-    for (int j = 0; j < battlefield->width; j++) {
-        if (j % 10 == 0) {
-            printf("%d", j / 10);
+// 显示战场状态、预算和双方大本营血量（共4行）
+void renderBattlefieldHeader(Battlefield* battlefield, TextBuffer* out) {
+    textBufferPrintf(out, "战场状态 (红方: %d, 蓝方: %d)\n", battlefield->redUnits.count, battlefield->blueUnits.count);
+    textBufferPrintf(out, "红方预算: %d/%d, 蓝方预算: %d/%d\n",
+                     battlefield->redRemainingBudget, battlefield->redBudget,
+                     battlefield->blueRemainingBudget, battlefield->blueBudget);
+
+    // 显示双方大本营血量
+    for (int t = 0; t < 2; t++) {
+        Team team = (t == 0) ? TEAM_RED : TEAM_BLUE;
+        const char* teamName = (t == 0) ? "红方" : "蓝方";
+        UnitStore* units = getTeamUnits(battlefield, team);
+        int hq = (t == 0) ? battlefield->redHQUnit : battlefield->blueHQUnit;
+
+        if (hq < 0) {
+            textBufferPrintf(out, "%s大本营: 未部署\n", teamName);
+        } else if (units->alive[hq]) {
+            textBufferPrintf(out, "%s大本营血量: %d/%d\n", teamName, units->health[hq],
+                             getEquipmentTypeById(units->typeId[hq])->maxHealth);
         } else {
-            printf(" ");
+            textBufferPrintf(out, "%s大本营: 已被摧毁\n", teamName);
         }
     }
-    printf("\n");
-    
-    printf("   ");
-    for (int j = 0; j < battlefield->width; j++) {
-        printf("%d", j % 10);
-    }
-    printf("\n");
+}
+
+// 显示一方的装备列表，最多maxLines行（<=0表示不限制）
+static void renderTeamUnitList(Battlefield* battlefield, Team team, int maxLines, TextBuffer* out) {
+    UnitStore* units = getTeamUnits(battlefield, team);
+    textBufferPuts(out, team == TEAM_RED ? "红方装备:\n" : "蓝方装备:\n");
+
+    int activeCount = units->aliveCount;
 
-    // 绘制上边框
-    printf("  +");
-    for (int j = 0; j < battlefield->width; j++) {
-        printf("-");
+    // 标题之外的行装不下全部装备时，最后一行用于提示未显示的数量
+    int showCount = activeCount;
+    if (maxLines > 0 && activeCount > maxLines - 1) {
+        showCount = maxLines > 2 ? maxLines - 2 : 0;
     }
-    printf("+\n");
 
-    // 绘制战场
-    for (int i = 0; i < battlefield->height; i++) {
-        // 显示Y坐标
-        if (i < 10) {
-            printf("%d |", i);
-        } else {
-            printf("%d|", i);
+    int shownCount = 0;
+    for (int k = 0; k < units->activeCount && shownCount < showCount; k++) {
+        int i = units->active[k];
+        if (!units->alive[i]) {
+            continue;
         }
-        
-        for (int j = 0; j < battlefield->width; j++) {
-            Cell* cell = getCell(battlefield, j, i);
-            
-            // 如果只查看指定方的单位，则根据条件显示
-            if (viewOnly != TEAM_NONE) {
-                // 如果格子是空的或者是非指定方的单位，则显示为空
-                if (cell->status == CELL_EMPTY || 
-                    (viewOnly == TEAM_RED && cell->status == CELL_OCCUPIED_BLUE) ||
-                    (viewOnly == TEAM_BLUE && cell->status == CELL_OCCUPIED_RED)) {
-                    
-                    // 检查是否需要显示方向指示（只针对viewOnly方的单位）
-                    int directionFound = 0;
-                    if (cell->status == CELL_EMPTY) {
-                        for (int dx = -1; dx <= 1 && !directionFound; dx++) {
-                            for (int dy = -1; dy <= 1 && !directionFound; dy++) {
-                                if (dx == 0 && dy == 0) continue;
-                                
-                                int nx = j + dx;
-                                int ny = i + dy;
-                                
-                                if (isPositionValid(battlefield, nx, ny)) {
-                                    Cell* neighborCell = getCell(battlefield, nx, ny);
-                                    if (neighborCell->equipment && 
-                                        neighborCell->equipment->team == viewOnly &&
-                                        neighborCell->equipment->directionX == -dx && 
-                                        neighborCell->equipment->directionY == -dy) {
-                                        printf("%c", getDirectionChar(-dx, -dy));
-                                        directionFound = 1;
-                                        break;
-                                    }
-                                }
-                            }
-                        }
-                    }
-                    
-                    if (!directionFound) {
-                        printf(" ");
-                    }
-                    continue;
-                }
-            }
-            
-            if (cell->status == CELL_EMPTY) {
-                // 检查周围8个方向是否有装备，并显示方向指示
-                int directionFound = 0;
-                for (int dx = -1; dx <= 1 && !directionFound; dx++) {
-                    for (int dy = -1; dy <= 1 && !directionFound; dy++) {
-                        if (dx == 0 && dy == 0) continue;
-                        
-                        int nx = j + dx;
-                        int ny = i + dy;
-                        
-                        if (isPositionValid(battlefield, nx, ny)) {
-                            Cell* neighborCell = getCell(battlefield, nx, ny);
-                            if (neighborCell->equipment && 
-                                (viewOnly == TEAM_NONE || neighborCell->equipment->team == viewOnly) &&
-                                neighborCell->equipment->directionX == -dx && 
-                                neighborCell->equipment->directionY == -dy) {
-                                printf("%c", getDirectionChar(-dx, -dy));
-                                directionFound = 1;
-                                break;
-                            }
-                        }
-                    }
-                }
-                
-                if (!directionFound) {
-                    printf(" ");
-                }
-            } else if (cell->status == CELL_OCCUPIED_RED) {
-                if (cell->equipment && cell->equipment->isActive) {
-                    // 根据装备类型显示不同字符
-                    switch (cell->equipment->typeId) {
-                        case 1: printf("T"); break; // 坦克
-                        case 2: printf("A"); break; // 飞机
-                        case 3: printf("C"); break; // 火炮
-                        case 4: printf("M"); break; // 导弹
-                        case 5: printf("S"); break; // 士兵
-                        case 6: printf("G"); break; // 枪塔
-                        case 7: printf("#"); break; // 栅栏
-                        case 8: printf("V"); break; // 装甲车
-                        case 9: printf("H"); break; // 重型机枪
-                        case 10: printf("K"); break; // 反坦克炮
-                        default: printf("R"); break;
-                    }
-                } else {
-                    printf("x"); // 已摧毁
-                }
-            } else if (cell->status == CELL_OCCUPIED_BLUE) {
-                if (cell->equipment && cell->equipment->isActive) {
-                    // 根据装备类型显示不同字符
-                    switch (cell->equipment->typeId) {
-                        case 1: printf("t"); break; // 坦克
-                        case 2: printf("a"); break; // 飞机
-                        case 3: printf("c"); break; // 火炮
-                        case 4: printf("m"); break; // 导弹
-                        case 5: printf("s"); break; // 士兵
-                        case 6: printf("g"); break; // 枪塔
-                        case 7: printf("#"); break; // 栅栏
-                        case 8: printf("v"); break; // 装甲车
-                        case 9: printf("h"); break; // 重型机枪
-                        case 10: printf("k"); break; // 反坦克炮
-                        default: printf("b"); break;
-                    }
-                } else {
-                    printf("x"); // 已摧毁
-                }
-            }
+        shownCount++;
+
+        EquipmentType* type = getEquipmentTypeById(units->typeId[i]);
+        if (!type) {
+            continue;
         }
-        printf("|\n");
+        textBufferPrintf(out, "ID: %d, 名称: %s, 位置: (%d,%d), 方向: %c, 生命值: %d/%d, 弹药: %d/%d\n",
+                         units->views[i].id, units->views[i].name, units->x[i], units->y[i],
+                         getDirectionChar(units->dirX[i], units->dirY[i]),
+                         units->health[i], type->maxHealth, units->ammo[i], type->maxAmmo);
     }
 
-    // 绘制下边框
-    printf("  +");
-    for (int j = 0; j < battlefield->width; j++) {
-        printf("-");
+    if (activeCount == 0 && units->count > 0) {
+        textBufferPrintf(out, "%s全军覆没！\n", team == TEAM_RED ? "红方" : "蓝方");
+    } else if (activeCount > shownCount) {
+        textBufferPrintf(out, "... 另有%d台装备未显示\n", activeCount - shownCount);
     }
-    printf("+\n");
+}
 
-    // 显示红方装备状态（如果viewOnly是TEAM_NONE或TEAM_RED）
+// 显示双方装备列表
+void renderUnitList(Battlefield* battlefield, Team viewOnly, int maxLines, TextBuffer* out) {
+    // 两方都显示时平分可用的行数
+    if (maxLines > 0 && viewOnly == TEAM_NONE) {
+        maxLines /= 2;
+    }
     if (viewOnly == TEAM_NONE || viewOnly == TEAM_RED) {
-        printf("红方装备:\n");
-        int activeRedCount = 0;
-        for (int i = 0; i < battlefield->redCount; i++) {
-            if (battlefield->redEquipments[i]->isActive) {
-                activeRedCount++;
-                displayEquipmentInfo(battlefield->redEquipments[i]);
-            }
-        }
-        if (activeRedCount == 0 && battlefield->redCount > 0) {
-            printf("红方全军覆没！\n");
-        }
+        renderTeamUnitList(battlefield, TEAM_RED, maxLines, out);
     }
-
-    // 显示蓝方装备状态（如果viewOnly是TEAM_NONE或TEAM_BLUE）
     if (viewOnly == TEAM_NONE || viewOnly == TEAM_BLUE) {
-        printf("蓝方装备:\n");
-        int activeBlueCount = 0;
-        for (int i = 0; i < battlefield->blueCount; i++) {
-            if (battlefield->blueEquipments[i]->isActive) {
-                activeBlueCount++;
-                displayEquipmentInfo(battlefield->blueEquipments[i]);
-            }
+        renderTeamUnitList(battlefield, TEAM_BLUE, maxLines, out);
+    }
+}
+
+// 装备列表可用的行数
+int getUnitListMaxLines(Battlefield* battlefield) {
+    int rows = platformGetConsoleHeight(0);
+    if (rows <= 0) {
+        return 0; // 输出不是控制台（如重定向到文件），不限制
+    }
+
+    // 减去标题、坐标、边框和格子占用的行，并为画面下方的提示留出余量
+    int available = rows - (BATTLEFIELD_HEADER_LINES + BATTLEFIELD_GRID_HEADER_LINES + battlefield->height + 1) - 2;
+    return available > MIN_UNIT_LIST_LINES ? available : MIN_UNIT_LIST_LINES;
+}
+
+// 显示坐标标题和上边框（共3行）
+void renderGridHeader(Battlefield* battlefield, TextBuffer* out) {
+    int width = battlefield->width;
+
+    // X坐标的十位和个位
+    textBufferPuts(out, "   ");
+    for (int j = 0; j < width; j++) {
+        if (j % 10 == 0) {
+            textBufferPrintf(out, "%d", j / 10);
+        } else {
+            textBufferAppend(out, " ", 1);
         }
-        if (activeBlueCount == 0 && battlefield->blueCount > 0) {
-            printf("蓝方全军覆没！\n");
+    }
+    textBufferPuts(out, "\n   ");
+    char* digits = textBufferReserve(out, (size_t)width);
+    if (digits) {
+        for (int j = 0; j < width; j++) {
+            digits[j] = (char)('0' + j % 10);
         }
     }
+    textBufferPuts(out, "\n");
+
+    // 上边框
+    renderGridBorder(battlefield, out);
+}
+
+// 显示一行边框
+void renderGridBorder(Battlefield* battlefield, TextBuffer* out) {
+    textBufferPuts(out, "  +");
+    textBufferRepeat(out, '-', battlefield->width);
+    textBufferPuts(out, "+\n");
+}
+
+// 显示一行格子前的Y坐标
+void renderGridRowLabel(int y, TextBuffer* out) {
+    textBufferPrintf(out, y < 10 ? "%d |" : "%d|", y);
+}
+
+// renderBattlefield使用的绘制缓冲区（只在界面中使用），按需扩大并在多次绘制之间复用
+static struct {
+    TextBuffer text;
+    char* chars;
+    unsigned char* arrowRanks;
+    size_t cells;
+} g_screen;
+
+// 渲染战场
+void renderBattlefield(Battlefield* battlefield, Team viewOnly) {
+    BattleStats* stats = battlefield->stats;
+    STATS_COUNT(stats, renderCalls, 1);
+    STATS_TIMER_BEGIN(stats, timer);
+
+    size_t cells = (size_t)battlefield->width * battlefield->height;
+    if (cells > g_screen.cells) {
+        free(g_screen.chars);
+        free(g_screen.arrowRanks);
+        g_screen.chars = (char*)malloc(cells);
+        g_screen.arrowRanks = (unsigned char*)malloc(cells);
+        g_screen.cells = (g_screen.chars && g_screen.arrowRanks) ? cells : 0;
+    }
+    if (g_screen.cells == 0 || (!g_screen.text.data && !initTextBuffer(&g_screen.text, cells * 2 + 4096))) {
+        printf("内存分配失败\n");
+        return;
+    }
+
+    // 刷新Equipment视图（调用者会在绘制后读取视图）
+    syncEquipmentViews(battlefield);
+
+    TextBuffer* out = &g_screen.text;
+    renderBattlefieldHeader(battlefield, out);
+    renderGridHeader(battlefield, out);
+
+    // 格子
+    composeBattlefieldGrid(battlefield, viewOnly, g_screen.chars, g_screen.arrowRanks);
+    for (int i = 0; i < battlefield->height; i++) {
+        renderGridRowLabel(i, out);
+        textBufferAppend(out, g_screen.chars + (size_t)i * battlefield->width, (size_t)battlefield->width);
+        textBufferPuts(out, "|\n");
+    }
+    renderGridBorder(battlefield, out);
+
+    renderUnitList(battlefield, viewOnly, getUnitListMaxLines(battlefield), out);
+
+    // 整个画面一次写出
+    textBufferFlush(out, stdout);
+    STATS_TIMER_END(stats, STATS_PHASE_RENDER, timer);
 }
 
 // 部署装备菜单
 void showDeployMenu(Battlefield* battlefield, Team team) {
-    system("cls");
+    platformClearScreen();
     
     // 显示战场当前状态，只显示当前方的装备
     renderBattlefield(battlefield, team);
@@ -454,24 +703,6 @@ void showDeployMenu(Battlefield* battlefield, Team team) {
     printf("请选择装备类型 (输入0结束部署): ");
 }
 
-// 显示装备信息
-void displayEquipmentInfo(Equipment* equipment) {
-    if (!equipment || !equipment->isActive) {
-        return;
-    }
-
-    EquipmentType* type = getEquipmentTypeById(equipment->typeId);
-    if (!type) {
-        return;
-    }
-
-    char dirChar = getDirectionChar(equipment->directionX, equipment->directionY);
-    printf("ID: %d, 名称: %s, 位置: (%d,%d), 方向: %c, 生命值: %d/%d, 弹药: %d/%d\n",
-           equipment->id, equipment->name, equipment->x, equipment->y, dirChar,
-           equipment->currentHealth, type->maxHealth,
-           equipment->currentAmmo, type->maxAmmo);
-}
-
 // 部署装备到战场
 int deployEquipment(Battlefield* battlefield, Team team) {
     while (1) {
@@ -488,7 +719,7 @@ int deployEquipment(Battlefield* battlefield, Team team) {
         if (!type) {
             printf("无效的装备类型ID！\n");
             printf("按任意键继续...\n");
-            getch();
+            platformGetch();
             continue;
         }
         
@@ -499,16 +730,17 @@ int deployEquipment(Battlefield* battlefield, Team team) {
         if (!isPositionValid(battlefield, x, y)) {
             printf("位置超出边界！\n");
             printf("按任意键继续...\n");
-            getch();
+            platformGetch();
             continue;
         }
         
         if (!isPositionInOwnHalf(battlefield, x, y, team)) {
             printf("必须在己方半场部署装备！\n");
-            printf("己方半场范围: %s\n", 
-                  team == TEAM_RED ? "x: 0-39" : "x: 40-79");
+            int half = battlefield->width / 2;
+            printf("己方半场范围: x: %d-%d\n",
+                   team == TEAM_RED ? 0 : half, team == TEAM_RED ? half - 1 : battlefield->width - 1);
             printf("按任意键继续...\n");
-            getch();
+            platformGetch();
             continue;
         }
         
@@ -544,27 +776,33 @@ int deployEquipment(Battlefield* battlefield, Team team) {
         char dirChar = getDirectionChar(dirX, dirY);
         printf("已选择方向: %c\n", dirChar);
         
-        Equipment* equipment = createEquipment(typeId, team, x, y, dirX, dirY);
-        if (!equipment) {
+        Equipment equipment;
+        if (!initEquipment(&equipment, typeId, team, x, y, dirX, dirY)) {
             printf("创建装备失败！\n");
             printf("按任意键继续...\n");
-            getch();
+            platformGetch();
             continue;
         }
         
-        if (!addEquipmentToBattlefield(battlefield, equipment)) {
+        if (!addEquipmentToBattlefield(battlefield, &equipment)) {
             printf("部署装备失败！\n");
-            free(equipment);
             printf("按任意键继续...\n");
-            getch();
+            platformGetch();
             continue;
         }
         
         // 不再刷新显示战场，只显示成功信息
         printf("\n装备部署成功！位置: (%d,%d), 方向: %c\n", x, y, dirChar);
         printf("按任意键继续部署...\n");
-        getch();
+        platformGetch();
     }
     
     return 1;
-} 
\ No newline at end of file
+} 
+
+// 释放部署方案资源
+void freeDeployment(Deployment* deployment) {
+    free(deployment->entries);
+    deployment->entries = NULL;
+    deployment->count = 0;
+}
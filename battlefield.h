@@ -1,7 +1,38 @@
 #ifndef BATTLEFIELD_H
 #define BATTLEFIELD_H
 
+#include <stdint.h>
 #include "equipment.h"
+#include "spatial.h"
+#include "units.h"
+#include "bitboard.h"
+#include "arena.h"
+#include "renderer.h"
+#include "eventlog.h"
+#include "threadpool.h"
+#include "stats.h"
+
+// 默认的战场尺寸和每方预算
+#define DEFAULT_BATTLEFIELD_WIDTH 80
+#define DEFAULT_BATTLEFIELD_HEIGHT 60
+#define DEFAULT_BUDGET 10000
+
+// 战场设置（可由设置文件修改，见loadBattlefieldConfig）
+typedef struct {
+    int width, height;          // 手动部署时的战场尺寸，也是想定文件的默认尺寸
+    int redBudget, blueBudget;  // 双方预算
+    int maxEquipments;          // 每方最大装备数量（0表示不限）
+} BattlefieldConfig;
+
+// 全局战场设置，新初始化的战场从中取得预算和装备数量上限
+extern BattlefieldConfig g_battlefieldConfig;
+
+// 战场画面布局：标题行数、坐标标题和上边框的行数
+#define BATTLEFIELD_HEADER_LINES 4
+#define BATTLEFIELD_GRID_HEADER_LINES 3
+
+// 控制台较矮时装备列表至少显示的行数
+#define MIN_UNIT_LIST_LINES 8
 
 // 战场格子状态
 typedef enum {
@@ -10,30 +41,195 @@ typedef enum {
     CELL_OCCUPIED_BLUE
 } CellStatus;
 
-// 战场格子
+// 战场格子：占据该格子的装备编码，0表示空
+// 非空时为 (单元下标 * 2 + 队伍位) + 1，队伍位0为红方、1为蓝方，
+// 装备数据通过下标从对应队伍的单元存储中获取
+typedef uint32_t Cell;
+
+// 部署条目（想定文件中的一个装备）
 typedef struct {
-    CellStatus status;
-    Equipment* equipment;
-} Cell;
+    Team team;
+    int typeId;
+    int x, y;
+    int dirX, dirY;
+    int line;           // 在文件中的行号（用于报告错误）
+} DeploymentEntry;
 
-// 战场
+// 部署方案（预先解析的想定中的装备列表，可重复用于多场战斗）
 typedef struct {
+    DeploymentEntry* entries;
+    int count;
+} Deployment;
+
+// 每步模拟的处理方式
+typedef enum {
+    TICK_SEQUENTIAL,    // 先红方后蓝方，逐个装备移动并攻击（默认，结果与旧版本相同）
+    TICK_TWO_PHASE      // 两阶段：所有装备按上一步的状态并行计算意图，再按固定规则统一结算
+} TickMode;
+
+// 两阶段模式的意图缓冲区（定义见simulation.c）
+typedef struct TickIntents TickIntents;
+
+// 攻击目标缓存（定义见simulation.c）
+typedef struct TargetCache TargetCache;
+
+// 攻击目标缓存的使用方式
+typedef enum {
+    TARGET_CACHE_ON,        // 缓存上次的目标，附近没有变化时直接使用（默认，结果与完整查找相同）
+    TARGET_CACHE_OFF,       // 每次都完整查找
+    TARGET_CACHE_VERIFY     // 同时进行缓存查找和完整查找，统计结果不同的次数，使用完整查找的结果
+} TargetCacheMode;
+
+// 格子变化计数按边长为(1 << CELL_BLOCK_SHIFT)的正方形块记录
+#define CELL_BLOCK_SHIFT 3
+
+// 战场
+typedef struct Battlefield {
     int width;      // 战场宽度
     int height;     // 战场高度
-    Cell** cells;   // 二维格子数组
-    int redCount;   // 红方装备数量
-    int blueCount;  // 蓝方装备数量
-    Equipment** redEquipments;   // 红方装备数组
-    Equipment** blueEquipments;  // 蓝方装备数组
-    int maxEquipments;           // 每方最大装备数量
+    Cell* cells;    // 格子数组（按行连续存储，共width*height个）
+    UnitStore redUnits;          // 红方装备（结构数组存储）
+    UnitStore blueUnits;         // 蓝方装备（结构数组存储）
+    int maxEquipments;           // 每方最大装备数量（0表示不限）
     int redBudget;               // 红方预算
     int blueBudget;              // 蓝方预算
     int redRemainingBudget;      // 红方剩余预算
     int blueRemainingBudget;     // 蓝方剩余预算
+    int redHQUnit;               // 红方大本营在红方单元存储中的下标（-1表示未部署）
+    int blueHQUnit;              // 蓝方大本营在蓝方单元存储中的下标（-1表示未部署）
+    int headless;                // 无界面模式：不渲染弹道、不输出提示信息
+    Rng rng;                     // 本场战斗的随机数流
+    SpatialGrid redIndex;        // 红方活跃装备的空间索引
+    SpatialGrid blueIndex;       // 蓝方活跃装备的空间索引
+    Bitboard redOccupancy;       // 红方占用位图
+    Bitboard blueOccupancy;      // 蓝方占用位图
+    Bitboard fenceOccupancy;     // 栅栏占用位图（双方）
+    Bitboard flyerOccupancy;     // 飞行装备占用位图（双方）
+    Arena* arena;                // 本场战斗所有内存所在的内存池
+    int ownsArena;               // 内存池是否由战场自己创建（释放战场时一并释放）
+    Renderer* renderer;          // 实时显示用的渲染器（NULL表示不记录弹道）
+    EventLog* eventLog;          // 战斗事件记录（NULL表示不记录）
+    TickMode tickMode;           // 每步模拟的处理方式
+    ThreadPool* threadPool;      // 两阶段模式计算意图用的线程池（NULL表示在调用者线程中计算）
+    TickIntents* intents;        // 两阶段模式的意图缓冲区（第一次使用时在内存池中分配）
+    TargetCacheMode targetCacheMode; // 攻击目标缓存的使用方式
+    TargetCache* targetCache;    // 攻击目标缓存（第一次使用时在内存池中分配）
+    unsigned long long cellEpoch;    // 格子变化计数，每次设置格子时加1
+    unsigned long long* blockEpochs; // 每个格子块中双方装备最后一次变化时的计数（按行存储，每块红方、蓝方各一项）
+    int blockColumns;            // 每行的格子块数
+    const int* typeCosts;        // 按类型ID索引的造价表，部署时代替装备类型的造价（NULL表示不替换）
+    int typeCostCount;           // 造价表的长度
+    BattleStats* stats;          // 热点路径统计（NULL表示不收集，编译时没有定义BATTLE_STATS时始终不收集）
 } Battlefield;
 
-// 初始化战场
-void initBattlefield(Battlefield* battlefield, int width, int height);
+// 获取指定队伍的单元存储
+static inline UnitStore* getTeamUnits(Battlefield* battlefield, Team team) {
+    return team == TEAM_RED ? &battlefield->redUnits : &battlefield->blueUnits;
+}
+
+// 获取指定队伍的空间索引
+static inline SpatialGrid* getTeamIndex(Battlefield* battlefield, Team team) {
+    return team == TEAM_RED ? &battlefield->redIndex : &battlefield->blueIndex;
+}
+
+// 获取指定队伍的占用位图
+static inline Bitboard* getTeamOccupancy(Battlefield* battlefield, Team team) {
+    return team == TEAM_RED ? &battlefield->redOccupancy : &battlefield->blueOccupancy;
+}
+
+// 获取指定队伍大本营的单元下标（-1表示未部署）
+static inline int getTeamHQUnit(const Battlefield* battlefield, Team team) {
+    return team == TEAM_RED ? battlefield->redHQUnit : battlefield->blueHQUnit;
+}
+
+// 获取装备类型在本战场上的造价（参数扫描可以为每个战场单独指定造价，不修改全局的装备类型）
+static inline int getEquipmentCost(const Battlefield* battlefield, const EquipmentType* type) {
+    if (battlefield->typeCosts && type->typeId >= 0 && type->typeId < battlefield->typeCostCount) {
+        return battlefield->typeCosts[type->typeId];
+    }
+    return type->cost;
+}
+
+// 获取敌对队伍
+static inline Team getEnemyTeam(Team team) {
+    return team == TEAM_RED ? TEAM_BLUE : TEAM_RED;
+}
+
+// 检查位置是否在战场范围内
+static inline int isPositionValid(const Battlefield* battlefield, int x, int y) {
+    return (unsigned)x < (unsigned)battlefield->width && (unsigned)y < (unsigned)battlefield->height;
+}
+
+// 获取战场格子（调用者需保证位置有效）
+static inline Cell getCell(const Battlefield* battlefield, int x, int y) {
+    return battlefield->cells[y * battlefield->width + x];
+}
+
+// 记录(x, y)所在块中team一方的装备有变化（调用者需保证位置有效）
+static inline void markCellChanged(Battlefield* battlefield, int x, int y, Team team) {
+    int block = (y >> CELL_BLOCK_SHIFT) * battlefield->blockColumns + (x >> CELL_BLOCK_SHIFT);
+    battlefield->blockEpochs[(block << 1) | (team == TEAM_BLUE ? 1 : 0)] = ++battlefield->cellEpoch;
+}
+
+// 生成指定队伍中下标为index的装备的格子编码
+static inline Cell makeCell(Team team, int index) {
+    return (((Cell)index << 1) | (team == TEAM_BLUE ? 1u : 0u)) + 1u;
+}
+
+// 获取占据格子的装备所属队伍（格子非空时有效）
+static inline Team getCellTeam(Cell cell) {
+    return ((cell - 1u) & 1u) ? TEAM_BLUE : TEAM_RED;
+}
+
+// 获取占据格子的装备在本方单元存储中的下标（格子非空时有效）
+static inline int getCellUnit(Cell cell) {
+    return (int)((cell - 1u) >> 1);
+}
+
+// 设置战场格子（调用者需保证位置有效）
+// 同时按放入或移走的装备所属的队伍记录格子块的变化，攻击目标缓存据此判断附近的敌方装备是否有变化
+static inline void setCell(Battlefield* battlefield, int x, int y, Cell cell) {
+    Cell* slot = &battlefield->cells[y * battlefield->width + x];
+    Cell changed = cell ? cell : *slot;
+    *slot = cell;
+    if (changed) {
+        markCellChanged(battlefield, x, y, getCellTeam(changed));
+    }
+}
+
+// 获取格子状态
+static inline CellStatus getCellStatus(Cell cell) {
+    if (cell == 0) {
+        return CELL_EMPTY;
+    }
+    return getCellTeam(cell) == TEAM_RED ? CELL_OCCUPIED_RED : CELL_OCCUPIED_BLUE;
+}
+
+// 检查格子是否被任意一方的装备占用（调用者需保证位置有效）
+static inline int isCellOccupied(const Battlefield* battlefield, int x, int y) {
+    return bitboardTest(&battlefield->redOccupancy, x, y) | bitboardTest(&battlefield->blueOccupancy, x, y);
+}
+
+// 获取占据格子的装备的Equipment视图，空格子返回NULL
+static inline Equipment* getCellEquipment(Battlefield* battlefield, Cell cell) {
+    if (cell == 0) {
+        return NULL;
+    }
+    return &getTeamUnits(battlefield, getCellTeam(cell))->views[getCellUnit(cell)];
+}
+
+// 初始化战场（战场自己创建内存池），成功返回1，内存分配失败返回0
+int initBattlefield(Battlefield* battlefield, int width, int height);
+
+// 在调用者提供的内存池中初始化战场，战斗结束后由调用者重置内存池
+// 批量对抗时每个线程复用同一个内存池，稳定后不再有堆分配
+// 成功返回1，内存分配失败返回0
+int initBattlefieldInArena(Battlefield* battlefield, int width, int height, Arena* arena);
+
+// 初始化战场，每方的单元存储预留unitCapacity个装备的容量（之后按需扩大），arena为NULL时战场自己创建内存池
+// 预算和装备数量上限取自g_battlefieldConfig
+// 成功返回1；内存分配失败时释放已分配的部分并返回0，此时战场不可使用（可以再调用freeBattlefield）
+int initBattlefieldWithCapacity(Battlefield* battlefield, int width, int height, int unitCapacity, Arena* arena);
 
 // 释放战场资源
 void freeBattlefield(Battlefield* battlefield);
@@ -41,26 +237,87 @@ void freeBattlefield(Battlefield* battlefield);
 // 部署装备到战场
 int deployEquipment(Battlefield* battlefield, Team team);
 
+// 释放部署方案资源
+void freeDeployment(Deployment* deployment);
+
 // 渲染战场
 // viewOnly参数如果不是TEAM_NONE，则只显示指定队伍的装备
 void renderBattlefield(Battlefield* battlefield, Team viewOnly);
 
-// 向战场添加装备
+// 显示战场状态、预算和双方大本营血量（共BATTLEFIELD_HEADER_LINES行）
+void renderBattlefieldHeader(Battlefield* battlefield, TextBuffer* out);
+
+// 显示坐标标题和上边框（共BATTLEFIELD_GRID_HEADER_LINES行）
+void renderGridHeader(Battlefield* battlefield, TextBuffer* out);
+
+// 显示一行边框
+void renderGridBorder(Battlefield* battlefield, TextBuffer* out);
+
+// 显示一行格子前的Y坐标
+void renderGridRowLabel(int y, TextBuffer* out);
+
+// 显示双方装备列表，最多maxLines行（<=0表示不限制），超出的装备只显示数量
+void renderUnitList(Battlefield* battlefield, Team viewOnly, int maxLines, TextBuffer* out);
+
+// 根据控制台高度计算装备列表可用的行数，输出不是控制台时返回0（不限制）
+int getUnitListMaxLines(Battlefield* battlefield);
+
+// 合成战场图中每个格子显示的字符（装备、方向指示或空格），按行写入chars
+// 一次遍历双方装备完成，arrowRanks为同样大小的临时数组
+void composeBattlefieldGrid(Battlefield* battlefield, Team viewOnly, char* chars, unsigned char* arrowRanks);
+
+// 检查装备能否部署到战场上（位置有效、在本方半场、格子空闲、类型有效、预算和数量未超限）
+// 可以部署时返回NULL，否则返回原因
+const char* checkEquipmentPlacement(Battlefield* battlefield, const Equipment* equipment);
+
+// 向战场添加装备（按checkEquipmentPlacement的规则检查，并扣除预算）
+// 装备数据被复制到本方单元存储中，调用者仍负责释放传入的equipment
 int addEquipmentToBattlefield(Battlefield* battlefield, Equipment* equipment);
 
-// 从战场移除装备
+// 把装备直接放到战场上，不检查半场、预算和数量上限（用于恢复已有的战场状态）
+// 已被摧毁的装备（isActive为0）只追加到单元存储中；调用者需保证位置有效且为空
+// 返回装备在本方单元存储中的下标，内存分配失败时返回-1（战场保持不变）
+int placeUnitOnBattlefield(Battlefield* battlefield, const Equipment* equipment);
+
+// 从战场移除装备（equipment为战场单元存储中的Equipment视图）
 int removeEquipmentFromBattlefield(Battlefield* battlefield, Equipment* equipment);
 
-// 获取战场格子
-Cell* getCell(Battlefield* battlefield, int x, int y);
+// 从战场移除指定队伍中下标为index的装备
+int removeUnitFromBattlefield(Battlefield* battlefield, Team team, int index);
 
-// 检查位置是否在战场范围内
-int isPositionValid(Battlefield* battlefield, int x, int y);
+// 把指定队伍中下标为index的装备移动到空格子(newX, newY)，同时更新格子、空间索引和占用位图
+// 成功返回1，空间索引内存分配失败时装备不移动，返回0
+int moveUnitOnBattlefield(Battlefield* battlefield, Team team, int index, int newX, int newY);
+
+// 统计矩形[x1, x2] x [y1, y2]内指定队伍的装备数量
+int countTeamUnitsInRect(Battlefield* battlefield, Team team, int x1, int y1, int x2, int y2);
+
+// 检查从(x1, y1)到(x2, y2)的直线上（不含起点，含终点）是否有任意一方的装备
+int isSegmentOccupied(Battlefield* battlefield, int x1, int y1, int x2, int y2);
+
+// 用结构数组中的数据刷新双方所有装备的Equipment视图
+void syncEquipmentViews(Battlefield* battlefield);
 
 // 检查位置是否在本方半场
 int isPositionInOwnHalf(Battlefield* battlefield, int x, int y, Team team);
 
-// 检查是否有路径障碍
+// 检查从(x1, y1)向(x2, y2)的射击是否被栅栏挡住（整数Bresenham直线，不含两端的格子），被挡住返回1
+// ignoreFlying不为0时（射击方或目标会飞）不受阻挡；统计记录到battlefield->stats中，只应在调用者线程中使用
 int hasPathObstacle(Battlefield* battlefield, int x1, int y1, int x2, int y2, int ignoreFlying);
 
+// 成批检查从(x, y)向count个目标(xs[i], ys[i])的射击是否被栅栏挡住，结果写入blocked[i]，返回被挡住的数量
+// 规则与hasPathObstacle相同（调用者自行排除飞行装备）；统计记录到stats中（NULL表示不统计），可以在多个线程上同时调用
+int findPathObstacles(Battlefield* battlefield, int x, int y, const int* xs, const int* ys, int count,
+                      unsigned char* blocked, BattleStats* stats);
+
+// 检查(x, y)周围radius范围内（正方形，闭区间）team一方的装备在计数为epoch之后是否有变化
+// 按块检查，块内任一格子变化都算；栅栏的变化同时记录在双方
+int hasCellsChangedSince(const Battlefield* battlefield, Team team, int x, int y, int radius, unsigned long long epoch);
+
+// 把所有格子块标记为已变化（整体替换格子数组之后调用，使所有攻击目标缓存失效）
+void invalidateCellEpochs(Battlefield* battlefield);
+
+// 检查(x, y)周围radius范围内（正方形，闭区间）是否有栅栏，没有时范围内的射击都不会被挡住
+int hasFenceNear(Battlefield* battlefield, int x, int y, int radius);
+
 #endif // BATTLEFIELD_H 
\ No newline at end of file
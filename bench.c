@@ -0,0 +1,507 @@
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "battlefield.h"
+#include "equipment.h"
+#include "simulation.h"
+#include "scenario.h"
+#include "snapshot.h"
+
+// 性能测试
+// 微基准测试单独测量引擎中的热点函数，场景测试在几个标准想定上测量simulateStep的每步耗时。
+// 所有想定都由固定种子生成，同样的代码每次运行的操作序列完全相同，分配次数可以逐项精确比较。
+// 结果以CSV格式写入文件，每个测试项一行：
+//   benchmark,ops,ns_per_op,ticks_per_sec,allocs_per_op,mallocs_per_op
+// ops为计时期间完成的操作数，ns_per_op取最快一轮的平均值；场景测试的一次操作是一步模拟，ticks_per_sec只对场景测试有意义（其余为0）；
+// allocs_per_op为每次操作在战场内存池中的分配次数，mallocs_per_op为内存池因此向系统申请内存块的次数。
+// 用--compare与保存的基准结果比较时，耗时超出阈值或分配次数增加的测试项记为退化，程序返回1
+
+#define DEFAULT_RESULTS_FILE "bench_results.csv"
+#define DEFAULT_MIN_TIME 0.3
+#define DEFAULT_THRESHOLD 10.0
+#define DEFAULT_SEED 1
+
+// 场景测试每轮从初始状态开始模拟的步数（每轮之间恢复初始状态，不计时）
+#define STEP_TICKS_PER_ROUND 10
+
+// 标准想定中每方半场的格子数与装备数之比（与压力测试相同）
+#define BENCH_CELLS_PER_UNIT 4
+
+// 预热时的计时下限，任何大于0的值都只运行一轮
+#define WARMUP_MIN_TIME 1e-9
+
+// 微基准测试中每轮遍历所有装备类型对的次数（装备类型很少，一遍的耗时远小于计时精度）
+#define GET_INTERACTION_PASSES 1000
+
+// 微基准测试中checkVictory每轮的调用次数
+#define CHECK_VICTORY_CALLS 1000
+
+// 基准结果文件最多的测试项数
+#define MAX_BASELINE_ENTRIES 256
+
+// 测试项的结果
+typedef struct {
+    char name[64];
+    long long ops;
+    double nsPerOp;
+    double ticksPerSecond;
+    double allocsPerOp;
+    double mallocsPerOp;
+} BenchResult;
+
+// 测试用的战场：由随机想定部署，并保存初始状态的快照，每轮测试前恢复
+typedef struct {
+    Battlefield battlefield;
+    BattlefieldSnapshot start;
+} BenchFixture;
+
+// 计时器：只累计startTimer和stopTimer之间（一轮）的时间和内存池分配次数
+typedef struct {
+    Arena* arena;
+    double startTime;
+    unsigned long long startAllocations;
+    unsigned long long startChunks;
+    double elapsed;
+    long long ops;
+    double bestNsPerOp;         // 最快一轮的每次操作耗时（受其他进程干扰最小，作为结果）
+    unsigned long long allocations;
+    unsigned long long chunks;
+} BenchTimer;
+
+// 运行参数
+typedef struct {
+    double minTime;             // 每个测试项至少计时的秒数
+    unsigned long long seed;
+    const char* filter;         // 只运行名称包含该字符串的测试项（NULL表示全部）
+} BenchOptions;
+
+// 测试项的实现：在fixture上反复运行，直到计时达到minTime；恢复初始状态失败时中止并返回0，否则返回1
+typedef int (*BenchFunction)(BenchFixture* fixture, BenchTimer* timer, double minTime);
+
+// 测试项
+typedef struct {
+    const char* name;
+    int width, height;          // 战场尺寸，0表示按装备数和标准密度计算
+    int unitsPerSide;
+    TickMode tickMode;
+    BenchFunction function;
+} Benchmark;
+
+// 防止被测函数的返回值被优化掉
+static volatile uintptr_t g_benchSink;
+
+// 获取当前时间（秒）
+static double getTimeSeconds(void) {
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void startTimer(BenchTimer* timer) {
+    timer->startAllocations = timer->arena->allocationCount;
+    timer->startChunks = timer->arena->chunkCount;
+    timer->startTime = getTimeSeconds();
+}
+
+static void stopTimer(BenchTimer* timer, long long ops) {
+    double elapsed = getTimeSeconds() - timer->startTime;
+    if (ops > 0 && (timer->bestNsPerOp == 0.0 || elapsed * 1e9 / ops < timer->bestNsPerOp)) {
+        timer->bestNsPerOp = elapsed * 1e9 / ops;
+    }
+    timer->elapsed += elapsed;
+    timer->ops += ops;
+    timer->allocations += timer->arena->allocationCount - timer->startAllocations;
+    timer->chunks += timer->arena->chunkCount - timer->startChunks;
+}
+
+// 恢复测试战场的初始状态，内存分配失败时返回0（此时战场状态不完整，不能继续计时）
+static int resetFixture(BenchFixture* fixture) {
+    return restoreBattlefield(&fixture->battlefield, &fixture->start);
+}
+
+// 按标准密度计算容纳每方unitsPerSide个装备的战场尺寸
+static void getStandardMapSize(int unitsPerSide, int* width, int* height) {
+    long long cells = (long long)unitsPerSide * BENCH_CELLS_PER_UNIT;
+    *height = (int)sqrt((double)cells);
+    if (*height < 1) {
+        *height = 1;
+    }
+    *width = 2 * (int)((cells + *height - 1) / *height);
+}
+
+// 生成随机想定并部署到测试战场，成功返回1
+static int setupFixture(BenchFixture* fixture, const Benchmark* benchmark, unsigned long long seed) {
+    int width = benchmark->width;
+    int height = benchmark->height;
+    if (width <= 0 || height <= 0) {
+        getStandardMapSize(benchmark->unitsPerSide, &width, &height);
+    }
+
+    Rng rng;
+    rngSeed(&rng, seed, 0);
+    Scenario scenario;
+    if (!generateScenario(&scenario, width, height, benchmark->unitsPerSide, &rng)) {
+        return 0;
+    }
+
+    Battlefield* battlefield = &fixture->battlefield;
+    if (!initBattlefieldWithCapacity(battlefield, width, height, getScenarioCapacity(&scenario), NULL)) {
+        printf("内存分配失败（战场 %dx%d）\n", width, height);
+        freeScenario(&scenario);
+        return 0;
+    }
+    battlefield->headless = 1;
+    battlefield->tickMode = benchmark->tickMode;
+    applyScenario(battlefield, &scenario);
+    rngSeed(&battlefield->rng, seed, 1);
+    freeScenario(&scenario);
+
+    initBattlefieldSnapshot(&fixture->start);
+    if (!snapshotBattlefield(battlefield, &fixture->start)) {
+        freeBattlefield(battlefield);
+        return 0;
+    }
+    return 1;
+}
+
+static void freeFixture(BenchFixture* fixture) {
+    freeBattlefieldSnapshot(&fixture->start);
+    freeBattlefield(&fixture->battlefield);
+}
+
+// 一次操作：所有存活装备各查找一次最近的敌方装备
+static int benchFindNearestEnemy(BenchFixture* fixture, BenchTimer* timer, double minTime) {
+    Battlefield* battlefield = &fixture->battlefield;
+    while (timer->elapsed < minTime) {
+        long long ops = 0;
+        uintptr_t sink = 0;
+        startTimer(timer);
+        for (int team = TEAM_RED; team <= TEAM_BLUE; team++) {
+            UnitStore* units = getTeamUnits(battlefield, (Team)team);
+            for (int i = 0; i < units->count; i++) {
+                if (units->alive[i]) {
+                    sink += (uintptr_t)findNearestEnemy(battlefield, &units->views[i]);
+                    ops++;
+                }
+            }
+        }
+        stopTimer(timer, ops);
+        g_benchSink = sink;
+    }
+    return 1;
+}
+
+// 一次操作：一个装备移动一次（每轮从初始状态开始，所有存活装备依次移动）
+static int benchHandleMovement(BenchFixture* fixture, BenchTimer* timer, double minTime) {
+    Battlefield* battlefield = &fixture->battlefield;
+    while (timer->elapsed < minTime) {
+        if (!resetFixture(fixture)) {
+            return 0;
+        }
+        long long ops = 0;
+        startTimer(timer);
+        for (int team = TEAM_RED; team <= TEAM_BLUE; team++) {
+            UnitStore* units = getTeamUnits(battlefield, (Team)team);
+            for (int i = 0; i < units->count; i++) {
+                if (units->alive[i]) {
+                    handleMovement(battlefield, &units->views[i]);
+                    ops++;
+                }
+            }
+        }
+        stopTimer(timer, ops);
+    }
+    return 1;
+}
+
+// 一次操作：一个装备攻击一次（每轮从初始状态开始，所有存活装备依次攻击）
+static int benchHandleAttack(BenchFixture* fixture, BenchTimer* timer, double minTime) {
+    Battlefield* battlefield = &fixture->battlefield;
+    while (timer->elapsed < minTime) {
+        if (!resetFixture(fixture)) {
+            return 0;
+        }
+        long long ops = 0;
+        startTimer(timer);
+        for (int team = TEAM_RED; team <= TEAM_BLUE; team++) {
+            UnitStore* units = getTeamUnits(battlefield, (Team)team);
+            for (int i = 0; i < units->count; i++) {
+                if (units->alive[i]) {
+                    handleAttack(battlefield, &units->views[i]);
+                    ops++;
+                }
+            }
+        }
+        stopTimer(timer, ops);
+    }
+    return 1;
+}
+
+// 一次操作：查询一对装备类型的交互数据（每轮遍历所有类型对GET_INTERACTION_PASSES遍）
+static int benchGetInteraction(BenchFixture* fixture, BenchTimer* timer, double minTime) {
+    (void)fixture;
+    while (timer->elapsed < minTime) {
+        long long ops = 0;
+        uintptr_t sink = 0;
+        startTimer(timer);
+        for (int pass = 0; pass < GET_INTERACTION_PASSES; pass++) {
+            for (int a = 0; a < g_equipmentTypesCount; a++) {
+                for (int d = 0; d < g_equipmentTypesCount; d++) {
+                    sink += (uintptr_t)getInteraction(g_equipmentTypes[a].typeId, g_equipmentTypes[d].typeId);
+                    ops++;
+                }
+            }
+        }
+        stopTimer(timer, ops);
+        g_benchSink = sink;
+    }
+    return 1;
+}
+
+// 一次操作：一次胜负检查
+static int benchCheckVictory(BenchFixture* fixture, BenchTimer* timer, double minTime) {
+    Battlefield* battlefield = &fixture->battlefield;
+    while (timer->elapsed < minTime) {
+        uintptr_t sink = 0;
+        startTimer(timer);
+        for (int i = 0; i < CHECK_VICTORY_CALLS; i++) {
+            sink += (uintptr_t)checkVictory(battlefield);
+        }
+        stopTimer(timer, CHECK_VICTORY_CALLS);
+        g_benchSink = sink;
+    }
+    return 1;
+}
+
+// 一次操作：一步模拟（每轮从初始状态开始模拟STEP_TICKS_PER_ROUND步，战斗提前结束时开始下一轮）
+static int benchSimulateStep(BenchFixture* fixture, BenchTimer* timer, double minTime) {
+    Battlefield* battlefield = &fixture->battlefield;
+    while (timer->elapsed < minTime) {
+        if (!resetFixture(fixture)) {
+            return 0;
+        }
+        long long ticks = 0;
+        startTimer(timer);
+        while (ticks < STEP_TICKS_PER_ROUND) {
+            ticks++;
+            if (simulateStep(battlefield)) {
+                break;
+            }
+        }
+        stopTimer(timer, ticks);
+    }
+    return 1;
+}
+
+// 全部测试项：微基准测试使用每方500个装备的标准想定
+static const Benchmark g_benchmarks[] = {
+    { "find_nearest_enemy", 0, 0, 500, TICK_SEQUENTIAL, benchFindNearestEnemy },
+    { "handle_movement",    0, 0, 500, TICK_SEQUENTIAL, benchHandleMovement },
+    { "handle_attack",      0, 0, 500, TICK_SEQUENTIAL, benchHandleAttack },
+    { "get_interaction",    0, 0, 500, TICK_SEQUENTIAL, benchGetInteraction },
+    { "check_victory",      0, 0, 500, TICK_SEQUENTIAL, benchCheckVictory },
+    { "step_10_units",      80, 60, 5, TICK_SEQUENTIAL, benchSimulateStep },
+    { "step_1k_units",      0, 0, 500, TICK_SEQUENTIAL, benchSimulateStep },
+    { "step_1k_units_two_phase", 0, 0, 500, TICK_TWO_PHASE, benchSimulateStep },
+    { "step_100k_units",    0, 0, 50000, TICK_SEQUENTIAL, benchSimulateStep },
+    { "step_small_map",     16, 12, 24, TICK_SEQUENTIAL, benchSimulateStep },
+    { "step_huge_map",      4000, 4000, 500, TICK_SEQUENTIAL, benchSimulateStep },
+};
+
+#define BENCHMARK_COUNT ((int)(sizeof(g_benchmarks) / sizeof(g_benchmarks[0])))
+
+// 运行一个测试项，成功返回1
+static int runBenchmark(const Benchmark* benchmark, const BenchOptions* options, BenchResult* result) {
+    BenchFixture fixture;
+    if (!setupFixture(&fixture, benchmark, options->seed)) {
+        printf("无法准备测试 %s\n", benchmark->name);
+        return 0;
+    }
+
+    // 先不计入结果地运行一轮，让内存池和各缓冲区扩大到稳定的容量，
+    // 之后每轮的操作完全相同，分配次数与运行的轮数无关
+    BenchTimer timer;
+    memset(&timer, 0, sizeof(timer));
+    timer.arena = fixture.battlefield.arena;
+    int ok = benchmark->function(&fixture, &timer, WARMUP_MIN_TIME);
+
+    memset(&timer, 0, sizeof(timer));
+    timer.arena = fixture.battlefield.arena;
+    ok = ok && benchmark->function(&fixture, &timer, options->minTime);
+    freeFixture(&fixture);
+    if (!ok) {
+        printf("测试 %s 无法恢复初始状态（内存分配失败），已中止\n", benchmark->name);
+        return 0;
+    }
+
+    snprintf(result->name, sizeof(result->name), "%s", benchmark->name);
+    result->ops = timer.ops;
+    result->nsPerOp = timer.bestNsPerOp;
+    result->ticksPerSecond = benchmark->function == benchSimulateStep && timer.bestNsPerOp > 0 ? 1e9 / timer.bestNsPerOp : 0.0;
+    result->allocsPerOp = timer.ops > 0 ? (double)timer.allocations / timer.ops : 0.0;
+    result->mallocsPerOp = timer.ops > 0 ? (double)timer.chunks / timer.ops : 0.0;
+    return 1;
+}
+
+// 按CSV格式写入结果
+static void writeBenchResults(const BenchResult* results, int count, FILE* file) {
+    fprintf(file, "benchmark,ops,ns_per_op,ticks_per_sec,allocs_per_op,mallocs_per_op\n");
+    for (int i = 0; i < count; i++) {
+        fprintf(file, "%s,%lld,%.3f,%.3f,%.6f,%.6f\n", results[i].name, results[i].ops, results[i].nsPerOp,
+                results[i].ticksPerSecond, results[i].allocsPerOp, results[i].mallocsPerOp);
+    }
+}
+
+// 读取保存的基准结果，返回测试项数，文件无法打开时返回-1
+static int readBenchResults(const char* filename, BenchResult* results, int maxCount) {
+    FILE* file = fopen(filename, "r");
+    if (!file) {
+        return -1;
+    }
+
+    char line[256];
+    int count = 0;
+    while (count < maxCount && fgets(line, sizeof(line), file)) {
+        BenchResult* result = &results[count];
+        if (sscanf(line, "%63[^,],%lld,%lf,%lf,%lf,%lf", result->name, &result->ops, &result->nsPerOp,
+                   &result->ticksPerSecond, &result->allocsPerOp, &result->mallocsPerOp) == 6) {
+            count++;
+        }
+    }
+    fclose(file);
+    return count;
+}
+
+// 与基准结果比较并显示每个测试项的变化，返回退化的测试项数
+// 耗时超出基准threshold%记为变慢；分配次数是确定的，超过基准即记为退化
+static int compareBenchResults(const BenchResult* results, int count, const BenchResult* baseline, int baselineCount,
+                               double threshold) {
+    int regressions = 0;
+    printf("\n%-26s %12s %12s %8s  %s\n", "测试项", "基准(ns/op)", "当前(ns/op)", "变化", "结论");
+    for (int i = 0; i < count; i++) {
+        const BenchResult* base = NULL;
+        for (int j = 0; j < baselineCount; j++) {
+            if (strcmp(baseline[j].name, results[i].name) == 0) {
+                base = &baseline[j];
+                break;
+            }
+        }
+        if (!base) {
+            printf("%-26s %12s %12.1f %8s  新增\n", results[i].name, "-", results[i].nsPerOp, "-");
+            continue;
+        }
+
+        double change = base->nsPerOp > 0 ? (results[i].nsPerOp / base->nsPerOp - 1.0) * 100.0 : 0.0;
+        const char* verdict = "持平";
+        if (results[i].allocsPerOp > base->allocsPerOp + 1e-9 || results[i].mallocsPerOp > base->mallocsPerOp + 1e-9) {
+            verdict = "退化（分配次数增加）";
+            regressions++;
+        } else if (change > threshold) {
+            verdict = "退化（变慢）";
+            regressions++;
+        } else if (change < -threshold) {
+            verdict = "变快";
+        }
+        printf("%-26s %12.1f %12.1f %+7.1f%%  %s\n", results[i].name, base->nsPerOp, results[i].nsPerOp, change, verdict);
+    }
+    return regressions;
+}
+
+// 显示用法说明
+static void printUsage(const char* program) {
+    printf("用法: %s [选项]\n", program);
+    printf("选项:\n");
+    printf("  --output F      结果文件 (CSV格式，默认 %s，- 表示输出到屏幕)\n", DEFAULT_RESULTS_FILE);
+    printf("  --compare F     与保存的基准结果F比较，有退化的测试项时返回1 (F不存在时跳过比较)\n");
+    printf("  --threshold P   耗时超出基准P%%记为退化 (默认 %.0f)\n", DEFAULT_THRESHOLD);
+    printf("  --min-time S    每个测试项至少计时S秒 (默认 %.1f)\n", DEFAULT_MIN_TIME);
+    printf("  --filter S      只运行名称包含S的测试项\n");
+    printf("  --seed S        生成想定的随机数种子 (默认 %d，比较时应与基准相同)\n", DEFAULT_SEED);
+    printf("  --types F       装备类型文件 (默认 equipment_types.txt)\n");
+    printf("  --interactions F 装备交互文件 (默认 equipment_interactions.txt)\n");
+}
+
+int main(int argc, char* argv[]) {
+    const char* outputFile = DEFAULT_RESULTS_FILE;
+    const char* compareFile = NULL;
+    const char* typesFile = "equipment_types.txt";
+    const char* interactionsFile = "equipment_interactions.txt";
+    double threshold = DEFAULT_THRESHOLD;
+    BenchOptions options = { DEFAULT_MIN_TIME, DEFAULT_SEED, NULL };
+
+    // 解析命令行参数
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--output") == 0 && i + 1 < argc) {
+            outputFile = argv[++i];
+        } else if (strcmp(argv[i], "--compare") == 0 && i + 1 < argc) {
+            compareFile = argv[++i];
+        } else if (strcmp(argv[i], "--threshold") == 0 && i + 1 < argc) {
+            threshold = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--min-time") == 0 && i + 1 < argc) {
+            options.minTime = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--filter") == 0 && i + 1 < argc) {
+            options.filter = argv[++i];
+        } else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            options.seed = strtoull(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--types") == 0 && i + 1 < argc) {
+            typesFile = argv[++i];
+        } else if (strcmp(argv[i], "--interactions") == 0 && i + 1 < argc) {
+            interactionsFile = argv[++i];
+        } else {
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (!loadEquipmentTypes(typesFile) || !loadEquipmentInteractions(interactionsFile)) {
+        freeEquipmentTypes();
+        return 1;
+    }
+
+    BenchResult results[BENCHMARK_COUNT];
+    int count = 0;
+    for (int i = 0; i < BENCHMARK_COUNT; i++) {
+        if (options.filter && !strstr(g_benchmarks[i].name, options.filter)) {
+            continue;
+        }
+        if (!runBenchmark(&g_benchmarks[i], &options, &results[count])) {
+            freeEquipmentTypes();
+            return 1;
+        }
+        printf("%-26s %12.1f ns/op  %10.6f 次分配/op\n", results[count].name, results[count].nsPerOp,
+               results[count].allocsPerOp);
+        fflush(stdout);
+        count++;
+    }
+    freeEquipmentTypes();
+
+    FILE* output = strcmp(outputFile, "-") == 0 ? stdout : fopen(outputFile, "w");
+    if (!output) {
+        printf("无法写入结果文件: %s\n", outputFile);
+        return 1;
+    }
+    writeBenchResults(results, count, output);
+    if (output != stdout) {
+        fclose(output);
+        printf("结果文件: %s\n", outputFile);
+    }
+
+    if (!compareFile) {
+        return 0;
+    }
+    BenchResult baseline[MAX_BASELINE_ENTRIES];
+    int baselineCount = readBenchResults(compareFile, baseline, MAX_BASELINE_ENTRIES);
+    if (baselineCount < 0) {
+        printf("基准结果 %s 不存在，跳过比较（用 make bench-baseline 保存基准结果）\n", compareFile);
+        return 0;
+    }
+    int regressions = compareBenchResults(results, count, baseline, baselineCount, threshold);
+    if (regressions > 0) {
+        printf("%d 个测试项退化\n", regressions);
+        return 1;
+    }
+    printf("没有退化的测试项\n");
+    return 0;
+}
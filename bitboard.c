@@ -0,0 +1,167 @@
+#include "bitboard.h"
+
+// 统计一个字中被置位的位数
+static int countBits(uint64_t word) {
+#if defined(__GNUC__)
+    return __builtin_popcountll(word);
+#else
+    int count = 0;
+    while (word) {
+        word &= word - 1;
+        count++;
+    }
+    return count;
+#endif
+}
+
+// 读取第row行第index个字（other不为NULL时取并集）
+static uint64_t loadWord(const Bitboard* board, const Bitboard* other, int row, int index) {
+    int offset = row * board->wordsPerRow + index;
+    uint64_t word = board->words[offset];
+    if (other) {
+        word |= other->words[offset];
+    }
+    return word;
+}
+
+// 一个字内第from位到第to位（闭区间）的掩码
+static uint64_t rangeMask(int from, int to) {
+    uint64_t high = to >= 63 ? ~(uint64_t)0 : (((uint64_t)1 << (to + 1)) - 1);
+    return high & ~(((uint64_t)1 << from) - 1);
+}
+
+// 初始化位图
+int initBitboard(Bitboard* board, int width, int height, Arena* arena) {
+    board->width = width;
+    board->height = height;
+    board->wordsPerRow = (width + 63) / 64;
+    board->words = (uint64_t*)arenaCalloc(arena, (size_t)board->wordsPerRow * height, sizeof(uint64_t));
+    return board->words != NULL;
+}
+
+// 把矩形裁剪到位图范围内，矩形为空时返回0
+static int clipRect(const Bitboard* board, int* x1, int* y1, int* x2, int* y2) {
+    if (*x1 > *x2) { int t = *x1; *x1 = *x2; *x2 = t; }
+    if (*y1 > *y2) { int t = *y1; *y1 = *y2; *y2 = t; }
+    if (*x1 < 0) *x1 = 0;
+    if (*y1 < 0) *y1 = 0;
+    if (*x2 >= board->width) *x2 = board->width - 1;
+    if (*y2 >= board->height) *y2 = board->height - 1;
+    return *x1 <= *x2 && *y1 <= *y2;
+}
+
+// 统计一行中[x1, x2]范围内被置位的格子数量，stopAtFirst不为0时找到一个即返回
+static int countRowRange(const Bitboard* board, const Bitboard* other, int row, int x1, int x2, int stopAtFirst) {
+    int firstWord = x1 >> 6;
+    int lastWord = x2 >> 6;
+    int count = 0;
+
+    for (int w = firstWord; w <= lastWord; w++) {
+        uint64_t word = loadWord(board, other, row, w);
+        int from = (w == firstWord) ? (x1 & 63) : 0;
+        int to = (w == lastWord) ? (x2 & 63) : 63;
+        word &= rangeMask(from, to);
+        if (word) {
+            if (stopAtFirst) {
+                return 1;
+            }
+            count += countBits(word);
+        }
+    }
+    return count;
+}
+
+// 统计矩形内被置位的格子数量
+int bitboardCountRect(const Bitboard* board, const Bitboard* other, int x1, int y1, int x2, int y2) {
+    if (!clipRect(board, &x1, &y1, &x2, &y2)) {
+        return 0;
+    }
+
+    int count = 0;
+    for (int row = y1; row <= y2; row++) {
+        count += countRowRange(board, other, row, x1, x2, 0);
+    }
+    return count;
+}
+
+// 检查矩形内是否有被置位的格子
+int bitboardAnyInRect(const Bitboard* board, const Bitboard* other, int x1, int y1, int x2, int y2) {
+    if (!clipRect(board, &x1, &y1, &x2, &y2)) {
+        return 0;
+    }
+
+    for (int row = y1; row <= y2; row++) {
+        if (countRowRange(board, other, row, x1, x2, 1)) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// 检查一行中[x1, x2]范围内是否有被置位的格子，超出位图的部分自动裁掉
+static int anyInRow(const Bitboard* board, const Bitboard* other, int row, int x1, int x2) {
+    if ((unsigned)row >= (unsigned)board->height) {
+        return 0;
+    }
+    if (x1 < 0) x1 = 0;
+    if (x2 >= board->width) x2 = board->width - 1;
+    if (x1 > x2) {
+        return 0;
+    }
+    if (x1 == x2) {
+        return (int)((loadWord(board, other, row, x1 >> 6) >> (x1 & 63)) & 1);
+    }
+    return countRowRange(board, other, row, x1, x2, 1);
+}
+
+// 检查Bresenham直线上（不含起点，includeEnd为0时也不含终点）是否有被置位的格子
+// 直线在每一行经过的格子是连续的一段，逐格走完一行后整段按字检查，平缓的长直线每行只读一两个字
+static int anyOnLine(const Bitboard* board, const Bitboard* other, int x1, int y1, int x2, int y2, int includeEnd) {
+    if (x1 == x2 && y1 == y2) {
+        return 0;
+    }
+
+    // 水平线段：直接得到整段范围
+    if (y1 == y2) {
+        int from = x1 < x2 ? x1 + 1 : (includeEnd ? x2 : x2 + 1);
+        int to = x1 < x2 ? (includeEnd ? x2 : x2 - 1) : x1 - 1;
+        return anyInRow(board, other, y1, from, to);
+    }
+
+    LineWalk line;
+    initLineWalk(&line, x1, y1, x2, y2);
+    int runY = y1;
+    int runFrom = 1;
+    int runTo = 0;      // 当前行的范围，起点不检查，开始时为空
+    while (lineWalkStep(&line)) {
+        if (!includeEnd && line.x == x2 && line.y == y2) {
+            break;
+        }
+        if (line.y != runY) {
+            if (runFrom <= runTo && anyInRow(board, other, runY, runFrom, runTo)) {
+                return 1;
+            }
+            runY = line.y;
+            runFrom = line.x;
+            runTo = line.x;
+        } else if (runFrom > runTo) {
+            runFrom = line.x;
+            runTo = line.x;
+        } else if (line.x < runFrom) {
+            runFrom = line.x;
+        } else if (line.x > runTo) {
+            runTo = line.x;
+        }
+    }
+    return runFrom <= runTo && anyInRow(board, other, runY, runFrom, runTo);
+}
+
+// 检查线段上是否有被置位的格子
+int bitboardAnyOnSegment(const Bitboard* board, const Bitboard* other, int x1, int y1, int x2, int y2) {
+    return anyOnLine(board, other, x1, y1, x2, y2, 1);
+}
+
+// 检查线段中间是否有被置位的格子
+int bitboardAnyBetween(const Bitboard* board, const Bitboard* other, int x1, int y1, int x2, int y2) {
+    return anyOnLine(board, other, x1, y1, x2, y2, 0);
+}
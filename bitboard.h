@@ -0,0 +1,91 @@
+#ifndef BITBOARD_H
+#define BITBOARD_H
+
+#include <stdint.h>
+#include "arena.h"
+
+// 占用位图：每个格子1位，按行存储，每行补齐到64位字的整数倍
+// 查询按64位字并行处理，一次判断或统计一整段格子
+typedef struct {
+    int width;              // 宽度（格子数）
+    int height;             // 高度（格子数）
+    int wordsPerRow;        // 每行的字数
+    uint64_t* words;        // 位数据
+} Bitboard;
+
+// 初始化位图（全部清零），位数据从内存池中分配，随内存池一起释放
+// 成功返回1，内存分配失败返回0
+int initBitboard(Bitboard* board, int width, int height, Arena* arena);
+
+// 设置(x, y)对应的位（调用者需保证位置有效）
+static inline void bitboardSet(Bitboard* board, int x, int y) {
+    board->words[y * board->wordsPerRow + (x >> 6)] |= (uint64_t)1 << (x & 63);
+}
+
+// 清除(x, y)对应的位（调用者需保证位置有效）
+static inline void bitboardClear(Bitboard* board, int x, int y) {
+    board->words[y * board->wordsPerRow + (x >> 6)] &= ~((uint64_t)1 << (x & 63));
+}
+
+// 检查(x, y)对应的位（调用者需保证位置有效）
+static inline int bitboardTest(const Bitboard* board, int x, int y) {
+    return (int)((board->words[y * board->wordsPerRow + (x >> 6)] >> (x & 63)) & 1);
+}
+
+// 整数Bresenham直线的逐格遍历状态
+// 弹道绘制、占用检查和通视检查都用它遍历直线，保证经过的格子完全相同
+typedef struct {
+    int x, y;               // 当前格子
+    int toX, toY;           // 终点
+    int dx, dy;             // 横纵方向的总距离（绝对值）
+    int sx, sy;             // 横纵方向的步进（1或-1）
+    int err;
+} LineWalk;
+
+// 从(x1, y1)开始遍历到(x2, y2)的直线，当前格子为起点
+static inline void initLineWalk(LineWalk* line, int x1, int y1, int x2, int y2) {
+    line->x = x1;
+    line->y = y1;
+    line->toX = x2;
+    line->toY = y2;
+    line->dx = x2 > x1 ? x2 - x1 : x1 - x2;
+    line->dy = y2 > y1 ? y2 - y1 : y1 - y2;
+    line->sx = x1 < x2 ? 1 : -1;
+    line->sy = y1 < y2 ? 1 : -1;
+    line->err = line->dx - line->dy;
+}
+
+// 前进到下一个格子，已经在终点时返回0
+static inline int lineWalkStep(LineWalk* line) {
+    if (line->x == line->toX && line->y == line->toY) {
+        return 0;
+    }
+    int e2 = 2 * line->err;
+    if (e2 > -line->dy) {
+        line->err -= line->dy;
+        line->x += line->sx;
+    }
+    if (e2 < line->dx) {
+        line->err += line->dx;
+        line->y += line->sy;
+    }
+    return 1;
+}
+
+// 以下查询中other可以为NULL；不为NULL时按两张位图的并集查询（两者尺寸必须相同）
+// 矩形范围为闭区间[x1, x2] x [y1, y2]，超出位图的部分自动裁掉
+
+// 统计矩形内被置位的格子数量
+int bitboardCountRect(const Bitboard* board, const Bitboard* other, int x1, int y1, int x2, int y2);
+
+// 检查矩形内是否有被置位的格子
+int bitboardAnyInRect(const Bitboard* board, const Bitboard* other, int x1, int y1, int x2, int y2);
+
+// 检查从(x1, y1)到(x2, y2)的线段（Bresenham直线，不含起点，含终点）上是否有被置位的格子
+// 直线在每一行经过的是一段连续的格子，按行整段按字检查
+int bitboardAnyOnSegment(const Bitboard* board, const Bitboard* other, int x1, int y1, int x2, int y2);
+
+// 与bitboardAnyOnSegment相同，但起点和终点都不检查（用于两个装备之间的通视检查）
+int bitboardAnyBetween(const Bitboard* board, const Bitboard* other, int x1, int y1, int x2, int y2);
+
+#endif // BITBOARD_H
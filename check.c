@@ -0,0 +1,688 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "battlefield.h"
+#include "equipment.h"
+#include "simulation.h"
+#include "montecarlo.h"
+#include "scenario.h"
+#include "snapshot.h"
+#include "eventlog.h"
+#include "replay.h"
+#include "threadpool.h"
+#include "distance.h"
+#include "platform.h"
+
+// 回归检查（make check）
+// 用固定种子运行示例想定，把批量对抗的胜负统计和战斗过程中的状态哈希与记录的期望值比较，
+// 并检查不同的运行方式（目标缓存、两阶段模式的线程数、快照恢复、事件记录回放）得到完全相同的状态。
+// 不加载settings.txt，期望值只取决于示例想定和装备类型文件。
+// 模拟规则有意改变时期望值也随之改变：确认新结果正确后，用程序输出的实际值替换下面表格中的期望值。
+// 任何一项检查失败时返回1
+
+#define CHECK_SEED 7
+#define CHECK_MAX_TICKS 3000
+
+// 批量对抗检查的战斗场数
+#define BATCH_BATTLES 100
+
+// 状态哈希每隔这么多步计入一次当时的状态（战斗结束时再计入最终状态）
+#define HASH_INTERVAL 97
+
+// 两阶段模式另外检查的线程池线程数（与不用线程池时的结果比较）
+static const int TWO_PHASE_THREADS[] = { 1, 3 };
+#define TWO_PHASE_THREAD_VARIANTS ((int)(sizeof(TWO_PHASE_THREADS) / sizeof(TWO_PHASE_THREADS[0])))
+
+// 快照检查：在这一步保存快照，继续模拟到结束后恢复快照再模拟一遍
+#define SNAPSHOT_TICK 60
+#define SNAPSHOT_BATTLES 20
+
+// 回放检查：临时事件记录文件、关键帧间隔和随机跳转次数
+#define REPLAY_FILE "check_replay.bfev"
+#define REPLAY_KEYFRAME_INTERVAL 40
+#define REPLAY_BATTLES 3
+#define REPLAY_RANDOM_SEEKS 300
+
+// 录制检查：批量对抗用RECORD_THREADS个线程写出的事件记录与单线程时逐字节相同（直接开始和从共同前缀分支各一次）
+// 记录写在当前目录下（battle_i.bfev），比较后删除
+#define RECORD_DIRECTORY "."
+#define RECORD_FILE "scenario_sample.txt"
+#define RECORD_BATTLES 40
+#define RECORD_MAX_TICKS 200
+#define RECORD_KEYFRAME_INTERVAL 50
+#define RECORD_BRANCH_TICK 20
+#define RECORD_THREADS 4
+
+// 栅栏通视检查的布局：地面射手、栅栏、地面目标和飞行目标依次位于同一行，栅栏严格位于射手和地面目标之间，
+// 飞行目标比地面目标远但仍在射手的打击半径内，射手与飞行目标的连线同样穿过栅栏
+#define FENCE_MAP_WIDTH 40
+#define FENCE_MAP_HEIGHT 20
+#define FENCE_ROW 10
+#define FENCE_SHOOTER_X 17
+#define FENCE_X 19
+#define FENCE_GROUND_TARGET_X 21
+#define FENCE_FLYER_X 23
+#define FENCE_GROUND_TYPE_ID 1      // 坦克（打击半径8），射手和地面目标都使用
+#define FENCE_FLYER_TYPE_ID 2       // 飞机
+#define FENCE_TYPE_ID 7             // 栅栏
+
+#define FNV_OFFSET 1469598103934665603ULL
+#define FNV_PRIME 1099511628211ULL
+
+// 一组检查的想定和运行方式
+typedef struct {
+    const char* file;
+    DistanceMode distanceMode;
+    TickMode tickMode;
+} CheckCase;
+
+// 批量对抗的期望统计结果（BATCH_BATTLES场，主种子CHECK_SEED）
+typedef struct {
+    CheckCase setup;
+    long long redWins, blueWins, draws, timeouts, totalTicks;
+} BatchExpectation;
+
+// 状态哈希的期望值（battles场，第i场使用随机数流i）
+typedef struct {
+    CheckCase setup;
+    int battles;
+    uint64_t hash;
+} HashExpectation;
+
+static const BatchExpectation BATCH_EXPECTATIONS[] = {
+    { { "deployment_sample.txt", DISTANCE_EXACT, TICK_SEQUENTIAL }, 7, 12, 0, 81, 252615 },
+    { { "deployment_sample.txt", DISTANCE_TRUNCATED, TICK_SEQUENTIAL }, 6, 24, 0, 70, 219648 },
+    { { "scenario_sample.txt", DISTANCE_EXACT, TICK_SEQUENTIAL }, 9, 10, 0, 81, 246664 },
+    { { "scenario_sample.txt", DISTANCE_TRUNCATED, TICK_SEQUENTIAL }, 8, 12, 0, 80, 243100 },
+    { { "scenario_sample.txt", DISTANCE_EXACT, TICK_TWO_PHASE }, 41, 33, 0, 26, 96717 },
+};
+
+// deployment_sample.txt的两组哈希是此前各项优化前后比较模拟结果用的回归哈希
+static const HashExpectation HASH_EXPECTATIONS[] = {
+    { { "deployment_sample.txt", DISTANCE_EXACT, TICK_SEQUENTIAL }, 300, 0x375a19389bdda8ddULL },
+    { { "deployment_sample.txt", DISTANCE_TRUNCATED, TICK_SEQUENTIAL }, 300, 0x4b4bb1f9352e93c6ULL },
+    { { "scenario_sample.txt", DISTANCE_EXACT, TICK_SEQUENTIAL }, 100, 0x75c21119c8359236ULL },
+    { { "scenario_sample.txt", DISTANCE_TRUNCATED, TICK_SEQUENTIAL }, 100, 0xc80f3617f0565a53ULL },
+    { { "scenario_sample.txt", DISTANCE_EXACT, TICK_TWO_PHASE }, 100, 0x72d6e5dfca444767ULL },
+};
+
+#define ARRAY_LENGTH(array) ((int)(sizeof(array) / sizeof((array)[0])))
+
+static int g_failures = 0;
+
+// 记录一项检查的结果
+static void report(int passed, const char* format, const char* file, const char* detail) {
+    printf("%s ", passed ? "[通过]" : "[失败]");
+    printf(format, file, detail);
+    printf("\n");
+    if (!passed) {
+        g_failures++;
+    }
+}
+
+// 运行方式的显示名称
+static const char* getCaseName(const CheckCase* setup) {
+    if (setup->tickMode == TICK_TWO_PHASE) {
+        return setup->distanceMode == DISTANCE_TRUNCATED ? "取整距离, 两阶段" : "精确距离, 两阶段";
+    }
+    return setup->distanceMode == DISTANCE_TRUNCATED ? "取整距离" : "精确距离";
+}
+
+// 把一个值计入FNV-1a哈希
+static void hashValue(uint64_t* hash, long long value) {
+    *hash ^= (uint64_t)value;
+    *hash *= FNV_PRIME;
+}
+
+// 把双方全部单元（包括已摧毁的）的位置、方向、生命值、弹药量和存活标志计入哈希
+static void hashBattlefield(uint64_t* hash, Battlefield* battlefield) {
+    for (int team = 0; team < 2; team++) {
+        UnitStore* units = getTeamUnits(battlefield, (Team)team);
+        for (int i = 0; i < units->count; i++) {
+            hashValue(hash, units->x[i]);
+            hashValue(hash, units->y[i]);
+            hashValue(hash, units->health[i]);
+            hashValue(hash, units->ammo[i]);
+            hashValue(hash, units->alive[i]);
+            hashValue(hash, units->dirX[i]);
+            hashValue(hash, units->dirY[i]);
+        }
+    }
+}
+
+// 当前状态的哈希
+static uint64_t getStateHash(Battlefield* battlefield) {
+    uint64_t hash = FNV_OFFSET;
+    hashBattlefield(&hash, battlefield);
+    return hash;
+}
+
+// 按想定初始化战场，部署装备并使用随机数流battleIndex，内存分配失败时返回0
+static int setupBattle(Battlefield* battlefield, const Scenario* scenario, const CheckCase* setup, int battleIndex) {
+    if (!initBattlefieldWithCapacity(battlefield, scenario->width, scenario->height, getScenarioCapacity(scenario),
+                                     NULL)) {
+        printf("内存分配失败\n");
+        return 0;
+    }
+    battlefield->headless = 1;
+    battlefield->tickMode = setup->tickMode;
+    applyScenario(battlefield, scenario);
+    rngSeed(&battlefield->rng, CHECK_SEED, (uint64_t)battleIndex);
+    return 1;
+}
+
+// 从当前状态模拟到分出胜负或达到最大步数，每隔HASH_INTERVAL步把状态计入哈希
+// tick为当前步数，返回checkVictory的结果（0表示超时），tick更新为结束时的步数
+static int runToEnd(Battlefield* battlefield, int* tick, uint64_t* hash) {
+    int result = 0;
+    while (*tick < CHECK_MAX_TICKS) {
+        (*tick)++;
+        result = simulateStep(battlefield);
+        if (*tick % HASH_INTERVAL == 0) {
+            hashBattlefield(hash, battlefield);
+        }
+        if (result) {
+            break;
+        }
+    }
+    return result;
+}
+
+// 检查批量对抗的胜负统计：结果与期望值相同，且与线程数无关
+static void checkBatchResults(void) {
+    printf("\n== 批量对抗（%d场，种子%d）==\n", BATCH_BATTLES, CHECK_SEED);
+    for (int c = 0; c < ARRAY_LENGTH(BATCH_EXPECTATIONS); c++) {
+        const BatchExpectation* expected = &BATCH_EXPECTATIONS[c];
+        Scenario scenario;
+        if (!parseScenario(&scenario, expected->setup.file)) {
+            report(0, "%s (%s): 无法加载想定", expected->setup.file, getCaseName(&expected->setup));
+            continue;
+        }
+        g_distanceMode = expected->setup.distanceMode;
+
+        MonteCarloConfig config = { 0 };
+        config.scenario = &scenario;
+        config.battles = BATCH_BATTLES;
+        config.maxTicks = CHECK_MAX_TICKS;
+        config.masterSeed = CHECK_SEED;
+        config.tickMode = expected->setup.tickMode;
+
+        static const int threadCounts[] = { 1, 4 };
+        for (int t = 0; t < ARRAY_LENGTH(threadCounts); t++) {
+            MonteCarloResult result;
+            config.threads = threadCounts[t];
+            int ok = runMonteCarlo(&config, &result);
+            int passed = ok && result.redWins == expected->redWins && result.blueWins == expected->blueWins &&
+                         result.draws == expected->draws && result.timeouts == expected->timeouts &&
+                         result.totalTicks == expected->totalTicks;
+            char detail[256];
+            snprintf(detail, sizeof(detail), "%s, %d线程: 红方胜%lld 蓝方胜%lld 平局%lld 超时%lld 总步数%lld",
+                     getCaseName(&expected->setup), threadCounts[t], result.redWins, result.blueWins,
+                     result.draws, result.timeouts, result.totalTicks);
+            report(passed, "%s (%s)", expected->setup.file, detail);
+            if (!passed) {
+                printf("       期望: 红方胜%lld 蓝方胜%lld 平局%lld 超时%lld 总步数%lld\n", expected->redWins,
+                       expected->blueWins, expected->draws, expected->timeouts, expected->totalTicks);
+            }
+        }
+        freeScenario(&scenario);
+    }
+    g_distanceMode = DISTANCE_EXACT;
+}
+
+// 运行battles场战斗，返回全部战斗过程的状态哈希
+// pool不为NULL时两阶段模式的意图阶段在线程池上并行；mismatches累加目标缓存校验模式发现的不一致次数
+// 内存分配失败时停止运行并把failed置为1
+static uint64_t runHashedBattles(const Scenario* scenario, const CheckCase* setup, int battles,
+                                 TargetCacheMode cacheMode, ThreadPool* pool, long long* mismatches, int* failed) {
+    uint64_t hash = FNV_OFFSET;
+    *failed = 0;
+    for (int i = 0; i < battles; i++) {
+        Battlefield battlefield;
+        if (!setupBattle(&battlefield, scenario, setup, i)) {
+            *failed = 1;
+            break;
+        }
+        battlefield.targetCacheMode = cacheMode;
+        battlefield.threadPool = pool;
+
+        int tick = 0;
+        int result = runToEnd(&battlefield, &tick, &hash);
+        hashBattlefield(&hash, &battlefield);
+        hashValue(&hash, result);
+        hashValue(&hash, tick);
+        *mismatches += getTargetCacheMismatches(&battlefield);
+        freeBattlefield(&battlefield);
+    }
+    return hash;
+}
+
+// 检查状态哈希：与期望值相同，且与目标缓存的使用方式和两阶段模式的线程数无关
+static void checkStateHashes(void) {
+    static const TargetCacheMode cacheModes[] = { TARGET_CACHE_ON, TARGET_CACHE_OFF, TARGET_CACHE_VERIFY };
+    static const char* cacheModeNames[] = { "目标缓存on", "目标缓存off", "目标缓存verify" };
+
+    printf("\n== 状态哈希（种子%d）==\n", CHECK_SEED);
+    for (int c = 0; c < ARRAY_LENGTH(HASH_EXPECTATIONS); c++) {
+        const HashExpectation* expected = &HASH_EXPECTATIONS[c];
+        Scenario scenario;
+        if (!parseScenario(&scenario, expected->setup.file)) {
+            report(0, "%s (%s): 无法加载想定", expected->setup.file, getCaseName(&expected->setup));
+            continue;
+        }
+        g_distanceMode = expected->setup.distanceMode;
+
+        // 顺序模式比较三种目标缓存方式，两阶段模式另外比较线程池的线程数
+        int variants = ARRAY_LENGTH(cacheModes);
+        if (expected->setup.tickMode == TICK_TWO_PHASE) {
+            variants += TWO_PHASE_THREAD_VARIANTS;
+        }
+        for (int v = 0; v < variants; v++) {
+            TargetCacheMode cacheMode = TARGET_CACHE_ON;
+            int threads = 0;
+            char variantName[64];
+            if (v < ARRAY_LENGTH(cacheModes)) {
+                cacheMode = cacheModes[v];
+                snprintf(variantName, sizeof(variantName), "%s", cacheModeNames[v]);
+            } else {
+                threads = TWO_PHASE_THREADS[v - ARRAY_LENGTH(cacheModes)];
+                snprintf(variantName, sizeof(variantName), "线程池%d线程", threads);
+            }
+
+            ThreadPool pool;
+            if (threads > 0 && !initThreadPool(&pool, threads)) {
+                report(0, "%s (%s): 无法创建线程池", expected->setup.file, variantName);
+                continue;
+            }
+            long long mismatches = 0;
+            int failed;
+            uint64_t hash = runHashedBattles(&scenario, &expected->setup, expected->battles, cacheMode,
+                                             threads > 0 ? &pool : NULL, &mismatches, &failed);
+            if (threads > 0) {
+                freeThreadPool(&pool);
+            }
+
+            char detail[256];
+            snprintf(detail, sizeof(detail), "%s, %d场, %s: %016llx", getCaseName(&expected->setup),
+                     expected->battles, variantName, (unsigned long long)hash);
+            report(!failed && hash == expected->hash && mismatches == 0, "%s (%s)", expected->setup.file, detail);
+            if (hash != expected->hash) {
+                printf("       期望: %016llx\n", (unsigned long long)expected->hash);
+            }
+            if (mismatches != 0) {
+                printf("       目标缓存与完整查找不一致%lld次\n", mismatches);
+            }
+        }
+        freeScenario(&scenario);
+    }
+    g_distanceMode = DISTANCE_EXACT;
+}
+
+// 检查快照：在第SNAPSHOT_TICK步保存快照，恢复后继续模拟的过程与不中断时完全相同
+static void checkSnapshots(void) {
+    static const CheckCase cases[] = {
+        { "deployment_sample.txt", DISTANCE_EXACT, TICK_SEQUENTIAL },
+        { "scenario_sample.txt", DISTANCE_EXACT, TICK_TWO_PHASE },
+    };
+
+    printf("\n== 快照恢复（%d场，第%d步保存）==\n", SNAPSHOT_BATTLES, SNAPSHOT_TICK);
+    for (int c = 0; c < ARRAY_LENGTH(cases); c++) {
+        Scenario scenario;
+        if (!parseScenario(&scenario, cases[c].file)) {
+            report(0, "%s (%s): 无法加载想定", cases[c].file, getCaseName(&cases[c]));
+            continue;
+        }
+
+        int differences = 0;
+        int failures = 0;
+        for (int i = 0; i < SNAPSHOT_BATTLES; i++) {
+            Battlefield battlefield;
+            if (!setupBattle(&battlefield, &scenario, &cases[c], i)) {
+                failures++;
+                continue;
+            }
+            BattlefieldSnapshot snapshot;
+            initBattlefieldSnapshot(&snapshot);
+
+            // 战斗在保存快照之前就结束时没有可比较的内容
+            int tick = 0;
+            int result = 0;
+            while (tick < SNAPSHOT_TICK && !result) {
+                tick++;
+                result = simulateStep(&battlefield);
+            }
+            if (!result) {
+                if (!snapshotBattlefield(&battlefield, &snapshot)) {
+                    failures++;
+                } else {
+                    uint64_t first = FNV_OFFSET;
+                    int firstTick = tick;
+                    int firstResult = runToEnd(&battlefield, &firstTick, &first);
+                    hashBattlefield(&first, &battlefield);
+
+                    uint64_t second = FNV_OFFSET;
+                    int secondTick = tick;
+                    int secondResult = 0;
+                    if (!restoreBattlefield(&battlefield, &snapshot)) {
+                        failures++;
+                    } else {
+                        secondResult = runToEnd(&battlefield, &secondTick, &second);
+                        hashBattlefield(&second, &battlefield);
+                        if (first != second || firstTick != secondTick || firstResult != secondResult) {
+                            differences++;
+                        }
+                    }
+                }
+            }
+            freeBattlefieldSnapshot(&snapshot);
+            freeBattlefield(&battlefield);
+        }
+
+        char detail[128];
+        snprintf(detail, sizeof(detail), "%s: 不一致%d场, 内存分配失败%d场", getCaseName(&cases[c]),
+                 differences, failures);
+        report(differences == 0 && failures == 0, "%s (%s)", cases[c].file, detail);
+        freeScenario(&scenario);
+    }
+}
+
+// 比较回放停在tick步时的状态与记录时的状态，返回不一致的项数
+static int compareReplay(Replay* replay, int tick, const uint64_t* tickHashes) {
+    int reached = replaySeek(replay, tick);
+    if (reached != tick) {
+        return 1;
+    }
+    return getStateHash(&replay->battlefield) != tickHashes[tick];
+}
+
+// 记录一场战斗并回放：回放中每一步（顺序、倒序和随机跳转）的状态都与记录时相同，胜负和步数也相同
+// 返回不一致的项数，内存分配失败或无法写入、读取记录时返回-1
+static int checkReplayBattle(const Scenario* scenario, const CheckCase* setup, int battleIndex) {
+    uint64_t* tickHashes = malloc(sizeof(uint64_t) * (CHECK_MAX_TICKS + 1));
+    if (!tickHashes) {
+        return -1;
+    }
+
+    Battlefield battlefield;
+    if (!setupBattle(&battlefield, scenario, setup, battleIndex)) {
+        free(tickHashes);
+        return -1;
+    }
+    EventLog log;
+    if (!openEventLog(&log, REPLAY_FILE, battlefield.width, battlefield.height, REPLAY_KEYFRAME_INTERVAL)) {
+        freeBattlefield(&battlefield);
+        free(tickHashes);
+        return -1;
+    }
+    battlefield.eventLog = &log;
+    eventLogDeployment(&log, &battlefield);
+    tickHashes[0] = getStateHash(&battlefield);
+
+    int tick = 0;
+    int result = 0;
+    while (tick < CHECK_MAX_TICKS && !result) {
+        tick++;
+        result = simulateStep(&battlefield);
+        tickHashes[tick] = getStateHash(&battlefield);
+    }
+    battlefield.eventLog = NULL;
+    int written = closeEventLog(&log);
+    freeBattlefield(&battlefield);
+
+    Replay replay;
+    if (!written || !openReplay(&replay, REPLAY_FILE)) {
+        remove(REPLAY_FILE);
+        free(tickHashes);
+        return -1;
+    }
+
+    int differences = (replay.lastTick != tick) + (replay.result != result);
+    for (int t = 0; t <= tick; t++) {
+        differences += compareReplay(&replay, t, tickHashes);
+    }
+    for (int t = tick; t >= 0; t--) {
+        differences += compareReplay(&replay, t, tickHashes);
+    }
+    Rng rng;
+    rngSeed(&rng, CHECK_SEED, (uint64_t)battleIndex);
+    for (int k = 0; k < REPLAY_RANDOM_SEEKS; k++) {
+        differences += compareReplay(&replay, rngNextBelow(&rng, tick + 1), tickHashes);
+    }
+
+    closeReplay(&replay);
+    remove(REPLAY_FILE);
+    free(tickHashes);
+    return differences;
+}
+
+// 检查事件记录的回放
+static void checkReplays(void) {
+    static const CheckCase cases[] = {
+        { "deployment_sample.txt", DISTANCE_EXACT, TICK_SEQUENTIAL },
+        { "scenario_sample.txt", DISTANCE_EXACT, TICK_TWO_PHASE },
+    };
+
+    printf("\n== 事件记录回放（关键帧间隔%d步）==\n", REPLAY_KEYFRAME_INTERVAL);
+    for (int c = 0; c < ARRAY_LENGTH(cases); c++) {
+        Scenario scenario;
+        if (!parseScenario(&scenario, cases[c].file)) {
+            report(0, "%s (%s): 无法加载想定", cases[c].file, getCaseName(&cases[c]));
+            continue;
+        }
+        for (int i = 0; i < REPLAY_BATTLES; i++) {
+            int differences = checkReplayBattle(&scenario, &cases[c], i);
+            char detail[128];
+            if (differences < 0) {
+                snprintf(detail, sizeof(detail), "%s, 第%d场: 内存分配失败或无法写入、读取事件记录",
+                         getCaseName(&cases[c]), i);
+            } else {
+                snprintf(detail, sizeof(detail), "%s, 第%d场: 不一致%d项", getCaseName(&cases[c]), i, differences);
+            }
+            report(differences == 0, "%s (%s)", cases[c].file, detail);
+        }
+        freeScenario(&scenario);
+    }
+}
+
+// 用threads个线程运行RECORD_BATTLES场战斗并把事件记录写入RECORD_DIRECTORY，全部写出时返回1
+static int recordBatch(const Scenario* scenario, int threads, const BattlefieldSnapshot* branchPoint) {
+    MonteCarloConfig config = { 0 };
+    config.scenario = scenario;
+    config.battles = RECORD_BATTLES;
+    config.maxTicks = RECORD_MAX_TICKS;
+    config.threads = threads;
+    config.masterSeed = CHECK_SEED;
+    config.recordDirectory = RECORD_DIRECTORY;
+    config.keyframeInterval = RECORD_KEYFRAME_INTERVAL;
+    config.branchPoint = branchPoint;
+    config.branchTick = branchPoint ? RECORD_BRANCH_TICK : 0;
+
+    MonteCarloResult result;
+    return runMonteCarlo(&config, &result) && result.recordFailures == 0;
+}
+
+// 第index场战斗的事件记录文件名
+static void getRecordPath(char* path, size_t size, int index) {
+    snprintf(path, size, "%s/battle_%d.bfev", RECORD_DIRECTORY, index);
+}
+
+// 读入第index场战斗的事件记录（调用者释放），失败时返回NULL
+static void* readRecord(int index, size_t* size) {
+    char path[256];
+    getRecordPath(path, sizeof(path), index);
+    const void* data = platformMapFile(path, size);
+    if (!data) {
+        return NULL;
+    }
+    void* copy = malloc(*size);
+    if (copy) {
+        memcpy(copy, data, *size);
+    }
+    platformUnmapFile(data, *size);
+    return copy;
+}
+
+// 比较单线程和多线程写出的事件记录，返回内容不同的记录数，无法写出或读取记录时返回-1
+static int compareBatchRecords(const Scenario* scenario, const BattlefieldSnapshot* branchPoint) {
+    void* records[RECORD_BATTLES] = { 0 };
+    size_t sizes[RECORD_BATTLES];
+    int differences = 0;
+
+    int ok = recordBatch(scenario, 1, branchPoint);
+    for (int i = 0; ok && i < RECORD_BATTLES; i++) {
+        records[i] = readRecord(i, &sizes[i]);
+        ok = records[i] != NULL;
+    }
+    ok = ok && recordBatch(scenario, RECORD_THREADS, branchPoint);
+    for (int i = 0; ok && i < RECORD_BATTLES; i++) {
+        size_t size;
+        void* record = readRecord(i, &size);
+        if (!record) {
+            ok = 0;
+            break;
+        }
+        if (size != sizes[i] || memcmp(record, records[i], size) != 0) {
+            differences++;
+        }
+        free(record);
+    }
+
+    for (int i = 0; i < RECORD_BATTLES; i++) {
+        char path[256];
+        getRecordPath(path, sizeof(path), i);
+        remove(path);
+        free(records[i]);
+    }
+    return ok ? differences : -1;
+}
+
+// 检查批量对抗的事件记录与线程数无关（装备ID等写入记录的内容不受各线程之前运行过哪些战斗影响）
+static void checkBatchRecords(void) {
+    printf("\n== 批量对抗的事件记录（%d场，1线程与%d线程）==\n", RECORD_BATTLES, RECORD_THREADS);
+    Scenario scenario;
+    if (!parseScenario(&scenario, RECORD_FILE)) {
+        report(0, "%s (%s)", RECORD_FILE, "无法加载想定");
+        return;
+    }
+
+    for (int branched = 0; branched <= 1; branched++) {
+        BattlefieldSnapshot branchPoint;
+        initBattlefieldSnapshot(&branchPoint);
+        int differences = -1;
+        if (!branched) {
+            differences = compareBatchRecords(&scenario, NULL);
+        } else {
+            MonteCarloConfig config = { 0 };
+            config.scenario = &scenario;
+            config.masterSeed = CHECK_SEED;
+            if (runBattlePrefix(&config, RECORD_BRANCH_TICK, &branchPoint)) {
+                differences = compareBatchRecords(&scenario, &branchPoint);
+            }
+        }
+        freeBattlefieldSnapshot(&branchPoint);
+
+        char detail[128];
+        const char* mode = branched ? "从共同前缀分支" : "从部署开始";
+        if (differences < 0) {
+            snprintf(detail, sizeof(detail), "%s: 内存分配失败或无法写入、读取事件记录", mode);
+        } else {
+            snprintf(detail, sizeof(detail), "%s: 不同%d场", mode, differences);
+        }
+        report(differences == 0, "%s (%s)", RECORD_FILE, detail);
+    }
+    freeScenario(&scenario);
+}
+
+// 在(x, FENCE_ROW)放置一个静止的装备，返回它在本方单元存储中的下标（失败时返回-1）
+static int placeFenceFixtureUnit(Battlefield* battlefield, int typeId, Team team, int x) {
+    Equipment equipment;
+    if (!initEquipment(&equipment, typeId, team, x, FENCE_ROW, 0, 0)) {
+        return -1;
+    }
+    return placeUnitOnBattlefield(battlefield, &equipment);
+}
+
+// 布置栅栏通视检查的战场（withFence为0时不放栅栏，作为对照），蓝方没有弹药，只有红方射手开火
+// 先模拟一步，使目标缓存建立并记住射手的目标；返回射手、地面目标和飞行目标的下标，内存分配失败时返回0
+static int setupFenceFixture(Battlefield* battlefield, TargetCacheMode cacheMode, int withFence,
+                             int* shooter, int* groundTarget, int* flyer) {
+    *shooter = *groundTarget = *flyer = -1;
+    if (!initBattlefield(battlefield, FENCE_MAP_WIDTH, FENCE_MAP_HEIGHT)) {
+        return 0;
+    }
+    battlefield->headless = 1;
+    battlefield->targetCacheMode = cacheMode;
+    rngSeed(&battlefield->rng, CHECK_SEED, 0);
+
+    *shooter = placeFenceFixtureUnit(battlefield, FENCE_GROUND_TYPE_ID, TEAM_RED, FENCE_SHOOTER_X);
+    *groundTarget = placeFenceFixtureUnit(battlefield, FENCE_GROUND_TYPE_ID, TEAM_BLUE, FENCE_GROUND_TARGET_X);
+    *flyer = placeFenceFixtureUnit(battlefield, FENCE_FLYER_TYPE_ID, TEAM_BLUE, FENCE_FLYER_X);
+    if (*shooter < 0 || *groundTarget < 0 || *flyer < 0) {
+        return 0;
+    }
+    if (withFence && placeFenceFixtureUnit(battlefield, FENCE_TYPE_ID, TEAM_RED, FENCE_X) < 0) {
+        return 0;
+    }
+    battlefield->blueUnits.ammo[*groundTarget] = 0;
+    battlefield->blueUnits.ammo[*flyer] = 0;
+
+    simulateStep(battlefield);
+    return 1;
+}
+
+// 检查栅栏遮挡：地面射手跳过栅栏后面的地面目标，选择更远的飞行目标（飞行目标不受栅栏遮挡）
+// 在目标缓存开、关和校验三种方式下分别检查：第一步开火后地面目标没有受到攻击，缓存建立后再次查找仍选择飞行目标；
+// 不放栅栏时射手选择更近的地面目标，说明上面的结果确实来自栅栏
+static void checkFenceLineOfSight(void) {
+    static const TargetCacheMode cacheModes[] = { TARGET_CACHE_ON, TARGET_CACHE_OFF, TARGET_CACHE_VERIFY };
+    static const char* cacheModeNames[] = { "目标缓存on", "目标缓存off", "目标缓存verify" };
+
+    printf("\n== 栅栏遮挡地面射击 ==\n");
+    for (int m = 0; m < ARRAY_LENGTH(cacheModes); m++) {
+        Battlefield battlefield;
+        int shooter, groundTarget, flyer;
+        int placed = setupFenceFixture(&battlefield, cacheModes[m], 1, &shooter, &groundTarget, &flyer);
+        int groundHealth = placed ? battlefield.blueUnits.health[groundTarget] : 0;
+        EquipmentType* groundType = getEquipmentTypeById(FENCE_GROUND_TYPE_ID);
+        int target = placed ? handleUnitAttack(&battlefield, TEAM_RED, shooter) : -1;
+        long long mismatches = getTargetCacheMismatches(&battlefield);
+
+        char detail[128];
+        snprintf(detail, sizeof(detail), "%s: 目标%d (飞行目标%d, 地面目标%d), 地面目标生命值%d, 缓存不一致%lld次",
+                 cacheModeNames[m], target, flyer, groundTarget, groundHealth, mismatches);
+        report(placed && target == flyer && groundType && groundHealth == groundType->maxHealth && mismatches == 0,
+               "%s (%s)", "栅栏在射手与地面目标之间", detail);
+        freeBattlefield(&battlefield);
+
+        // 对照：没有栅栏时最近的地面目标可以被攻击
+        placed = setupFenceFixture(&battlefield, cacheModes[m], 0, &shooter, &groundTarget, &flyer);
+        target = placed ? handleUnitAttack(&battlefield, TEAM_RED, shooter) : -1;
+        mismatches = getTargetCacheMismatches(&battlefield);
+        snprintf(detail, sizeof(detail), "%s: 目标%d (地面目标%d), 缓存不一致%lld次", cacheModeNames[m], target,
+                 groundTarget, mismatches);
+        report(placed && target == groundTarget && mismatches == 0, "%s (%s)", "没有栅栏", detail);
+        freeBattlefield(&battlefield);
+    }
+}
+
+int main(void) {
+    if (!loadEquipmentTypes("equipment_types.txt") || !loadEquipmentInteractions("equipment_interactions.txt")) {
+        printf("无法加载装备类型文件\n");
+        return 1;
+    }
+
+    checkBatchResults();
+    checkStateHashes();
+    checkSnapshots();
+    checkReplays();
+    checkBatchRecords();
+    checkFenceLineOfSight();
+
+    if (g_failures > 0) {
+        printf("\n%d项检查失败\n", g_failures);
+        return 1;
+    }
+    printf("\n全部检查通过\n");
+    return 0;
+}
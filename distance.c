@@ -0,0 +1,180 @@
+#include "distance.h"
+#include <limits.h>
+#include <math.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define DISTANCE_X86_KERNELS 1
+#endif
+
+// 全局距离计算规则
+DistanceMode g_distanceMode = DISTANCE_EXACT;
+
+// 整数平方根（向下取整）
+int integerSqrt(int value) {
+    if (value <= 0) {
+        return 0;
+    }
+
+    // 先用浮点开方，再修正舍入误差
+    int root = (int)sqrt((double)value);
+    while ((long long)root * root > value) {
+        root--;
+    }
+    while ((long long)(root + 1) * (root + 1) <= value) {
+        root++;
+    }
+    return root;
+}
+
+// 规则mode下距离键值不超过key的最大平方距离
+static int maxSquaredForKeyInMode(int key, DistanceMode mode) {
+    if (key < 0) {
+        return -1;
+    }
+    if (mode == DISTANCE_EXACT) {
+        return key;
+    }
+
+    // 取整后距离为key的平方距离范围是[key², (key+1)²)
+    long long limit = (long long)(key + 1) * (key + 1) - 1;
+    return limit > INT_MAX ? INT_MAX : (int)limit;
+}
+
+// 距离键值不超过key的最大平方距离
+int maxSquaredForKey(int key) {
+    return maxSquaredForKeyInMode(key, g_distanceMode);
+}
+
+// 规则mode下攻击半径对应的最大平方距离
+int squaredAttackRadiusForMode(int radius, DistanceMode mode) {
+    if (radius < 0) {
+        return -1;
+    }
+    if (mode == DISTANCE_TRUNCATED) {
+        return maxSquaredForKeyInMode(radius, mode);
+    }
+
+    long long squared = (long long)radius * radius;
+    return squared > INT_MAX ? INT_MAX : (int)squared;
+}
+
+// 攻击半径对应的最大平方距离
+int squaredAttackRadius(int radius) {
+    return squaredAttackRadiusForMode(radius, g_distanceMode);
+}
+
+// 标量版本：从第start个点开始查找，best/bestSquared为已有的最优结果
+static int findNearestPointScalar(const int* xs, const int* ys, int start, int count, int x, int y,
+                                  int best, int* bestSquared) {
+    for (int i = start; i < count; i++) {
+        int squared = squaredDistance(x, y, xs[i], ys[i]);
+        if (best < 0 || squared < *bestSquared) {
+            best = i;
+            *bestSquared = squared;
+        }
+    }
+    return best;
+}
+
+#ifdef DISTANCE_X86_KERNELS
+// 合并各通道的结果：取最小平方距离，相同时取位置靠前的点
+static int reduceLanes(const int* values, const int* positions, int lanes, int* bestSquared) {
+    int best = -1;
+    for (int i = 0; i < lanes; i++) {
+        if (positions[i] >= 0 &&
+            (best < 0 || values[i] < *bestSquared || (values[i] == *bestSquared && positions[i] < best))) {
+            best = positions[i];
+            *bestSquared = values[i];
+        }
+    }
+    return best;
+}
+
+// AVX2版本：每次处理8个点
+__attribute__((target("avx2")))
+static int findNearestPointAvx2(const int* xs, const int* ys, int count, int x, int y, int* minSquared) {
+    __m256i centerX = _mm256_set1_epi32(x);
+    __m256i centerY = _mm256_set1_epi32(y);
+    __m256i bestValues = _mm256_set1_epi32(INT_MAX);
+    __m256i bestPositions = _mm256_set1_epi32(-1);
+    __m256i positions = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    __m256i step = _mm256_set1_epi32(8);
+
+    int i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256i dx = _mm256_sub_epi32(_mm256_loadu_si256((const __m256i*)(xs + i)), centerX);
+        __m256i dy = _mm256_sub_epi32(_mm256_loadu_si256((const __m256i*)(ys + i)), centerY);
+        __m256i squared = _mm256_add_epi32(_mm256_mullo_epi32(dx, dx), _mm256_mullo_epi32(dy, dy));
+        // 只在严格更近时替换，保证每个通道保留最靠前的点
+        __m256i closer = _mm256_cmpgt_epi32(bestValues, squared);
+        bestValues = _mm256_blendv_epi8(bestValues, squared, closer);
+        bestPositions = _mm256_blendv_epi8(bestPositions, positions, closer);
+        positions = _mm256_add_epi32(positions, step);
+    }
+
+    int values[8];
+    int lanePositions[8];
+    _mm256_storeu_si256((__m256i*)values, bestValues);
+    _mm256_storeu_si256((__m256i*)lanePositions, bestPositions);
+
+    int bestSquared = INT_MAX;
+    int best = reduceLanes(values, lanePositions, 8, &bestSquared);
+    best = findNearestPointScalar(xs, ys, i, count, x, y, best, &bestSquared);
+    *minSquared = bestSquared;
+    return best;
+}
+
+// SSE4.1版本：每次处理4个点
+__attribute__((target("sse4.1")))
+static int findNearestPointSse41(const int* xs, const int* ys, int count, int x, int y, int* minSquared) {
+    __m128i centerX = _mm_set1_epi32(x);
+    __m128i centerY = _mm_set1_epi32(y);
+    __m128i bestValues = _mm_set1_epi32(INT_MAX);
+    __m128i bestPositions = _mm_set1_epi32(-1);
+    __m128i positions = _mm_setr_epi32(0, 1, 2, 3);
+    __m128i step = _mm_set1_epi32(4);
+
+    int i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128i dx = _mm_sub_epi32(_mm_loadu_si128((const __m128i*)(xs + i)), centerX);
+        __m128i dy = _mm_sub_epi32(_mm_loadu_si128((const __m128i*)(ys + i)), centerY);
+        __m128i squared = _mm_add_epi32(_mm_mullo_epi32(dx, dx), _mm_mullo_epi32(dy, dy));
+        __m128i closer = _mm_cmpgt_epi32(bestValues, squared);
+        bestValues = _mm_blendv_epi8(bestValues, squared, closer);
+        bestPositions = _mm_blendv_epi8(bestPositions, positions, closer);
+        positions = _mm_add_epi32(positions, step);
+    }
+
+    int values[4];
+    int lanePositions[4];
+    _mm_storeu_si128((__m128i*)values, bestValues);
+    _mm_storeu_si128((__m128i*)lanePositions, bestPositions);
+
+    int bestSquared = INT_MAX;
+    int best = reduceLanes(values, lanePositions, 4, &bestSquared);
+    best = findNearestPointScalar(xs, ys, i, count, x, y, best, &bestSquared);
+    *minSquared = bestSquared;
+    return best;
+}
+#endif
+
+// 查找最近的点
+int findNearestPoint(const int* xs, const int* ys, int count, int x, int y, int* minSquared) {
+    *minSquared = INT_MAX;
+    if (count <= 0) {
+        return -1;
+    }
+
+#ifdef DISTANCE_X86_KERNELS
+    // 点数太少时向量版本没有收益
+    if (count >= 8 && __builtin_cpu_supports("avx2")) {
+        return findNearestPointAvx2(xs, ys, count, x, y, minSquared);
+    }
+    if (count >= 4 && __builtin_cpu_supports("sse4.1")) {
+        return findNearestPointSse41(xs, ys, count, x, y, minSquared);
+    }
+#endif
+
+    return findNearestPointScalar(xs, ys, 0, count, x, y, -1, minSquared);
+}
@@ -0,0 +1,52 @@
+#ifndef DISTANCE_H
+#define DISTANCE_H
+
+// 距离计算规则
+// 精确模式直接比较整数平方距离；兼容模式复现旧版本 (int)sqrt(平方距离) 取整后比较的结果，
+// 用于与旧版本的对抗结果逐位对比
+typedef enum {
+    DISTANCE_EXACT,         // 精确平方距离（默认）
+    DISTANCE_TRUNCATED      // 取整后的距离（旧版本规则）
+} DistanceMode;
+
+// 全局距离计算规则，需在开始模拟前设置，模拟过程中只读
+extern DistanceMode g_distanceMode;
+
+// 坐标的最大取值，保证平方距离不超出int范围
+#define MAX_DISTANCE_COORDINATE 32767
+
+// 计算两点之间的平方距离
+static inline int squaredDistance(int x1, int y1, int x2, int y2) {
+    int dx = x2 - x1;
+    int dy = y2 - y1;
+    return dx * dx + dy * dy;
+}
+
+// 整数平方根（向下取整）
+int integerSqrt(int value);
+
+// 把平方距离换算为规则mode下用于比较的距离键值，键值越小越近
+static inline int distanceKeyForMode(int squared, DistanceMode mode) {
+    return mode == DISTANCE_TRUNCATED ? integerSqrt(squared) : squared;
+}
+
+// 把平方距离换算为当前规则下用于比较的距离键值
+static inline int distanceKey(int squared) {
+    return distanceKeyForMode(squared, g_distanceMode);
+}
+
+// 距离键值不超过key的最大平方距离
+int maxSquaredForKey(int key);
+
+// 攻击半径对应的最大平方距离：平方距离不超过该值即在攻击范围内，半径为负时返回-1
+int squaredAttackRadius(int radius);
+
+// 规则mode下攻击半径对应的最大平方距离
+int squaredAttackRadiusForMode(int radius, DistanceMode mode);
+
+// 计算(x, y)到count个点（坐标分别存放在xs/ys中）的最小平方距离
+// 返回第一个取得最小值的点的位置，count为0时返回-1；最小平方距离写入minSquared
+// 支持AVX2/SSE4.1时按向量批量计算，否则使用标量版本
+int findNearestPoint(const int* xs, const int* ys, int count, int x, int y, int* minSquared);
+
+#endif // DISTANCE_H
@@ -1,5 +1,7 @@
 #include "equipment.h"
 #include <math.h>
+#include "distance.h"
+#include "stencil.h"
 
 // 全局装备类型数组
 EquipmentType* g_equipmentTypes = NULL;
@@ -9,8 +11,89 @@ int g_equipmentTypesCount = 0;
 EquipmentInteraction* g_equipmentInteractions = NULL;
 int g_equipmentInteractionsCount = 0;
 
-// 装备ID计数器
-static int g_nextEquipmentId = 1;
+// 按typeId直接索引的装备类型表（下标为typeId，不存在的类型为NULL）
+static EquipmentType** g_typeTable = NULL;
+static int g_typeTableSize = 0;
+
+// 攻击方×防守方的稠密交互矩阵，每项同时包含伤害和命中率
+// 下标为 attackerId * g_interactionMatrixSize + defenderId，不存在的交互其attackerId为-1
+static EquipmentInteraction* g_interactionMatrix = NULL;
+static int g_interactionMatrixSize = 0;
+
+// 稠密表允许的最大typeId，超出时退回线性查找
+#define MAX_DENSE_TYPE_ID 4095
+
+// 装备ID计数器（每个线程独立计数，多线程批量对抗时互不干扰）
+static _Thread_local int g_nextEquipmentId = FIRST_EQUIPMENT_ID;
+
+// 建立按typeId索引的装备类型表
+static void buildTypeTable(void) {
+    free(g_typeTable);
+    g_typeTable = NULL;
+    g_typeTableSize = 0;
+
+    int maxTypeId = -1;
+    for (int i = 0; i < g_equipmentTypesCount; i++) {
+        int typeId = g_equipmentTypes[i].typeId;
+        if (typeId < 0 || typeId > MAX_DENSE_TYPE_ID) {
+            return; // typeId超出范围，使用线性查找
+        }
+        if (typeId > maxTypeId) {
+            maxTypeId = typeId;
+        }
+    }
+
+    g_typeTable = (EquipmentType**)calloc(maxTypeId + 1, sizeof(EquipmentType*));
+    if (!g_typeTable) {
+        return;
+    }
+    g_typeTableSize = maxTypeId + 1;
+
+    // 重复的typeId以第一次出现的为准，与线性查找的结果一致
+    for (int i = 0; i < g_equipmentTypesCount; i++) {
+        if (!g_typeTable[g_equipmentTypes[i].typeId]) {
+            g_typeTable[g_equipmentTypes[i].typeId] = &g_equipmentTypes[i];
+        }
+    }
+}
+
+// 建立攻击方×防守方的稠密交互矩阵
+static void buildInteractionMatrix(void) {
+    free(g_interactionMatrix);
+    g_interactionMatrix = NULL;
+    g_interactionMatrixSize = 0;
+
+    int maxTypeId = -1;
+    for (int i = 0; i < g_equipmentInteractionsCount; i++) {
+        EquipmentInteraction* interaction = &g_equipmentInteractions[i];
+        if (interaction->attackerId < 0 || interaction->attackerId > MAX_DENSE_TYPE_ID ||
+            interaction->defenderId < 0 || interaction->defenderId > MAX_DENSE_TYPE_ID) {
+            return; // typeId超出范围，使用线性查找
+        }
+        if (interaction->attackerId > maxTypeId) maxTypeId = interaction->attackerId;
+        if (interaction->defenderId > maxTypeId) maxTypeId = interaction->defenderId;
+    }
+
+    int size = maxTypeId + 1;
+    g_interactionMatrix = (EquipmentInteraction*)malloc((size_t)size * size * sizeof(EquipmentInteraction));
+    if (!g_interactionMatrix) {
+        return;
+    }
+    g_interactionMatrixSize = size;
+
+    for (int i = 0; i < size * size; i++) {
+        g_interactionMatrix[i].attackerId = -1;
+    }
+
+    // 重复的交互以第一次出现的为准，与线性查找的结果一致
+    for (int i = 0; i < g_equipmentInteractionsCount; i++) {
+        EquipmentInteraction* interaction = &g_equipmentInteractions[i];
+        EquipmentInteraction* entry = &g_interactionMatrix[interaction->attackerId * size + interaction->defenderId];
+        if (entry->attackerId < 0) {
+            *entry = *interaction;
+        }
+    }
+}
 
 // 加载装备类型
 int loadEquipmentTypes(const char* filename) {
@@ -32,6 +115,13 @@ int loadEquipmentTypes(const char* filename) {
     // 重置文件指针
     rewind(file);
 
+    // 释放之前加载的装备类型（重复加载时不泄漏）
+    free(g_equipmentTypes);
+    g_equipmentTypesCount = 0;
+    free(g_typeTable);
+    g_typeTable = NULL;
+    g_typeTableSize = 0;
+
     // 分配内存
     g_equipmentTypes = (EquipmentType*)malloc(count * sizeof(EquipmentType));
     if (!g_equipmentTypes) {
@@ -57,6 +147,14 @@ int loadEquipmentTypes(const char* filename) {
 
     g_equipmentTypesCount = count;
     fclose(file);
+
+    buildTypeTable();
+
+    // 为各种最大打击半径建立攻击范围模板
+    if (!buildRangeStencils()) {
+        printf("内存分配失败\n");
+        return 0;
+    }
     return 1;
 }
 
@@ -80,6 +178,10 @@ int loadEquipmentInteractions(const char* filename) {
     // 重置文件指针
     rewind(file);
 
+    // 释放之前加载的交互数据（重复加载时不泄漏）
+    free(g_equipmentInteractions);
+    g_equipmentInteractionsCount = 0;
+
     // 分配内存
     g_equipmentInteractions = (EquipmentInteraction*)malloc(count * sizeof(EquipmentInteraction));
     if (!g_equipmentInteractions) {
@@ -104,11 +206,17 @@ int loadEquipmentInteractions(const char* filename) {
 
     g_equipmentInteractionsCount = count;
     fclose(file);
+
+    buildInteractionMatrix();
     return 1;
 }
 
 // 根据ID获取装备类型
 EquipmentType* getEquipmentTypeById(int typeId) {
+    if (g_typeTable) {
+        return (typeId >= 0 && typeId < g_typeTableSize) ? g_typeTable[typeId] : NULL;
+    }
+
     for (int i = 0; i < g_equipmentTypesCount; i++) {
         if (g_equipmentTypes[i].typeId == typeId) {
             return &g_equipmentTypes[i];
@@ -119,6 +227,15 @@ EquipmentType* getEquipmentTypeById(int typeId) {
 
 // 获取两种装备之间的交互信息
 EquipmentInteraction* getInteraction(int attackerId, int defenderId) {
+    if (g_interactionMatrix) {
+        if (attackerId < 0 || attackerId >= g_interactionMatrixSize ||
+            defenderId < 0 || defenderId >= g_interactionMatrixSize) {
+            return NULL;
+        }
+        EquipmentInteraction* entry = &g_interactionMatrix[attackerId * g_interactionMatrixSize + defenderId];
+        return entry->attackerId >= 0 ? entry : NULL;
+    }
+
     for (int i = 0; i < g_equipmentInteractionsCount; i++) {
         if (g_equipmentInteractions[i].attackerId == attackerId &&
             g_equipmentInteractions[i].defenderId == defenderId) {
@@ -128,22 +245,32 @@ EquipmentInteraction* getInteraction(int attackerId, int defenderId) {
     return NULL;
 }
 
-// 创建一个新的装备实例
-Equipment* createEquipment(int typeId, Team team, int x, int y, int dirX, int dirY) {
+// 获取下一个装备ID
+int getNextEquipmentId(void) {
+    return g_nextEquipmentId;
+}
+
+// 设置下一个装备ID
+void setNextEquipmentId(int id) {
+    g_nextEquipmentId = id;
+}
+
+// 把装备类型的名称复制到装备实例中
+void copyEquipmentName(Equipment* equipment, const EquipmentType* type) {
+    snprintf(equipment->name, sizeof(equipment->name), "%s", type->name);
+}
+
+// 初始化一个装备实例
+int initEquipment(Equipment* equipment, int typeId, Team team, int x, int y, int dirX, int dirY) {
     EquipmentType* type = getEquipmentTypeById(typeId);
     if (!type) {
-        return NULL;
-    }
-
-    Equipment* equipment = (Equipment*)malloc(sizeof(Equipment));
-    if (!equipment) {
-        return NULL;
+        return 0;
     }
 
     equipment->id = g_nextEquipmentId++;
     equipment->typeId = typeId;
     equipment->team = team;
-    strcpy(equipment->name, type->name);
+    copyEquipmentName(equipment, type);
     equipment->currentHealth = type->maxHealth;
     equipment->currentSpeed = type->maxSpeed;
     equipment->currentAmmo = type->maxAmmo;
@@ -154,11 +281,28 @@ Equipment* createEquipment(int typeId, Team team, int x, int y, int dirX, int di
     equipment->deployTime = 0;
     equipment->isActive = 1;
 
+    return 1;
+}
+
+// 创建一个新的装备实例
+Equipment* createEquipment(int typeId, Team team, int x, int y, int dirX, int dirY) {
+    if (!getEquipmentTypeById(typeId)) {
+        return NULL;
+    }
+
+    Equipment* equipment = (Equipment*)malloc(sizeof(Equipment));
+    if (!equipment) {
+        return NULL;
+    }
+
+    initEquipment(equipment, typeId, team, x, y, dirX, dirY);
     return equipment;
 }
 
 // 释放装备类型资源
 void freeEquipmentTypes() {
+    freeRangeStencils();
+
     if (g_equipmentTypes) {
         free(g_equipmentTypes);
         g_equipmentTypes = NULL;
@@ -170,10 +314,18 @@ void freeEquipmentTypes() {
         g_equipmentInteractions = NULL;
         g_equipmentInteractionsCount = 0;
     }
+
+    // 释放稠密查找表
+    free(g_typeTable);
+    g_typeTable = NULL;
+    g_typeTableSize = 0;
+    free(g_interactionMatrix);
+    g_interactionMatrix = NULL;
+    g_interactionMatrixSize = 0;
 }
 
 // 计算装备对另一装备的伤害
-int calculateDamage(Equipment* attacker, Equipment* defender) {
+int calculateDamage(Equipment* attacker, Equipment* defender, Rng* rng) {
     if (!attacker || !defender || attacker->team == defender->team) {
         return 0;
     }
@@ -184,7 +336,7 @@ int calculateDamage(Equipment* attacker, Equipment* defender) {
     }
 
     // 考虑射击精度因素
-    if (rand() % 100 >= interaction->accuracy) {
+    if (rngNextBelow(rng, 100) >= interaction->accuracy) {
         return 0; // 未命中
     }
 
@@ -199,7 +351,7 @@ static double calculateDistance(int x1, int y1, int x2, int y2) {
 */
 
 // 检查装备是否可以攻击
-int canAttack(Equipment* attacker, Equipment* defender, int distance) {
+int canAttack(Equipment* attacker, Equipment* defender, int distanceSquared) {
     if (!attacker || !defender || !attacker->isActive || !defender->isActive ||
         attacker->team == defender->team || attacker->currentAmmo <= 0) {
         return 0;
@@ -210,9 +362,8 @@ int canAttack(Equipment* attacker, Equipment* defender, int distance) {
         return 0;
     }
 
-    // 检查是否在攻击范围内
-    int attackRadius = attackerType->maxAttackRadius;
-    if (distance > attackRadius) {
+    // 检查是否在攻击范围内（与攻击半径的平方比较）
+    if (distanceSquared > squaredAttackRadius(attackerType->maxAttackRadius)) {
         return 0;
     }
 
@@ -4,6 +4,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include "rng.h"
 
 // 队伍枚举
 typedef enum {
@@ -62,22 +63,37 @@ int loadEquipmentTypes(const char* filename);
 // 加载装备交互信息
 int loadEquipmentInteractions(const char* filename);
 
-// 根据ID获取装备类型
+// 根据ID获取装备类型（加载时建立typeId索引表，O(1)查找）
 EquipmentType* getEquipmentTypeById(int typeId);
 
-// 获取两种装备之间的交互信息
+// 获取两种装备之间的交互信息（加载时建立稠密交互矩阵，O(1)查找）
 EquipmentInteraction* getInteraction(int attackerId, int defenderId);
 
+// 第一个装备ID；批量对抗每场战斗部署前把计数器重置为该值，装备ID（写入事件记录）与线程分配无关
+#define FIRST_EQUIPMENT_ID 1
+
+// 获取下一个装备ID（本线程的装备ID计数器）
+int getNextEquipmentId(void);
+
+// 设置下一个装备ID，用于恢复战场快照或在部署前重置计数器
+void setNextEquipmentId(int id);
+
+// 把装备类型的名称复制到装备实例中（过长时截断，始终以0结尾）
+void copyEquipmentName(Equipment* equipment, const EquipmentType* type);
+
+// 初始化一个装备实例，类型不存在时返回0
+int initEquipment(Equipment* equipment, int typeId, Team team, int x, int y, int dirX, int dirY);
+
 // 创建一个新的装备实例
 Equipment* createEquipment(int typeId, Team team, int x, int y, int dirX, int dirY);
 
 // 释放装备类型资源
 void freeEquipmentTypes();
 
-// 计算装备对另一装备的伤害
-int calculateDamage(Equipment* attacker, Equipment* defender);
+// 计算装备对另一装备的伤害（使用给定的随机数流判定是否命中）
+int calculateDamage(Equipment* attacker, Equipment* defender, Rng* rng);
 
-// 检查装备是否可以攻击
-int canAttack(Equipment* attacker, Equipment* defender, int distance);
+// 检查装备是否可以攻击，distanceSquared为双方之间的平方距离
+int canAttack(Equipment* attacker, Equipment* defender, int distanceSquared);
 
 #endif // EQUIPMENT_H 
\ No newline at end of file
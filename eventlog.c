@@ -0,0 +1,564 @@
+#include "eventlog.h"
+#include <stdlib.h>
+#include <string.h>
+#include "battlefield.h"
+
+// 数据块的数据长度达到这么多字节后，在步结束时结束该块
+#define EVENT_BLOCK_TARGET_SIZE 4096
+
+// 已完成的数据块积累到这么多字节后一次写入文件
+#define EVENT_LOG_FLUSH_SIZE (64 * 1024)
+
+// 一个事件编码后的最大长度（标记字节加7个变长整数）
+#define MAX_EVENT_BYTES 40
+
+// 按小端序写入整数
+static void putUint16(unsigned char* p, uint32_t value) {
+    p[0] = (unsigned char)value;
+    p[1] = (unsigned char)(value >> 8);
+}
+
+static void putUint32(unsigned char* p, uint32_t value) {
+    p[0] = (unsigned char)value;
+    p[1] = (unsigned char)(value >> 8);
+    p[2] = (unsigned char)(value >> 16);
+    p[3] = (unsigned char)(value >> 24);
+}
+
+static void putUint64(unsigned char* p, uint64_t value) {
+    putUint32(p, (uint32_t)value);
+    putUint32(p + 4, (uint32_t)(value >> 32));
+}
+
+// 按小端序读取整数
+static uint32_t getUint16(const unsigned char* p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8);
+}
+
+static uint32_t getUint32(const unsigned char* p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static uint64_t getUint64(const unsigned char* p) {
+    return (uint64_t)getUint32(p) | ((uint64_t)getUint32(p + 4) << 32);
+}
+
+// 写入变长整数，返回写入的字节数
+static int putVarint(unsigned char* p, uint32_t value) {
+    int n = 0;
+    while (value >= 0x80) {
+        p[n++] = (unsigned char)(value | 0x80);
+        value >>= 7;
+    }
+    p[n++] = (unsigned char)value;
+    return n;
+}
+
+// 有符号数的zigzag编码：0, -1, 1, -2 ... 依次编码为 0, 1, 2, 3 ...
+static uint32_t zigzag(int value) {
+    return ((uint32_t)value << 1) ^ (uint32_t)(value >> 31);
+}
+
+static int unzigzag(uint32_t value) {
+    return (int)(value >> 1) ^ -(int)(value & 1);
+}
+
+// 把-1到1之间的两个分量打包到一个字节的两个2位字段
+static int packPair(int a, int b) {
+    return ((a + 1) & 3) | (((b + 1) & 3) << 2);
+}
+
+// 把已完成的数据块写入文件
+static void flushEventLog(EventLog* log) {
+    if (log->length > 0 && !log->failed &&
+        fwrite(log->data, 1, log->length, log->file) != log->length) {
+        log->failed = 1;
+    }
+    log->length = 0;
+}
+
+// 结束当前的数据块：填写块头，并把数据补齐到4的倍数
+static void finishBlock(EventLog* log) {
+    if (!log->blockOpen) {
+        return;
+    }
+
+    unsigned char* header = log->data + log->blockStart;
+    size_t payloadSize = log->length - log->blockStart - EVENT_BLOCK_HEADER_SIZE;
+    putUint32(header, (uint32_t)log->blockFirstTick);
+    putUint16(header + 4, EVENT_BLOCK_EVENTS);
+    putUint16(header + 6, 0);
+    putUint32(header + 8, log->eventCount);
+    putUint32(header + 12, (uint32_t)payloadSize);
+    while (log->length & 3) {
+        log->data[log->length++] = 0;
+    }
+    log->blockOpen = 0;
+
+    if (log->length >= EVENT_LOG_FLUSH_SIZE) {
+        flushEventLog(log);
+    }
+}
+
+// 创建事件记录文件
+int openEventLog(EventLog* log, const char* filename, int width, int height, int keyframeInterval) {
+    log->file = NULL;
+    log->data = NULL;
+    log->length = 0;
+    log->capacity = 0;
+    log->blockStart = 0;
+    log->blockOpen = 0;
+    log->blockFirstTick = 0;
+    log->blockTick = 0;
+    log->eventCount = 0;
+    log->tick = 0;
+    log->previousUnit = 0;
+    log->keyframeInterval = keyframeInterval > 0 ? keyframeInterval : 0;
+    log->failed = 0;
+
+    log->file = fopen(filename, "wb");
+    if (!log->file) {
+        return 0;
+    }
+
+    unsigned char header[EVENT_LOG_HEADER_SIZE];
+    memset(header, 0, sizeof(header));
+    memcpy(header, EVENT_LOG_MAGIC, 4);
+    putUint16(header + 4, EVENT_LOG_VERSION);
+    putUint16(header + 6, EVENT_LOG_HEADER_SIZE);
+    putUint32(header + 8, (uint32_t)width);
+    putUint32(header + 12, (uint32_t)height);
+    putUint32(header + 16, (uint32_t)log->keyframeInterval);
+
+    if (fwrite(header, 1, sizeof(header), log->file) != sizeof(header)) {
+        fclose(log->file);
+        log->file = NULL;
+        return 0;
+    }
+    return 1;
+}
+
+// 写出最后一步的事件并关闭文件
+int closeEventLog(EventLog* log) {
+    if (!log->file) {
+        return 0;
+    }
+
+    finishBlock(log);
+    flushEventLog(log);
+    if (fclose(log->file) != 0) {
+        log->failed = 1;
+    }
+    log->file = NULL;
+
+    free(log->data);
+    log->data = NULL;
+    log->length = 0;
+    log->capacity = 0;
+    return !log->failed;
+}
+
+// 保证缓冲区在当前长度之后还有extra字节的空间，内存不足时返回0
+static int ensureCapacity(EventLog* log, size_t extra) {
+    if (log->failed) {
+        return 0;
+    }
+    if (log->length + extra > log->capacity) {
+        size_t newCapacity = log->capacity > 0 ? log->capacity * 2 : EVENT_LOG_FLUSH_SIZE + EVENT_BLOCK_TARGET_SIZE;
+        while (newCapacity < log->length + extra) {
+            newCapacity *= 2;
+        }
+        unsigned char* data = (unsigned char*)realloc(log->data, newCapacity);
+        if (!data) {
+            log->failed = 1;
+            return 0;
+        }
+        log->data = data;
+        log->capacity = newCapacity;
+    }
+    return 1;
+}
+
+// 为一个事件预留空间，返回写入位置；内存不足时返回NULL
+// 没有未结束的数据块时先预留块头的位置；数据块中换到新的一步时先写入步标记
+static unsigned char* beginEvent(EventLog* log, EventType type, Team team, int isHit) {
+    if (!ensureCapacity(log, EVENT_BLOCK_HEADER_SIZE + 2 * MAX_EVENT_BYTES)) {
+        return NULL;
+    }
+
+    if (!log->blockOpen) {
+        log->blockStart = log->length;
+        log->length += EVENT_BLOCK_HEADER_SIZE;
+        log->blockOpen = 1;
+        log->blockFirstTick = log->tick;
+        log->blockTick = log->tick;
+        log->eventCount = 0;
+        log->previousUnit = 0;
+    } else if (log->blockTick != log->tick) {
+        unsigned char* marker = log->data + log->length;
+        marker[0] = EVENT_TICK;
+        log->length += 1 + putVarint(marker + 1, (uint32_t)(log->tick - log->blockTick));
+        log->blockTick = log->tick;
+        log->previousUnit = 0;
+    }
+
+    unsigned char* p = log->data + log->length;
+    p[0] = (unsigned char)(type | ((team == TEAM_BLUE) << 3) | ((isHit != 0) << 4));
+    log->eventCount++;
+    return p + 1;
+}
+
+// 写入单元下标与上一个事件单元下标的差
+static int putUnit(EventLog* log, unsigned char* p, int unit) {
+    int n = putVarint(p, zigzag(unit - log->previousUnit));
+    log->previousUnit = unit;
+    return n;
+}
+
+// 结束一个事件的编码
+static void endEvent(EventLog* log, const unsigned char* end) {
+    log->length = (size_t)(end - log->data);
+}
+
+// 记录已部署的全部装备
+void eventLogDeployment(EventLog* log, Battlefield* battlefield) {
+    for (int t = 0; t < 2; t++) {
+        Team team = (t == 0) ? TEAM_RED : TEAM_BLUE;
+        UnitStore* units = getTeamUnits(battlefield, team);
+        for (int i = 0; i < units->count; i++) {
+            unsigned char* p = beginEvent(log, EVENT_SPAWN, team, 0);
+            if (!p) {
+                return;
+            }
+            p += putUnit(log, p, i);
+            p += putVarint(p, (uint32_t)units->typeId[i]);
+            p += putVarint(p, (uint32_t)units->x[i]);
+            p += putVarint(p, (uint32_t)units->y[i]);
+            *p++ = (unsigned char)packPair(units->dirX[i], units->dirY[i]);
+            p += putVarint(p, (uint32_t)units->health[i]);
+            p += putVarint(p, (uint32_t)units->ammo[i]);
+            endEvent(log, p);
+
+            // 从快照开始的战斗中可能已有被摧毁的装备
+            if (!units->alive[i]) {
+                eventLogKill(log, team, i);
+            }
+        }
+    }
+    eventLogEndTick(log, battlefield);
+}
+
+// 记录一次移动
+void eventLogMove(EventLog* log, Team team, int unit, int dx, int dy, int dirX, int dirY) {
+    unsigned char* p = beginEvent(log, EVENT_MOVE, team, 0);
+    if (!p) {
+        return;
+    }
+    p += putUnit(log, p, unit);
+    *p++ = (unsigned char)(packPair(dx, dy) | (packPair(dirX, dirY) << 4));
+    endEvent(log, p);
+}
+
+// 记录一次射击
+void eventLogShot(EventLog* log, Team team, int unit, int target, int isHit, int damage) {
+    unsigned char* p = beginEvent(log, EVENT_SHOT, team, isHit);
+    if (!p) {
+        return;
+    }
+    p += putUnit(log, p, unit);
+    p += putVarint(p, (uint32_t)target);
+    p += putVarint(p, (uint32_t)damage);
+    endEvent(log, p);
+}
+
+// 记录一个装备被摧毁
+void eventLogKill(EventLog* log, Team team, int unit) {
+    unsigned char* p = beginEvent(log, EVENT_KILL, team, 0);
+    if (!p) {
+        return;
+    }
+    p += putUnit(log, p, unit);
+    endEvent(log, p);
+}
+
+// 记录胜负结果
+void eventLogVictory(EventLog* log, int result) {
+    unsigned char* p = beginEvent(log, EVENT_VICTORY, TEAM_RED, 0);
+    if (!p) {
+        return;
+    }
+    p += putVarint(p, (uint32_t)result);
+    endEvent(log, p);
+}
+
+// 写入一个关键帧数据块（当前步结束时的完整状态）
+static void writeKeyframe(EventLog* log, Battlefield* battlefield) {
+    finishBlock(log);
+
+    UnitStore* stores[2] = { &battlefield->redUnits, &battlefield->blueUnits };
+    int unitCount = stores[0]->count + stores[1]->count;
+    size_t payloadSize = KEYFRAME_HEADER_SIZE + (size_t)unitCount * KEYFRAME_UNIT_SIZE;
+    if (!ensureCapacity(log, EVENT_BLOCK_HEADER_SIZE + payloadSize)) {
+        return;
+    }
+
+    unsigned char* header = log->data + log->length;
+    putUint32(header, (uint32_t)log->tick);
+    putUint16(header + 4, EVENT_BLOCK_KEYFRAME);
+    putUint16(header + 6, 0);
+    putUint32(header + 8, (uint32_t)unitCount);
+    putUint32(header + 12, (uint32_t)payloadSize);
+
+    unsigned char* p = header + EVENT_BLOCK_HEADER_SIZE;
+    putUint32(p, (uint32_t)battlefield->redBudget);
+    putUint32(p + 4, (uint32_t)battlefield->blueBudget);
+    putUint32(p + 8, (uint32_t)battlefield->redRemainingBudget);
+    putUint32(p + 12, (uint32_t)battlefield->blueRemainingBudget);
+    putUint32(p + 16, (uint32_t)battlefield->redHQUnit);
+    putUint32(p + 20, (uint32_t)battlefield->blueHQUnit);
+    putUint32(p + 24, (uint32_t)stores[0]->count);
+    putUint32(p + 28, (uint32_t)stores[1]->count);
+    for (int i = 0; i < 4; i++) {
+        putUint64(p + 32 + 8 * i, battlefield->rng.state[i]);
+    }
+    p += KEYFRAME_HEADER_SIZE;
+
+    // 单元记录：先红方后蓝方，每个KEYFRAME_UNIT_SIZE字节
+    for (int t = 0; t < 2; t++) {
+        UnitStore* units = stores[t];
+        for (int i = 0; i < units->count; i++) {
+            putUint32(p, (uint32_t)units->views[i].id);
+            putUint32(p + 4, (uint32_t)units->typeId[i]);
+            putUint32(p + 8, (uint32_t)units->health[i]);
+            putUint32(p + 12, (uint32_t)units->ammo[i]);
+            putUint16(p + 16, (uint32_t)units->x[i]);
+            putUint16(p + 18, (uint32_t)units->y[i]);
+            p[20] = (unsigned char)units->dirX[i];
+            p[21] = (unsigned char)units->dirY[i];
+            p[22] = units->alive[i];
+            p[23] = 0;
+            p += KEYFRAME_UNIT_SIZE;
+        }
+    }
+
+    log->length += EVENT_BLOCK_HEADER_SIZE + payloadSize;
+    if (log->length >= EVENT_LOG_FLUSH_SIZE) {
+        flushEventLog(log);
+    }
+}
+
+// 结束当前步
+void eventLogEndTick(EventLog* log, Battlefield* battlefield) {
+    if (log->keyframeInterval > 0 && log->tick % log->keyframeInterval == 0) {
+        writeKeyframe(log, battlefield);
+    } else if (log->blockOpen && !log->failed &&
+               log->length - log->blockStart - EVENT_BLOCK_HEADER_SIZE >= EVENT_BLOCK_TARGET_SIZE) {
+        finishBlock(log);
+    }
+    log->tick++;
+}
+
+// 检查文件头并初始化读取器
+int initEventLogReader(EventLogReader* reader, const void* data, size_t size) {
+    const unsigned char* bytes = (const unsigned char*)data;
+    if (size < EVENT_LOG_HEADER_SIZE || memcmp(bytes, EVENT_LOG_MAGIC, 4) != 0) {
+        return 0;
+    }
+
+    int version = (int)getUint16(bytes + 4);
+    size_t headerSize = getUint16(bytes + 6);
+    if (version < 1 || version > EVENT_LOG_VERSION || headerSize < EVENT_LOG_HEADER_SIZE || headerSize > size) {
+        return 0;
+    }
+
+    reader->data = bytes;
+    reader->size = size;
+    reader->offset = headerSize;
+    reader->width = (int)getUint32(bytes + 8);
+    reader->height = (int)getUint32(bytes + 12);
+    reader->keyframeInterval = (int)getUint32(bytes + 16); // 第1版中为保留的0
+    reader->version = version;
+    return 1;
+}
+
+// 读取下一个数据块
+int eventLogNextBlock(EventLogReader* reader, EventBlock* block) {
+    if (reader->size - reader->offset < EVENT_BLOCK_HEADER_SIZE) {
+        return 0;
+    }
+
+    const unsigned char* header = reader->data + reader->offset;
+    size_t payloadSize = getUint32(header + 12);
+    if (payloadSize > reader->size - reader->offset - EVENT_BLOCK_HEADER_SIZE) {
+        return 0; // 数据被截断
+    }
+
+    block->tick = (int)getUint32(header);
+    block->kind = (int)getUint16(header + 4);
+    block->eventCount = (int)getUint32(header + 8);
+    block->data = header + EVENT_BLOCK_HEADER_SIZE;
+    block->size = payloadSize;
+    block->offset = 0;
+    block->previousUnit = 0;
+
+    size_t next = reader->offset + EVENT_BLOCK_HEADER_SIZE + payloadSize;
+    next += (4 - (payloadSize & 3)) & 3;
+    reader->offset = next < reader->size ? next : reader->size;
+    return 1;
+}
+
+// 读取变长整数，数据不完整时返回0
+static int getVarint(EventBlock* block, uint32_t* value) {
+    uint32_t result = 0;
+    for (int shift = 0; shift < 35 && block->offset < block->size; shift += 7) {
+        unsigned char byte = block->data[block->offset++];
+        result |= (uint32_t)(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) {
+            *value = result;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// 读取单元下标差并还原单元下标
+static int getUnit(EventBlock* block, int* unit) {
+    uint32_t value;
+    if (!getVarint(block, &value)) {
+        return 0;
+    }
+    *unit = block->previousUnit + unzigzag(value);
+    block->previousUnit = *unit;
+    return 1;
+}
+
+// 读取一个打包的字节
+static int getPacked(EventBlock* block, int* packed) {
+    if (block->offset >= block->size) {
+        return 0;
+    }
+    *packed = block->data[block->offset++];
+    return 1;
+}
+
+// 解码数据块中的下一个事件
+int eventBlockNextEvent(EventBlock* block, BattleEvent* event) {
+    if (block->kind != EVENT_BLOCK_EVENTS) {
+        return 0;
+    }
+
+    // 步标记：推进当前步数，下标差从0重新开始
+    unsigned char tag;
+    while (1) {
+        if (block->offset >= block->size) {
+            return 0;
+        }
+        tag = block->data[block->offset++];
+        if ((tag & 7) != EVENT_TICK) {
+            break;
+        }
+        uint32_t delta;
+        if (!getVarint(block, &delta)) {
+            return 0;
+        }
+        block->tick += (int)delta;
+        block->previousUnit = 0;
+    }
+
+    memset(event, 0, sizeof(*event));
+    event->type = (EventType)(tag & 7);
+    event->tick = block->tick;
+    event->team = (tag & 8) ? TEAM_BLUE : TEAM_RED;
+    event->isHit = (tag >> 4) & 1;
+
+    uint32_t a, b, c, d, e;
+    int packed;
+    switch (event->type) {
+        case EVENT_SPAWN:
+            if (!getUnit(block, &event->unit) || !getVarint(block, &a) || !getVarint(block, &b) ||
+                !getVarint(block, &c) || !getPacked(block, &packed) || !getVarint(block, &d) ||
+                !getVarint(block, &e)) {
+                return 0;
+            }
+            event->typeId = (int)a;
+            event->x = (int)b;
+            event->y = (int)c;
+            event->dirX = (packed & 3) - 1;
+            event->dirY = ((packed >> 2) & 3) - 1;
+            event->health = (int)d;
+            event->ammo = (int)e;
+            return 1;
+
+        case EVENT_MOVE:
+            if (!getUnit(block, &event->unit) || !getPacked(block, &packed)) {
+                return 0;
+            }
+            event->dx = (packed & 3) - 1;
+            event->dy = ((packed >> 2) & 3) - 1;
+            event->dirX = ((packed >> 4) & 3) - 1;
+            event->dirY = ((packed >> 6) & 3) - 1;
+            return 1;
+
+        case EVENT_SHOT:
+            if (!getUnit(block, &event->unit) || !getVarint(block, &a) || !getVarint(block, &b)) {
+                return 0;
+            }
+            event->target = (int)a;
+            event->damage = (int)b;
+            return 1;
+
+        case EVENT_KILL:
+            return getUnit(block, &event->unit);
+
+        case EVENT_VICTORY:
+            if (!getVarint(block, &a)) {
+                return 0;
+            }
+            event->result = (int)a;
+            return 1;
+
+        default:
+            return 0; // 未知的事件类型
+    }
+}
+
+// 读取关键帧数据块的头部
+int eventBlockReadKeyframe(const EventBlock* block, KeyframeInfo* info) {
+    if (block->kind != EVENT_BLOCK_KEYFRAME || block->size < KEYFRAME_HEADER_SIZE) {
+        return 0;
+    }
+
+    const unsigned char* p = block->data;
+    info->redBudget = (int)getUint32(p);
+    info->blueBudget = (int)getUint32(p + 4);
+    info->redRemainingBudget = (int)getUint32(p + 8);
+    info->blueRemainingBudget = (int)getUint32(p + 12);
+    info->redHQUnit = (int)getUint32(p + 16);
+    info->blueHQUnit = (int)getUint32(p + 20);
+    info->redCount = (int)getUint32(p + 24);
+    info->blueCount = (int)getUint32(p + 28);
+    for (int i = 0; i < 4; i++) {
+        info->rngState[i] = getUint64(p + 32 + 8 * i);
+    }
+
+    // 单元数量必须与数据长度一致
+    if (info->redCount < 0 || info->blueCount < 0 ||
+        block->size != KEYFRAME_HEADER_SIZE + ((size_t)info->redCount + info->blueCount) * KEYFRAME_UNIT_SIZE) {
+        return 0;
+    }
+    return 1;
+}
+
+// 读取关键帧中的第index个单元
+void eventBlockKeyframeUnit(const EventBlock* block, int index, KeyframeUnit* unit) {
+    const unsigned char* p = block->data + KEYFRAME_HEADER_SIZE + (size_t)index * KEYFRAME_UNIT_SIZE;
+    unit->id = (int)getUint32(p);
+    unit->typeId = (int)getUint32(p + 4);
+    unit->health = (int)getUint32(p + 8);
+    unit->ammo = (int)getUint32(p + 12);
+    unit->x = (int)getUint16(p + 16);
+    unit->y = (int)getUint16(p + 18);
+    unit->dirX = (signed char)p[20];
+    unit->dirY = (signed char)p[21];
+    unit->alive = p[22];
+}
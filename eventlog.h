@@ -0,0 +1,194 @@
+#ifndef EVENTLOG_H
+#define EVENTLOG_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "equipment.h"
+
+// 前向声明，避免与battlefield.h互相包含
+struct Battlefield;
+
+// 战斗事件记录（二进制格式，所有整数均为小端序）
+//
+// 文件头（EVENT_LOG_HEADER_SIZE字节）:
+//   0  char[4]  魔数 "BFEV"
+//   4  uint16   格式版本 EVENT_LOG_VERSION
+//   6  uint16   文件头长度
+//   8  uint32   战场宽度
+//   12 uint32   战场高度
+//   16 uint32   关键帧间隔（步数，0表示没有关键帧；第1版中为保留的0）
+//   20 保留，全部为0
+//
+// 文件头之后是一串数据块，每块包含连续若干步中发生的事件（数据约4KB时在步结束处分块）:
+//   0  uint32   块中第一个事件所在的步数（0为部署，之后每次simulateStep加1）
+//   4  uint16   块类型 EventBlockKind
+//   6  uint16   保留
+//   8  uint32   块中的事件数（不含步标记）
+//   12 uint32   数据长度（字节）
+//   16 数据，长度补齐到4的倍数，使每个块头都按4字节对齐
+// 块头长度固定，离线工具可以只读块头，按步数逐块跳过而不解码事件
+//
+// 每个事件以一个标记字节开始：低3位为事件类型，第3位为队伍（0红方、1蓝方），第4位为命中标志
+// 之后的字段都是变长整数（每字节7位，最高位表示后面还有字节）。单元下标写为与同一步中
+// 上一个事件单元下标的差（zigzag编码），按下标顺序发生的事件通常只占一个字节：
+//   EVENT_SPAWN   下标差, typeId, x, y, 方向, 生命值, 弹药      （部署时的装备）
+//   EVENT_MOVE    下标差, 位移和新方向                          （位置或方向发生变化）
+//   EVENT_SHOT    下标差, 目标下标, 伤害                        （队伍为攻击方，命中标志有效）
+//   EVENT_KILL    下标差                                        （队伍为被摧毁的一方，部署时跟在已被摧毁装备之后）
+//   EVENT_VICTORY 结果（与checkVictory的返回值相同）
+//   EVENT_TICK    与上一步的步数差                              （块内换到新的一步，没有事件的步不出现）
+// 方向、位移各分量都在-1到1之间，加1后每个占2位打包成一个字节：
+//   位移为 (dx+1) | (dy+1)<<2 | (dirX+1)<<4 | (dirY+1)<<6，方向为 (dirX+1) | (dirY+1)<<2
+//
+// 关键帧数据块（第2版起）记录某一步结束时战场的完整状态，块头中的步数为该步，事件数为单元数。
+// 每隔关键帧间隔步（包括部署后的第0步）写一个，写之前先结束未结束的事件数据块，
+// 因此关键帧之后的数据块只包含更晚的步中的事件。数据为定长记录：
+//   0  int32[8]  红方预算, 蓝方预算, 红方剩余预算, 蓝方剩余预算, 红方大本营下标, 蓝方大本营下标,
+//                红方单元数, 蓝方单元数
+//   32 uint64[4] 随机数发生器状态
+//   64 单元记录（先红方后蓝方），每个KEYFRAME_UNIT_SIZE字节：
+//      int32 ID, int32 typeId, int32 生命值, int32 弹药, uint16 x, uint16 y, int8 dirX, int8 dirY, uint8 存活, 保留1字节
+
+#define EVENT_LOG_MAGIC "BFEV"
+#define EVENT_LOG_VERSION 2
+#define EVENT_LOG_HEADER_SIZE 32
+#define EVENT_BLOCK_HEADER_SIZE 16
+#define KEYFRAME_HEADER_SIZE 64
+#define KEYFRAME_UNIT_SIZE 24
+
+// 默认的关键帧间隔（步数）
+#define DEFAULT_KEYFRAME_INTERVAL 1000
+
+// 数据块类型
+typedef enum {
+    EVENT_BLOCK_EVENTS = 1,     // 连续若干步中的事件
+    EVENT_BLOCK_KEYFRAME        // 关键帧
+} EventBlockKind;
+
+// 事件类型
+typedef enum {
+    EVENT_SPAWN = 1,
+    EVENT_MOVE,
+    EVENT_SHOT,
+    EVENT_KILL,
+    EVENT_VICTORY,
+    EVENT_TICK              // 步标记（只在数据中出现，解码时不返回）
+} EventType;
+
+// 解码后的事件
+typedef struct {
+    EventType type;
+    int tick;               // 事件发生的步数
+    Team team;              // 事件所属的队伍（射击为攻击方，摧毁为被摧毁的一方）
+    int unit;               // 单元下标
+    int target;             // 射击目标在敌方单元存储中的下标
+    int isHit;              // 射击是否命中
+    int damage;             // 射击造成的伤害
+    int typeId;             // 部署的装备类型
+    int x, y;               // 部署位置
+    int dx, dy;             // 移动的位移
+    int dirX, dirY;         // 部署或移动后的方向
+    int health, ammo;       // 部署时的生命值和弹药
+    int result;             // 胜负结果
+} BattleEvent;
+
+// 事件记录器
+// 事件直接编码到内存中，已完成的数据块积累到一定大小后一次写入文件
+typedef struct {
+    FILE* file;
+    unsigned char* data;    // 尚未写入文件的数据块（最后一块可能还未结束，块头在结束时填写）
+    size_t length;
+    size_t capacity;
+    size_t blockStart;      // 未结束的数据块的块头位置
+    int blockOpen;          // 是否有未结束的数据块
+    int blockFirstTick;     // 未结束的数据块中第一个事件的步数
+    int blockTick;          // 未结束的数据块中最后一个事件的步数
+    uint32_t eventCount;    // 未结束的数据块中的事件数
+    int tick;               // 当前步数
+    int previousUnit;       // 同一步中上一个事件的单元下标
+    int keyframeInterval;   // 关键帧间隔（0表示不写关键帧）
+    int failed;             // 写入失败后不再记录
+} EventLog;
+
+// 创建事件记录文件并写入文件头，成功返回1，失败返回0
+// keyframeInterval为关键帧间隔（步数），<=0表示不写关键帧
+int openEventLog(EventLog* log, const char* filename, int width, int height, int keyframeInterval);
+
+// 写出最后的数据块并关闭文件，记录完整无误时返回1
+int closeEventLog(EventLog* log);
+
+// 记录战场上已部署的全部装备（第0步），之后的事件从第1步开始
+void eventLogDeployment(EventLog* log, struct Battlefield* battlefield);
+
+// 记录一次移动（位移为0时表示只改变了方向）
+void eventLogMove(EventLog* log, Team team, int unit, int dx, int dy, int dirX, int dirY);
+
+// 记录一次射击
+void eventLogShot(EventLog* log, Team team, int unit, int target, int isHit, int damage);
+
+// 记录一个装备被摧毁
+void eventLogKill(EventLog* log, Team team, int unit);
+
+// 记录胜负结果
+void eventLogVictory(EventLog* log, int result);
+
+// 结束当前步（数据块足够大时结束该块，积累到一定大小后才实际写入文件）
+// 到了关键帧间隔时写入battlefield当前状态的关键帧
+void eventLogEndTick(EventLog* log, struct Battlefield* battlefield);
+
+// 事件记录读取器，直接在内存中（如mmap映射的文件）逐块逐个解码事件
+typedef struct {
+    const unsigned char* data;
+    size_t size;
+    size_t offset;          // 下一个数据块的位置
+    int width, height;      // 战场尺寸
+    int keyframeInterval;   // 关键帧间隔（0表示没有关键帧）
+    int version;            // 格式版本
+} EventLogReader;
+
+// 一个数据块
+typedef struct {
+    int tick;               // 下一个事件的步数（从块中第一个事件的步数开始）
+    int kind;               // EventBlockKind
+    int eventCount;
+    const unsigned char* data;
+    size_t size;
+    size_t offset;          // 下一个事件在数据中的位置
+    int previousUnit;       // 同一步中上一个事件的单元下标
+} EventBlock;
+
+// 检查文件头并初始化读取器，格式不正确时返回0
+int initEventLogReader(EventLogReader* reader, const void* data, size_t size);
+
+// 读取下一个数据块，没有更多数据块（或数据被截断）时返回0
+int eventLogNextBlock(EventLogReader* reader, EventBlock* block);
+
+// 解码数据块中的下一个事件，没有更多事件（或不是事件数据块）时返回0
+int eventBlockNextEvent(EventBlock* block, BattleEvent* event);
+
+// 关键帧的头部
+typedef struct {
+    int redBudget, blueBudget;
+    int redRemainingBudget, blueRemainingBudget;
+    int redHQUnit, blueHQUnit;
+    int redCount, blueCount;    // 双方单元数
+    uint64_t rngState[4];       // 随机数发生器状态
+} KeyframeInfo;
+
+// 关键帧中的一个单元
+typedef struct {
+    int id, typeId;
+    int health, ammo;
+    int x, y;
+    int dirX, dirY;
+    int alive;
+} KeyframeUnit;
+
+// 读取关键帧数据块的头部，不是关键帧或长度不一致时返回0
+int eventBlockReadKeyframe(const EventBlock* block, KeyframeInfo* info);
+
+// 读取关键帧中的第index个单元（先红方后蓝方，调用者需保证index有效）
+void eventBlockKeyframeUnit(const EventBlock* block, int index, KeyframeUnit* unit);
+
+#endif // EVENTLOG_H
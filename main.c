@@ -1,22 +1,18 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <time.h>
-#include <windows.h>
-#include <conio.h>
 #include "battlefield.h"
 #include "equipment.h"
 #include "simulation.h"
 #include "menu.h"
+#include "platform.h"
 
 // Forward declarations
 int simulateStep(Battlefield* battlefield); // Make sure simulateStep declaration is consistent
 
 int main() {
-    // 设置控制台代码页为UTF-8
-    SetConsoleOutputCP(65001);
-    
-    srand((unsigned int)time(NULL));
+    // 设置控制台为UTF-8输出
+    platformInitConsole();
     
     // 显示主菜单
     return showMainMenu();
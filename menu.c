@@ -2,10 +2,20 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <conio.h>
-#include <windows.h>
 #include <math.h>
+#include <time.h>
 #include "simulation.h"
+#include "distance.h"
+#include "platform.h"
+#include "replay.h"
+#include "scenario.h"
+#include "stencil.h"
+
+// 实时战斗的事件记录文件，可在"战斗回放"中打开
+#define LAST_BATTLE_RECORD "last_battle.bfev"
+
+// 编译时启用了热点路径统计时，上一场实时战斗的统计写入该文件
+#define LAST_BATTLE_STATS "last_battle_stats.json"
 
 // 计算字符串的显示宽度（考虑中文字符占两个宽度）
 int getStringDisplayWidth(const char* str) {
@@ -36,25 +46,18 @@ int getStringDisplayWidth(const char* str) {
 
 // 清屏函数
 void clearScreen() {
-    system("cls");
+    platformClearScreen();
 }
 
 // 等待按键
 void waitForKeyPress() {
     printf("\n按任意键继续...\n");
-    getch();
+    platformGetch();
 }
 
 // 获取控制台窗口宽度（字符数）
 int getConsoleWidth() {
-    CONSOLE_SCREEN_BUFFER_INFO csbi;
-    int width = 80; // 默认宽度
-    
-    if (GetConsoleScreenBufferInfo(GetStdHandle(STD_OUTPUT_HANDLE), &csbi)) {
-        width = csbi.srWindow.Right - csbi.srWindow.Left + 1;
-    }
-    
-    return width;
+    return platformGetConsoleWidth(80); // 默认宽度80
 }
 
 // 在指定宽度内居中打印文本
@@ -263,6 +266,7 @@ int showMainMenu() {
         drawTableBorder('+', '+', '+', '-', tableWidth);
         drawTableRow("1. 开始游戏", tableWidth);
         drawTableRow("2. 查看武器装备", tableWidth);
+        drawTableRow("3. 战斗回放", tableWidth);
         drawTableRow("0. 退出游戏", tableWidth);
         drawTableBorder('+', '+', '+', '-', tableWidth);
         
@@ -276,6 +280,9 @@ int showMainMenu() {
             case 2:
                 showEquipmentListMenu();
                 break;
+            case 3:
+                startBattleReplay();
+                break;
             case 0:
                 return 0;
             default:
@@ -671,93 +678,240 @@ void displayEquipmentDetails(int typeId) {
     waitForKeyPress();
 }
 
-// 绘制装备攻击范围
+// 绘制装备攻击范围（按攻击范围模板逐行标出范围内的格子）
 void drawAttackRange(int attackRadius) {
-    int size = attackRadius * 2 + 1;
-    int center = attackRadius;
-    
-    // 创建二维字符数组
-    char** grid = (char**)malloc(size * sizeof(char*));
-    for (int i = 0; i < size; i++) {
-        grid[i] = (char*)malloc(size * sizeof(char));
-        for (int j = 0; j < size; j++) {
-            grid[i][j] = ' ';
+    // 装备目录中的半径都有现成的模板，其他半径临时建立一个
+    RangeStencil local;
+    const RangeStencil* stencil = getRangeStencil(attackRadius);
+    if (!stencil) {
+        if (!initRangeStencil(&local, attackRadius, g_distanceMode)) {
+            return;
         }
+        stencil = &local;
     }
-    
-    // 标记中心点
-    grid[center][center] = 'X';
-    
-    // 标记攻击范围
-    for (int y = 0; y < size; y++) {
-        for (int x = 0; x < size; x++) {
-            int dx = x - center;
-            int dy = y - center;
-            int distance = (int)sqrt(dx*dx + dy*dy);
-            
-            if (distance <= attackRadius && grid[y][x] == ' ') {
-                grid[y][x] = '.';
+
+    // 中心标记为X，范围内的格子标记为.
+    for (int dy = -attackRadius; dy <= attackRadius; dy++) {
+        int halfWidth = stencil->halfWidths[dy + attackRadius];
+        for (int dx = -attackRadius; dx <= attackRadius; dx++) {
+            char mark = ' ';
+            if (dx == 0 && dy == 0) {
+                mark = 'X';
+            } else if (abs(dx) <= halfWidth) {
+                mark = '.';
             }
-        }
-    }
-    
-    // 打印攻击范围
-    for (int i = 0; i < size; i++) {
-        for (int j = 0; j < size; j++) {
-            printf("%c ", grid[i][j]);
+            printf("%c ", mark);
         }
         printf("\n");
     }
-    
-    // 释放内存
-    for (int i = 0; i < size; i++) {
-        free(grid[i]);
+
+    if (stencil == &local) {
+        freeRangeStencil(&local);
     }
-    free(grid);
 }
 
 // 战场模拟主程序
 void startBattleSimulation() {
     clearScreen();
     
-    // 初始化战场
-    Battlefield battlefield;
-    initBattlefield(&battlefield, 80, 60);
-    
     // 加载装备
     loadEquipmentTypes("equipment_types.txt");
     loadEquipmentInteractions("equipment_interactions.txt");
+    if (!loadDefaultBattlefieldConfig()) {
+        waitForKeyPress();
+        return;
+    }
     
-    printf("战场已初始化，开始部署装备...\n");
-    waitForKeyPress();
+    // 选择想定文件或手动部署
+    char filename[256];
+    printf("请输入想定文件名（输入 - 手动部署）: ");
+    if (scanf("%255s", filename) != 1) {
+        return;
+    }
+    int ch;
+    while ((ch = getchar()) != '\n' && ch != EOF) {
+    }
     
-    // 部署红蓝双方装备
-    deployEquipment(&battlefield, TEAM_RED);
-    deployEquipment(&battlefield, TEAM_BLUE);
+    // 初始化战场
+    Battlefield battlefield;
+    if (strcmp(filename, "-") != 0) {
+        if (!loadScenario(&battlefield, filename)) {
+            waitForKeyPress();
+            return;
+        }
+        printf("想定已加载: 战场 %dx%d，红方 %d 个装备，蓝方 %d 个装备\n", battlefield.width, battlefield.height,
+               battlefield.redUnits.count, battlefield.blueUnits.count);
+    } else {
+        if (!initBattlefield(&battlefield, g_battlefieldConfig.width, g_battlefieldConfig.height)) {
+            printf("内存分配失败\n");
+            waitForKeyPress();
+            return;
+        }
+        
+        printf("战场已初始化，开始部署装备...\n");
+        waitForKeyPress();
+        
+        // 部署红蓝双方装备
+        deployEquipment(&battlefield, TEAM_RED);
+        deployEquipment(&battlefield, TEAM_BLUE);
+    }
+    rngSeed(&battlefield.rng, (uint64_t)time(NULL), 0);
     
     printf("\n双方部署完成，按任意键开始战斗模拟...\n");
-    getch();
+    platformGetch();
+    
+    // 记录本场战斗，结束后可以回放（记录失败不影响战斗）
+    EventLog eventLog;
+    if (openEventLog(&eventLog, LAST_BATTLE_RECORD, battlefield.width, battlefield.height, DEFAULT_KEYFRAME_INTERVAL)) {
+        battlefield.eventLog = &eventLog;
+        eventLogDeployment(&eventLog, &battlefield);
+    }
+    
+    // 战斗阶段使用增量渲染器：每帧只更新变化的格子，弹道在下一帧统一绘制
+    Renderer renderer;
+    int useRenderer = initRenderer(&renderer, battlefield.width, battlefield.height);
+    if (useRenderer) {
+        battlefield.renderer = &renderer;
+    }
+    
+    // 收集热点路径统计（只在编译时启用了统计时）
+    BattleStats stats;
+    if (BATTLE_STATS_ENABLED) {
+        resetBattleStats(&stats);
+        battlefield.stats = &stats;
+    }
     
     // 开始战斗模拟
+    int tick = 0;
+    int result = 0;
     while (1) {
-        clearScreen();
-        renderBattlefield(&battlefield, TEAM_NONE); // 战斗阶段显示所有装备
+        if (useRenderer) {
+            rendererDrawFrame(&renderer, &battlefield); // 战斗阶段显示所有装备
+        } else {
+            clearScreen();
+            renderBattlefield(&battlefield, TEAM_NONE);
+        }
         
-        if (simulateStep(&battlefield)) {
+        tick++;
+        result = simulateStep(&battlefield);
+        if (result) {
             break; // 一方获胜，模拟结束
         }
         
         // 等待一段时间以便观察
-        Sleep(500); // Windows系统中的Sleep函数，单位为毫秒
+        platformSleep(500); // 单位为毫秒
     }
     
     // 最后显示一次战场状态
-    clearScreen();
-    renderBattlefield(&battlefield, TEAM_NONE);
+    if (useRenderer) {
+        rendererDrawFrame(&renderer, &battlefield);
+    } else {
+        clearScreen();
+        renderBattlefield(&battlefield, TEAM_NONE);
+    }
+    
+    printf("\n%s\n", getVictoryMessage(result));
+    
+    if (battlefield.stats) {
+        battlefield.stats = NULL;
+        FILE* statsFile = fopen(LAST_BATTLE_STATS, "w");
+        if (statsFile) {
+            writeBattleStatsJson(statsFile, &stats, -1, tick, 1);
+            fclose(statsFile);
+            printf("\n热点路径统计已写入 %s\n", LAST_BATTLE_STATS);
+        }
+    }
     
     printf("\n模拟结束！按任意键返回主菜单...\n");
-    getch();
+    platformGetch();
     
     // 释放资源
+    if (battlefield.eventLog) {
+        battlefield.eventLog = NULL;
+        closeEventLog(&eventLog);
+    }
+    battlefield.renderer = NULL;
+    if (useRenderer) {
+        freeRenderer(&renderer);
+    }
     freeBattlefield(&battlefield);
-} 
\ No newline at end of file
+} 
+
+// 战斗回放
+void startBattleReplay() {
+    char filename[256];
+    
+    clearScreen();
+    loadEquipmentTypes("equipment_types.txt");
+    
+    printf("请输入事件记录文件名（直接输入 - 打开上一场战斗 %s）: ", LAST_BATTLE_RECORD);
+    if (scanf("%255s", filename) != 1) {
+        return;
+    }
+    // 丢弃本行剩余的输入，避免被当作回放按键
+    int ch;
+    while ((ch = getchar()) != '\n' && ch != EOF) {
+    }
+    if (strcmp(filename, "-") == 0) {
+        strcpy(filename, LAST_BATTLE_RECORD);
+    }
+    
+    Replay replay;
+    if (!openReplay(&replay, filename)) {
+        waitForKeyPress();
+        return;
+    }
+    
+    Team viewOnly = TEAM_NONE;
+    while (1) {
+        clearScreen();
+        renderBattlefield(&replay.battlefield, viewOnly);
+        
+        const char* viewName = viewOnly == TEAM_RED ? "红方" : (viewOnly == TEAM_BLUE ? "蓝方" : "全部");
+        printf("\n回放: 第 %d / %d 步  视角: %s", replay.tick, replay.lastTick, viewName);
+        if (replay.tick == replay.lastTick && replay.result) {
+            printf("  结果: %s", replay.result == 1 ? "红方获胜" : (replay.result == 2 ? "蓝方获胜" : "平局"));
+        }
+        printf("\n[n]下一步 [p]上一步 [+]前进100步 [-]后退100步 [g]跳转 [1]红方视角 [2]蓝方视角 [0]全部 [q]退出\n");
+        
+        int key = platformGetch();
+        if (key == 'q' || key == 'Q' || key == EOF) {
+            break;
+        }
+        switch (key) {
+            case 'n': case 'N': case ' ':
+                replaySeek(&replay, replay.tick + 1);
+                break;
+            case 'p': case 'P':
+                replaySeek(&replay, replay.tick - 1);
+                break;
+            case '+': case '=':
+                replaySeek(&replay, replay.tick + 100);
+                break;
+            case '-':
+                replaySeek(&replay, replay.tick - 100);
+                break;
+            case 'g': case 'G': {
+                int tick;
+                printf("跳转到第几步 (0-%d): ", replay.lastTick);
+                if (scanf("%d", &tick) == 1) {
+                    replaySeek(&replay, tick);
+                }
+                while ((ch = getchar()) != '\n' && ch != EOF) {
+                }
+                break;
+            }
+            case '1':
+                viewOnly = TEAM_RED;
+                break;
+            case '2':
+                viewOnly = TEAM_BLUE;
+                break;
+            case '0':
+                viewOnly = TEAM_NONE;
+                break;
+        }
+    }
+    
+    closeReplay(&replay);
+}
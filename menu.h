@@ -37,6 +37,9 @@ void drawMultiColumnTableRow(const char** texts, int columnCount, int* columnWid
 // 战场模拟主程序
 void startBattleSimulation();
 
+// 战斗回放：打开事件记录文件，可逐步前进、后退或跳转到任意一步，并按队伍过滤显示
+void startBattleReplay();
+
 // 显示装备列表菜单
 void showEquipmentListMenu();
 
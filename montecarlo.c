@@ -0,0 +1,278 @@
+#include "montecarlo.h"
+#include <limits.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include "simulation.h"
+#include "platform.h"
+
+// 每次从任务计数器领取的战斗场数，减少原子操作竞争
+#define BATTLES_PER_CLAIM 16
+
+// 每个线程内存池第一块内存的大小，不够时自动扩容，重置后合并为一块
+#define BATTLE_ARENA_INITIAL_SIZE (256 * 1024)
+
+// 共同前缀使用的随机数流（战斗使用流0到battles-1，不会与之重叠）
+#define PREFIX_STREAM UINT64_MAX
+
+// 工作线程上下文
+// 每个线程独立累计统计结果，结束后由主线程汇总，无需加锁
+typedef struct {
+    const MonteCarloConfig* config;
+    atomic_int* nextBattle;
+    Arena arena;            // 本线程所有战斗共用的内存池，每场战斗结束后重置
+    MonteCarloResult local;
+    char padding[64]; // 避免相邻线程的统计结果共享缓存行
+} MonteCarloWorker;
+
+// 清空统计结果
+static void resetResult(MonteCarloResult* result) {
+    result->battles = 0;
+    result->redWins = 0;
+    result->blueWins = 0;
+    result->draws = 0;
+    result->timeouts = 0;
+    result->totalTicks = 0;
+    result->minTicks = INT_MAX;
+    result->maxTicks = 0;
+    result->recordFailures = 0;
+    result->failures = 0;
+}
+
+// 按配置初始化一场战斗的空战场，内存分配失败时返回0
+static int initBattleBattlefield(const MonteCarloConfig* config, Battlefield* battlefield, Arena* arena) {
+    const Scenario* scenario = config->scenario;
+    if (!initBattlefieldWithCapacity(battlefield, scenario->width, scenario->height, getScenarioCapacity(scenario),
+                                     arena)) {
+        return 0;
+    }
+    battlefield->headless = 1;
+    battlefield->tickMode = config->tickMode;
+    battlefield->threadPool = config->tickPool;
+    battlefield->typeCosts = config->typeCosts;
+    battlefield->typeCostCount = config->typeCostCount;
+    battlefield->targetCacheMode = config->targetCacheMode;
+    return 1;
+}
+
+// 运行一场战斗
+int runSingleBattle(const MonteCarloConfig* config, int battleIndex, int* ticks, Arena* arena, int* recordFailed) {
+    const Scenario* scenario = config->scenario;
+    Battlefield battlefield;
+    *ticks = 0;
+    if (recordFailed) {
+        *recordFailed = 0;
+    }
+    if (!initBattleBattlefield(config, &battlefield, arena)) {
+        if (arena) {
+            resetArena(arena);
+        }
+        return -1;
+    }
+
+    // 从共同前缀分支时恢复快照，之后换成本场战斗的随机数流，各分支从同一状态出发但互不相同
+    // 恢复快照同时恢复装备ID计数器（前缀从FIRST_EQUIPMENT_ID开始部署），否则部署前重置计数器，
+    // 装备ID只取决于想定，与本线程之前运行过哪些战斗无关
+    // 恢复失败时战场可能只恢复了一部分，重新初始化后从部署开始
+    int tick = 0;
+    if (config->branchPoint && restoreBattlefield(&battlefield, config->branchPoint)) {
+        tick = config->branchTick;
+    } else {
+        if (config->branchPoint) {
+            freeBattlefield(&battlefield);
+            if (arena) {
+                resetArena(arena);
+            }
+            if (!initBattleBattlefield(config, &battlefield, arena)) {
+                if (arena) {
+                    resetArena(arena);
+                }
+                return -1;
+            }
+        }
+        setNextEquipmentId(FIRST_EQUIPMENT_ID);
+        applyScenario(&battlefield, scenario);
+    }
+    rngSeed(&battlefield.rng, config->masterSeed, (uint64_t)battleIndex);
+
+    // 事件记录
+    EventLog eventLog;
+    int recording = 0;
+    int recordOk = 1;
+    if (config->recordDirectory) {
+        char path[1024];
+        snprintf(path, sizeof(path), "%s/battle_%d.bfev", config->recordDirectory, battleIndex);
+        recording = openEventLog(&eventLog, path, battlefield.width, battlefield.height, config->keyframeInterval);
+        recordOk = recording;
+        if (recording) {
+            battlefield.eventLog = &eventLog;
+            eventLogDeployment(&eventLog, &battlefield);
+        }
+    }
+
+    BattleStats stats;
+    if (config->statsFile) {
+        resetBattleStats(&stats);
+        battlefield.stats = &stats;
+    }
+
+    int result = 0;
+    while (tick < config->maxTicks) {
+        tick++;
+        result = simulateStep(&battlefield);
+        if (result) {
+            break;
+        }
+        if (config->statsFile && config->statsInterval > 0 && tick % config->statsInterval == 0) {
+            writeBattleStatsJson(config->statsFile, &stats, battleIndex, tick, 0);
+        }
+    }
+    if (config->statsFile) {
+        writeBattleStatsJson(config->statsFile, &stats, battleIndex, tick, 1);
+        battlefield.stats = NULL;
+    }
+
+    if (recording) {
+        battlefield.eventLog = NULL;
+        recordOk = closeEventLog(&eventLog);
+    }
+    if (recordFailed) {
+        *recordFailed = !recordOk;
+    }
+    if (config->targetCacheMismatches) {
+        __atomic_fetch_add(config->targetCacheMismatches, getTargetCacheMismatches(&battlefield), __ATOMIC_RELAXED);
+    }
+
+    freeBattlefield(&battlefield);
+    if (arena) {
+        resetArena(arena);
+    }
+    *ticks = tick;
+    return result;
+}
+
+// 模拟所有战斗共同的前缀
+int runBattlePrefix(const MonteCarloConfig* config, int ticks, BattlefieldSnapshot* snapshot) {
+    const Scenario* scenario = config->scenario;
+    Battlefield battlefield;
+    if (!initBattleBattlefield(config, &battlefield, NULL)) {
+        return 0;
+    }
+    rngSeed(&battlefield.rng, config->masterSeed, PREFIX_STREAM);
+    setNextEquipmentId(FIRST_EQUIPMENT_ID);
+    applyScenario(&battlefield, scenario);
+
+    int finished = 0;
+    for (int tick = 0; tick < ticks && !finished; tick++) {
+        finished = simulateStep(&battlefield);
+    }
+
+    int ok = !finished && snapshotBattlefield(&battlefield, snapshot);
+    if (config->targetCacheMismatches) {
+        __atomic_fetch_add(config->targetCacheMismatches, getTargetCacheMismatches(&battlefield), __ATOMIC_RELAXED);
+    }
+    freeBattlefield(&battlefield);
+    return ok;
+}
+
+// 工作线程主循环：不断领取下一批战斗，直到全部完成
+static void* monteCarloWorkerMain(void* arg) {
+    MonteCarloWorker* worker = (MonteCarloWorker*)arg;
+    const MonteCarloConfig* config = worker->config;
+    MonteCarloResult* local = &worker->local;
+
+    while (1) {
+        int first = atomic_fetch_add(worker->nextBattle, BATTLES_PER_CLAIM);
+        if (first >= config->battles) {
+            break;
+        }
+        int last = first + BATTLES_PER_CLAIM;
+        if (last > config->battles) {
+            last = config->battles;
+        }
+
+        for (int i = first; i < last; i++) {
+            int ticks;
+            int recordFailed;
+            int outcome = runSingleBattle(config, i, &ticks, worker->arena.current ? &worker->arena : NULL, &recordFailed);
+            if (outcome < 0) {
+                local->failures++;
+                continue;
+            }
+            switch (outcome) {
+                case 1: local->redWins++; break;
+                case 2: local->blueWins++; break;
+                case 3: local->draws++; break;
+                default: local->timeouts++; break;
+            }
+            local->battles++;
+            local->recordFailures += recordFailed;
+            local->totalTicks += ticks;
+            if (ticks < local->minTicks) local->minTicks = ticks;
+            if (ticks > local->maxTicks) local->maxTicks = ticks;
+        }
+    }
+    return NULL;
+}
+
+// 将多场战斗分配到多个线程并行运行，并汇总统计结果
+int runMonteCarlo(const MonteCarloConfig* config, MonteCarloResult* result) {
+    int threadCount = config->threads > 0 ? config->threads : platformGetCpuCount();
+    if (threadCount > config->battles) {
+        threadCount = config->battles > 0 ? config->battles : 1;
+    }
+
+    MonteCarloWorker* workers = (MonteCarloWorker*)malloc(threadCount * sizeof(MonteCarloWorker));
+    pthread_t* threads = (pthread_t*)malloc(threadCount * sizeof(pthread_t));
+    int* started = (int*)calloc(threadCount, sizeof(int));
+    if (!workers || !threads || !started) {
+        free(workers);
+        free(threads);
+        free(started);
+        return 0;
+    }
+
+    atomic_int nextBattle;
+    atomic_init(&nextBattle, 0);
+
+    for (int i = 0; i < threadCount; i++) {
+        workers[i].config = config;
+        workers[i].nextBattle = &nextBattle;
+        resetResult(&workers[i].local);
+        // 内存池创建失败时（current为NULL），该线程退回到每场战斗单独分配内存
+        initArena(&workers[i].arena, BATTLE_ARENA_INITIAL_SIZE);
+    }
+
+    // 主线程自己充当0号工作线程；其他线程创建失败时，剩余战斗由已启动的线程完成
+    for (int i = 1; i < threadCount; i++) {
+        started[i] = (pthread_create(&threads[i], NULL, monteCarloWorkerMain, &workers[i]) == 0);
+    }
+    monteCarloWorkerMain(&workers[0]);
+
+    // 汇总各线程的统计结果（整数求和与顺序无关，保证结果与线程数无关）
+    resetResult(result);
+    for (int i = 0; i < threadCount; i++) {
+        if (i > 0 && started[i]) {
+            pthread_join(threads[i], NULL);
+        }
+        const MonteCarloResult* local = &workers[i].local;
+        result->battles += local->battles;
+        result->redWins += local->redWins;
+        result->blueWins += local->blueWins;
+        result->draws += local->draws;
+        result->timeouts += local->timeouts;
+        result->totalTicks += local->totalTicks;
+        result->recordFailures += local->recordFailures;
+        result->failures += local->failures;
+        if (local->minTicks < result->minTicks) result->minTicks = local->minTicks;
+        if (local->maxTicks > result->maxTicks) result->maxTicks = local->maxTicks;
+        freeArena(&workers[i].arena);
+    }
+    if (result->battles == 0) {
+        result->minTicks = 0;
+    }
+
+    free(workers);
+    free(threads);
+    free(started);
+    return result->failures == 0;
+}
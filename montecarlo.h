@@ -0,0 +1,60 @@
+#ifndef MONTECARLO_H
+#define MONTECARLO_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include "battlefield.h"
+#include "snapshot.h"
+#include "scenario.h"
+
+// 蒙特卡洛批量对抗配置
+typedef struct {
+    const Scenario* scenario;     // 战场尺寸、预算和双方装备
+    int battles;                  // 战斗场数
+    int maxTicks;                 // 单场最大步数，超过记为超时
+    int threads;                  // 工作线程数 (<=0 表示使用全部CPU核心)
+    uint64_t masterSeed;          // 主种子，第i场战斗使用随机数流i
+    const char* recordDirectory;  // 不为NULL时把第i场战斗的事件记录写入该目录下的battle_i.bfev
+    int keyframeInterval;         // 事件记录的关键帧间隔（步数，<=0表示不写关键帧）
+    const BattlefieldSnapshot* branchPoint; // 不为NULL时每场战斗从该快照开始，而不是从部署开始
+    int branchTick;               // 快照所在的步数（计入每场战斗的步数）
+    TickMode tickMode;            // 每步模拟的处理方式
+    ThreadPool* tickPool;         // 不为NULL时两阶段模式的意图阶段在该线程池上并行（只应在单线程运行时设置）
+    const int* typeCosts;         // 按类型ID索引的造价表，部署时代替装备类型的造价（NULL表示不替换）
+    int typeCostCount;            // 造价表的长度
+    FILE* statsFile;              // 不为NULL时每场战斗收集热点路径统计，结束时以一行JSON写入（需要编译时定义BATTLE_STATS）
+    int statsInterval;            // 大于0时每隔这么多步也写一行当时的累计统计
+    TargetCacheMode targetCacheMode; // 攻击目标缓存的使用方式（0为默认的TARGET_CACHE_ON）
+    long long* targetCacheMismatches; // 不为NULL时累加校验模式中缓存查找与完整查找结果不同的次数（多个线程原子累加）
+} MonteCarloConfig;
+
+// 蒙特卡洛批量对抗统计结果
+typedef struct {
+    long long battles;    // 完成的战斗场数
+    long long redWins;    // 红方获胜场数
+    long long blueWins;   // 蓝方获胜场数
+    long long draws;      // 平局场数
+    long long timeouts;   // 超时场数
+    long long totalTicks; // 总步数
+    int minTicks;         // 最短战斗步数
+    int maxTicks;         // 最长战斗步数
+    long long recordFailures; // 事件记录写入失败的场数
+    long long failures;   // 内存分配失败而没有运行的场数（不计入battles）
+} MonteCarloResult;
+
+// 运行一场战斗，返回checkVictory的结果（0表示超时，-1表示内存分配失败而没有运行），ticks返回实际步数
+// battleIndex决定该场战斗使用的随机数流
+// arena不为NULL时战斗的所有内存从该内存池分配，结束后重置内存池；为NULL时单独分配
+// 配置了记录目录时同时写出事件记录，recordFailed返回记录是否失败（可以为NULL）
+int runSingleBattle(const MonteCarloConfig* config, int battleIndex, int* ticks, Arena* arena, int* recordFailed);
+
+// 按想定用专门的随机数流模拟前ticks步，把结束时的状态保存到snapshot，作为所有战斗共同的前缀
+// 成功返回1，战斗在此之前已经分出胜负或内存分配失败时返回0
+int runBattlePrefix(const MonteCarloConfig* config, int ticks, BattlefieldSnapshot* snapshot);
+
+// 将多场战斗分配到多个线程并行运行，并汇总统计结果
+// 对于相同的主种子，无论线程数多少，结果完全相同
+// 成功返回1，内存分配失败（包括有战斗因此没有运行）返回0
+int runMonteCarlo(const MonteCarloConfig* config, MonteCarloResult* result);
+
+#endif // MONTECARLO_H
@@ -0,0 +1,492 @@
+#include "paramsweep.h"
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+#include "montecarlo.h"
+#include "platform.h"
+
+// 扫描说明文件一行的最大长度和最多的字段数
+#define SWEEP_LINE_LENGTH 4096
+#define SWEEP_MAX_FIELDS 256
+
+// 每个线程内存池第一块内存的大小，不够时自动扩容，重置后合并为一块
+#define SWEEP_ARENA_INITIAL_SIZE (256 * 1024)
+
+// 数值字段的上限，避免溢出
+#define SWEEP_MAX_VALUE 1000000000
+
+// 工作线程上下文：自己的内存池、当前扫描点的想定和造价表
+typedef struct {
+    const Sweep* sweep;
+    Arena arena;                // 本线程所有战斗共用的内存池，每场战斗结束后重置
+    MonteCarloConfig config;    // 单场战斗的配置，指向本线程的想定和造价表
+    Scenario scenario;          // 当前扫描点的想定（条目数组由本线程所有）
+    int entryCapacity;
+    int* costs;                 // 当前扫描点的造价表（按类型ID索引）
+    int costCount;
+    int point;                  // 当前扫描点（-1表示还没有）
+    char padding[64];           // 避免相邻线程的上下文共享缓存行
+} SweepWorker;
+
+// 去掉字符串首尾的空白
+static char* trim(char* text) {
+    while (*text == ' ' || *text == '\t') {
+        text++;
+    }
+    char* end = text + strlen(text);
+    while (end > text && (end[-1] == ' ' || end[-1] == '\t' || end[-1] == '\r' || end[-1] == '\n')) {
+        *--end = '\0';
+    }
+    return text;
+}
+
+// 去掉注释后把一行按逗号拆分为字段，返回字段数（空行返回0）
+static int splitFields(char* line, char** fields, int maxFields) {
+    char* comment = strchr(line, '#');
+    if (comment) {
+        *comment = '\0';
+    }
+    if (*trim(line) == '\0') {
+        return 0;
+    }
+
+    int count = 0;
+    char* field = line;
+    while (count < maxFields) {
+        char* comma = strchr(field, ',');
+        if (comma) {
+            *comma = '\0';
+        }
+        fields[count++] = trim(field);
+        if (!comma) {
+            break;
+        }
+        field = comma + 1;
+    }
+    return count;
+}
+
+// 解析一个非负整数字段
+static int parseNumber(const char* text, int* value) {
+    char* end;
+    long number = strtol(text, &end, 10);
+    if (end == text || *end != '\0' || number < 0 || number > SWEEP_MAX_VALUE) {
+        return 0;
+    }
+    *value = (int)number;
+    return 1;
+}
+
+// 复制一个字符串
+static char* copyString(const char* text) {
+    char* copy = (char*)malloc(strlen(text) + 1);
+    if (copy) {
+        strcpy(copy, text);
+    }
+    return copy;
+}
+
+// 用字段fields[0..count)作为取值初始化一个扫描参数，文件参数同时解析每个想定文件
+static const char* initSweepParameter(SweepParameter* parameter, char** fields, int count, int isFile) {
+    parameter->valueCount = count;
+    parameter->values = (int*)calloc(count, sizeof(int));
+    parameter->names = (char**)calloc(count, sizeof(char*));
+    parameter->scenarios = isFile ? (Scenario*)calloc(count, sizeof(Scenario)) : NULL;
+    if (!parameter->values || !parameter->names || (isFile && !parameter->scenarios)) {
+        return "内存分配失败";
+    }
+
+    for (int i = 0; i < count; i++) {
+        parameter->names[i] = copyString(fields[i]);
+        if (!parameter->names[i]) {
+            return "内存分配失败";
+        }
+        if (isFile) {
+            if (!parseScenario(&parameter->scenarios[i], fields[i])) {
+                parameter->scenarios[i].units.entries = NULL;
+                return "无法加载想定文件";
+            }
+        } else if (!parseNumber(fields[i], &parameter->values[i])) {
+            return "取值应为非负整数";
+        }
+    }
+    return NULL;
+}
+
+// 释放一个扫描参数
+static void freeSweepParameter(SweepParameter* parameter) {
+    for (int i = 0; i < parameter->valueCount; i++) {
+        if (parameter->names) {
+            free(parameter->names[i]);
+        }
+        if (parameter->scenarios) {
+            freeScenario(&parameter->scenarios[i]);
+        }
+    }
+    free(parameter->values);
+    free(parameter->names);
+    free(parameter->scenarios);
+}
+
+// 解析一行设置或扫描参数，成功返回NULL，否则返回错误原因
+static const char* parseSweepLine(Sweep* sweep, char** fields, int count) {
+    const char* key = fields[0];
+    int value;
+
+    if (strcmp(key, "battles") == 0 || strcmp(key, "max_ticks") == 0 || strcmp(key, "two_phase") == 0 ||
+        strcmp(key, "seed") == 0) {
+        if (count != 2 || !parseNumber(fields[1], &value)) {
+            return "格式错误，应为 名称,非负整数";
+        }
+        if (strcmp(key, "battles") == 0) {
+            if (value < 1) return "战斗场数至少为1";
+            sweep->battles = value;
+        } else if (strcmp(key, "max_ticks") == 0) {
+            if (value < 1) return "最大步数至少为1";
+            sweep->maxTicks = value;
+        } else if (strcmp(key, "two_phase") == 0) {
+            sweep->tickMode = value ? TICK_TWO_PHASE : TICK_SEQUENTIAL;
+        } else {
+            sweep->seed = (unsigned long long)value;
+        }
+        return NULL;
+    }
+
+    SweepParameter parameter;
+    memset(&parameter, 0, sizeof(parameter));
+    int firstValue = 1;
+    int isFile = 0;
+
+    if (strcmp(key, "scenario") == 0 || strcmp(key, "red") == 0 || strcmp(key, "blue") == 0) {
+        parameter.kind = key[0] == 's' ? SWEEP_SCENARIO : (key[0] == 'r' ? SWEEP_RED : SWEEP_BLUE);
+        snprintf(parameter.column, sizeof(parameter.column), "%s", key);
+        isFile = 1;
+    } else if (strcmp(key, "budget") == 0) {
+        if (count < 3 || (strcmp(fields[1], "R") != 0 && strcmp(fields[1], "B") != 0)) {
+            return "格式错误，应为 budget,R|B,值1,值2,...";
+        }
+        parameter.kind = SWEEP_BUDGET;
+        parameter.team = fields[1][0] == 'R' ? TEAM_RED : TEAM_BLUE;
+        snprintf(parameter.column, sizeof(parameter.column), "budget_%s", fields[1]);
+        firstValue = 2;
+    } else if (strcmp(key, "cost") == 0 || strcmp(key, "cost_percent") == 0) {
+        if (count < 3 || !parseNumber(fields[1], &parameter.typeId) || !getEquipmentTypeById(parameter.typeId)) {
+            return "格式错误或装备类型不存在，应为 cost|cost_percent,typeId,值1,值2,...";
+        }
+        parameter.kind = strcmp(key, "cost") == 0 ? SWEEP_COST : SWEEP_COST_PERCENT;
+        snprintf(parameter.column, sizeof(parameter.column), "%s_%d", key, parameter.typeId);
+        firstValue = 2;
+    } else {
+        return "无法识别的行";
+    }
+
+    if (count <= firstValue) {
+        return "至少需要一个取值";
+    }
+    if (parameter.kind == SWEEP_SCENARIO && sweep->scenarioParameter >= 0) {
+        return "只能有一行scenario";
+    }
+
+    // 先放入参数数组，出错时也由freeSweep统一释放
+    SweepParameter* parameters = (SweepParameter*)realloc(sweep->parameters,
+                                                          (sweep->parameterCount + 1) * sizeof(SweepParameter));
+    if (!parameters) {
+        return "内存分配失败";
+    }
+    sweep->parameters = parameters;
+    SweepParameter* added = &parameters[sweep->parameterCount++];
+    *added = parameter;
+    if (added->kind == SWEEP_SCENARIO) {
+        sweep->scenarioParameter = sweep->parameterCount - 1;
+    }
+    return initSweepParameter(added, fields + firstValue, count - firstValue, isFile);
+}
+
+// 解析扫描说明文件
+int parseSweep(Sweep* sweep, const char* filename) {
+    memset(sweep, 0, sizeof(*sweep));
+    sweep->battles = 100;
+    sweep->seed = 1;
+    sweep->maxTicks = 10000;
+    sweep->tickMode = TICK_SEQUENTIAL;
+    sweep->scenarioParameter = -1;
+
+    FILE* file = fopen(filename, "r");
+    if (!file) {
+        printf("无法打开扫描说明文件: %s\n", filename);
+        return 0;
+    }
+
+    char buffer[SWEEP_LINE_LENGTH];
+    char* fields[SWEEP_MAX_FIELDS];
+    const char* error = NULL;
+    int line = 0;
+    while (!error && fgets(buffer, sizeof(buffer), file)) {
+        line++;
+        int count = splitFields(buffer, fields, SWEEP_MAX_FIELDS);
+        if (count > 0) {
+            error = parseSweepLine(sweep, fields, count);
+        }
+    }
+    fclose(file);
+
+    if (!error && sweep->scenarioParameter < 0) {
+        error = "缺少scenario行";
+        line = 0;
+    }
+
+    // 扫描点数为各参数取值数的乘积，总战斗场数不能超出int范围
+    long long points = 1;
+    for (int i = 0; !error && i < sweep->parameterCount; i++) {
+        points *= sweep->parameters[i].valueCount;
+        if (points * sweep->battles > INT_MAX) {
+            error = "扫描点太多";
+            line = 0;
+        }
+    }
+
+    if (error) {
+        if (line > 0) {
+            printf("扫描说明文件 %s 第%d行: %s\n", filename, line, error);
+        } else {
+            printf("扫描说明文件 %s: %s\n", filename, error);
+        }
+        freeSweep(sweep);
+        return 0;
+    }
+    sweep->pointCount = (int)points;
+    return 1;
+}
+
+// 释放扫描资源
+void freeSweep(Sweep* sweep) {
+    for (int i = 0; i < sweep->parameterCount; i++) {
+        freeSweepParameter(&sweep->parameters[i]);
+    }
+    free(sweep->parameters);
+    free(sweep->outcomes);
+    free(sweep->ticks);
+    memset(sweep, 0, sizeof(*sweep));
+}
+
+// 第point个扫描点中第parameter个参数的取值下标
+int getSweepValueIndex(const Sweep* sweep, int point, int parameter) {
+    for (int i = sweep->parameterCount - 1; i > parameter; i--) {
+        point /= sweep->parameters[i].valueCount;
+    }
+    return point % sweep->parameters[parameter].valueCount;
+}
+
+// 把source中属于team的条目追加到scenario，记录该方大本营的新下标
+static void appendTeamEntries(Scenario* scenario, const Scenario* source, Team team) {
+    int sourceHQ = team == TEAM_RED ? source->redHQEntry : source->blueHQEntry;
+    for (int i = 0; i < source->units.count; i++) {
+        const DeploymentEntry* entry = &source->units.entries[i];
+        if (entry->team != team) {
+            continue;
+        }
+        if (i == sourceHQ) {
+            if (team == TEAM_RED) {
+                scenario->redHQEntry = scenario->units.count;
+            } else {
+                scenario->blueHQEntry = scenario->units.count;
+            }
+        }
+        scenario->units.entries[scenario->units.count++] = *entry;
+    }
+}
+
+// 为工作线程构造第point个扫描点的想定和造价表，内存分配失败时返回0
+static int buildSweepPoint(SweepWorker* worker, int point) {
+    const Sweep* sweep = worker->sweep;
+    const SweepParameter* scenarioParameter = &sweep->parameters[sweep->scenarioParameter];
+    const Scenario* base = &scenarioParameter->scenarios[getSweepValueIndex(sweep, point, sweep->scenarioParameter)];
+
+    // 双方装备的来源
+    const Scenario* redSource = base;
+    const Scenario* blueSource = base;
+    for (int i = 0; i < sweep->parameterCount; i++) {
+        const SweepParameter* parameter = &sweep->parameters[i];
+        if (parameter->kind == SWEEP_RED) {
+            redSource = &parameter->scenarios[getSweepValueIndex(sweep, point, i)];
+        } else if (parameter->kind == SWEEP_BLUE) {
+            blueSource = &parameter->scenarios[getSweepValueIndex(sweep, point, i)];
+        }
+    }
+
+    Scenario* scenario = &worker->scenario;
+    int needed = redSource->redCount + blueSource->blueCount;
+    if (needed > worker->entryCapacity) {
+        DeploymentEntry* entries = (DeploymentEntry*)realloc(scenario->units.entries,
+                                                             needed * sizeof(DeploymentEntry));
+        if (!entries) {
+            return 0;
+        }
+        scenario->units.entries = entries;
+        worker->entryCapacity = needed;
+    }
+
+    scenario->width = base->width;
+    scenario->height = base->height;
+    scenario->redBudget = base->redBudget;
+    scenario->blueBudget = base->blueBudget;
+    scenario->maxEquipments = base->maxEquipments;
+    scenario->redCount = redSource->redCount;
+    scenario->blueCount = blueSource->blueCount;
+    scenario->redHQEntry = -1;
+    scenario->blueHQEntry = -1;
+    scenario->units.count = 0;
+    appendTeamEntries(scenario, redSource, TEAM_RED);
+    appendTeamEntries(scenario, blueSource, TEAM_BLUE);
+
+    // 造价表从装备类型的造价开始，先应用cost再应用cost_percent
+    for (int i = 0; i < g_equipmentTypesCount; i++) {
+        worker->costs[g_equipmentTypes[i].typeId] = g_equipmentTypes[i].cost;
+    }
+    for (int pass = 0; pass < 2; pass++) {
+        for (int i = 0; i < sweep->parameterCount; i++) {
+            const SweepParameter* parameter = &sweep->parameters[i];
+            int value = parameter->values[getSweepValueIndex(sweep, point, i)];
+            if (pass == 0 && parameter->kind == SWEEP_BUDGET) {
+                if (parameter->team == TEAM_RED) {
+                    scenario->redBudget = value;
+                } else {
+                    scenario->blueBudget = value;
+                }
+            } else if (pass == 0 && parameter->kind == SWEEP_COST) {
+                worker->costs[parameter->typeId] = value;
+            } else if (pass == 1 && parameter->kind == SWEEP_COST_PERCENT) {
+                worker->costs[parameter->typeId] = (int)((long long)worker->costs[parameter->typeId] * value / 100);
+            }
+        }
+    }
+    return 1;
+}
+
+// 运行一场战斗（任务编号 = 扫描点 * 每点场数 + 场次）
+static void runSweepJob(void* context, int job) {
+    SweepWorker* worker = (SweepWorker*)context;
+    Sweep* sweep = (Sweep*)worker->sweep;
+    int point = job / sweep->battles;
+
+    if (point != worker->point) {
+        worker->point = buildSweepPoint(worker, point) ? point : -1;
+        if (worker->point < 0) {
+            sweep->outcomes[job] = -1;
+            sweep->ticks[job] = 0;
+            return;
+        }
+    }
+
+    int ticks;
+    int outcome = runSingleBattle(&worker->config, job % sweep->battles, &ticks,
+                                  worker->arena.current ? &worker->arena : NULL, NULL);
+    sweep->outcomes[job] = (signed char)outcome;
+    sweep->ticks[job] = ticks;
+}
+
+// 运行全部扫描点的全部战斗
+int runSweep(Sweep* sweep, int threads, JobStats* stats) {
+    int jobs = sweep->pointCount * sweep->battles;
+    int threadCount = threads > 0 ? threads : platformGetCpuCount();
+    if (threadCount > jobs) {
+        threadCount = jobs > 0 ? jobs : 1;
+    }
+
+    // 造价表覆盖全部类型ID
+    int costCount = 0;
+    for (int i = 0; i < g_equipmentTypesCount; i++) {
+        if (g_equipmentTypes[i].typeId >= costCount) {
+            costCount = g_equipmentTypes[i].typeId + 1;
+        }
+    }
+
+    free(sweep->outcomes);
+    free(sweep->ticks);
+    sweep->outcomes = (signed char*)malloc(jobs > 0 ? jobs : 1);
+    sweep->ticks = (int*)malloc((jobs > 0 ? jobs : 1) * sizeof(int));
+    SweepWorker* workers = (SweepWorker*)calloc(threadCount, sizeof(SweepWorker));
+    void** contexts = (void**)malloc(threadCount * sizeof(void*));
+    int ok = sweep->outcomes && sweep->ticks && workers && contexts;
+
+    for (int i = 0; ok && i < threadCount; i++) {
+        SweepWorker* worker = &workers[i];
+        worker->sweep = sweep;
+        worker->point = -1;
+        worker->costCount = costCount;
+        worker->costs = (int*)calloc(costCount > 0 ? costCount : 1, sizeof(int));
+        if (!worker->costs) {
+            ok = 0;
+            break;
+        }
+        // 内存池创建失败时（current为NULL），该线程退回到每场战斗单独分配内存
+        initArena(&worker->arena, SWEEP_ARENA_INITIAL_SIZE);
+
+        MonteCarloConfig* config = &worker->config;
+        memset(config, 0, sizeof(*config));
+        config->scenario = &worker->scenario;
+        config->battles = sweep->battles;
+        config->maxTicks = sweep->maxTicks;
+        config->threads = 1;
+        config->masterSeed = sweep->seed;
+        config->keyframeInterval = 0;
+        config->tickMode = sweep->tickMode;
+        config->typeCosts = worker->costs;
+        config->typeCostCount = costCount;
+        contexts[i] = worker;
+    }
+
+    if (ok) {
+        ok = runJobs(jobs, threadCount, runSweepJob, contexts, stats);
+    }
+
+    for (int i = 0; workers && i < threadCount; i++) {
+        freeArena(&workers[i].arena);
+        free(workers[i].costs);
+        free(workers[i].scenario.units.entries);
+    }
+    free(workers);
+    free(contexts);
+    return ok;
+}
+
+// 汇总第point个扫描点的统计结果
+void getSweepPointResult(const Sweep* sweep, int point, SweepPointResult* result) {
+    memset(result, 0, sizeof(*result));
+    int first = point * sweep->battles;
+    for (int job = first; job < first + sweep->battles; job++) {
+        switch (sweep->outcomes[job]) {
+            case 1: result->redWins++; break;
+            case 2: result->blueWins++; break;
+            case 3: result->draws++; break;
+            case 0: result->timeouts++; break;
+            default: result->failures++; break;
+        }
+        result->totalTicks += sweep->ticks[job];
+    }
+}
+
+// 以CSV格式写出结果表
+void writeSweepResults(const Sweep* sweep, FILE* file) {
+    fprintf(file, "point");
+    for (int i = 0; i < sweep->parameterCount; i++) {
+        fprintf(file, ",%s", sweep->parameters[i].column);
+    }
+    fprintf(file, ",battles,red_wins,blue_wins,draws,timeouts,failures,red_win_rate,blue_win_rate,avg_ticks\n");
+
+    for (int point = 0; point < sweep->pointCount; point++) {
+        fprintf(file, "%d", point);
+        for (int i = 0; i < sweep->parameterCount; i++) {
+            fprintf(file, ",%s", sweep->parameters[i].names[getSweepValueIndex(sweep, point, i)]);
+        }
+
+        SweepPointResult result;
+        getSweepPointResult(sweep, point, &result);
+        int completed = sweep->battles - result.failures;
+        fprintf(file, ",%d,%d,%d,%d,%d,%d,%.4f,%.4f,%.1f\n", sweep->battles, result.redWins, result.blueWins,
+                result.draws, result.timeouts, result.failures,
+                completed > 0 ? (double)result.redWins / completed : 0.0,
+                completed > 0 ? (double)result.blueWins / completed : 0.0,
+                completed > 0 ? (double)result.totalTicks / completed : 0.0);
+    }
+}
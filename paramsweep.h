@@ -0,0 +1,89 @@
+#ifndef PARAMSWEEP_H
+#define PARAMSWEEP_H
+
+#include <stdio.h>
+#include "scenario.h"
+#include "scheduler.h"
+
+// 参数扫描
+// 扫描说明文件是文本格式，每行一条，#之后为注释，字段用逗号分隔：
+//   battles,N                      每个扫描点的战斗场数（默认100）
+//   seed,S                         主随机数种子，每个扫描点的第i场战斗都使用随机数流i（默认1）
+//   max_ticks,N                    单场战斗最大步数（默认10000）
+//   two_phase,0|1                  是否使用两阶段模式（默认0）
+// 以下每行是一个扫描参数，列出它的全部取值，所有参数的取值组合（笛卡尔积）就是全部扫描点：
+//   scenario,文件1,文件2,...        基础想定（必须有且只有一行）
+//   red,文件1,文件2,...             红方装备（包括大本营）取自这些想定文件中的红方条目，代替基础想定中的红方
+//   blue,文件1,文件2,...            蓝方装备取自这些想定文件中的蓝方条目
+//   budget,R|B,值1,值2,...          一方的预算
+//   cost,typeId,值1,值2,...         一种装备的造价
+//   cost_percent,typeId,值1,...     一种装备的造价占原造价的百分比（与cost同时出现时作用在cost之后）
+// 每场战斗都是一个任务，由工作窃取调度器分给各线程；每个线程有自己的内存池和造价表，
+// 同一个扫描点的战斗编号相邻，通常在同一个线程上连续运行，扫描点的想定和造价表只在切换时重建
+
+// 扫描参数的种类
+typedef enum {
+    SWEEP_SCENARIO,
+    SWEEP_RED,
+    SWEEP_BLUE,
+    SWEEP_BUDGET,
+    SWEEP_COST,
+    SWEEP_COST_PERCENT
+} SweepParameterKind;
+
+// 一个扫描参数
+typedef struct {
+    SweepParameterKind kind;
+    Team team;              // budget的队伍
+    int typeId;             // cost和cost_percent的装备类型
+    int valueCount;
+    int* values;            // 数值参数的取值
+    Scenario* scenarios;    // 文件参数（scenario、red、blue）每个取值对应的已解析想定
+    char** names;           // 每个取值的文字（写入结果表）
+    char column[32];        // 结果表中的列名
+} SweepParameter;
+
+// 一个扫描点的统计结果
+typedef struct {
+    int redWins;
+    int blueWins;
+    int draws;
+    int timeouts;
+    int failures;           // 内存分配失败而没有运行的战斗
+    long long totalTicks;
+} SweepPointResult;
+
+// 参数扫描
+typedef struct {
+    int battles;            // 每个扫描点的战斗场数
+    unsigned long long seed;
+    int maxTicks;
+    TickMode tickMode;
+    SweepParameter* parameters;
+    int parameterCount;
+    int scenarioParameter;  // scenario参数的下标
+    int pointCount;         // 扫描点数（所有参数取值数的乘积）
+    signed char* outcomes;  // 每场战斗的结果（checkVictory的返回值，0为超时，-1为没有运行）
+    int* ticks;             // 每场战斗的步数
+} Sweep;
+
+// 解析扫描说明文件并加载其中引用的全部想定文件，格式错误时报告行号并返回0，成功返回1
+int parseSweep(Sweep* sweep, const char* filename);
+
+// 释放扫描资源
+void freeSweep(Sweep* sweep);
+
+// 第point个扫描点中第parameter个参数的取值下标（最后一个参数变化最快）
+int getSweepValueIndex(const Sweep* sweep, int point, int parameter);
+
+// 用threads个线程（<=0表示全部CPU核心）运行全部扫描点的全部战斗
+// 成功返回1，内存分配失败返回0；结果与线程数和调度顺序无关
+int runSweep(Sweep* sweep, int threads, JobStats* stats);
+
+// 汇总第point个扫描点的统计结果
+void getSweepPointResult(const Sweep* sweep, int point, SweepPointResult* result);
+
+// 把结果表以CSV格式写入file：每个扫描点一行，依次为各参数的取值和统计结果
+void writeSweepResults(const Sweep* sweep, FILE* file);
+
+#endif // PARAMSWEEP_H
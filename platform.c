@@ -0,0 +1,235 @@
+#include "platform.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <conio.h>
+#else
+#include <termios.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+// 初始化控制台（设置UTF-8输出等）
+void platformInitConsole(void) {
+#ifdef _WIN32
+    // 设置控制台代码页为UTF-8
+    SetConsoleOutputCP(65001);
+
+    // 启用ANSI转义序列（增量渲染器使用ANSI光标移动和颜色）
+    HANDLE hConsole = GetStdHandle(STD_OUTPUT_HANDLE);
+    DWORD mode = 0;
+    if (GetConsoleMode(hConsole, &mode)) {
+#ifndef ENABLE_VIRTUAL_TERMINAL_PROCESSING
+#define ENABLE_VIRTUAL_TERMINAL_PROCESSING 0x0004
+#endif
+        SetConsoleMode(hConsole, mode | ENABLE_VIRTUAL_TERMINAL_PROCESSING);
+    }
+#endif
+}
+
+// 清屏
+void platformClearScreen(void) {
+#ifdef _WIN32
+    system("cls");
+#else
+    // 清屏并将光标移动到左上角
+    printf("\033[2J\033[H");
+    fflush(stdout);
+#endif
+}
+
+// 暂停指定毫秒数
+void platformSleep(int milliseconds) {
+#ifdef _WIN32
+    Sleep(milliseconds);
+#else
+    fflush(stdout);
+    usleep((useconds_t)milliseconds * 1000);
+#endif
+}
+
+// 读取一个按键（不回显）
+int platformGetch(void) {
+#ifdef _WIN32
+    return getch();
+#else
+    fflush(stdout);
+    struct termios oldAttrs;
+    if (tcgetattr(STDIN_FILENO, &oldAttrs) != 0) {
+        // 标准输入不是终端，直接读取一个字符
+        return getchar();
+    }
+
+    struct termios rawAttrs = oldAttrs;
+    rawAttrs.c_lflag &= ~(ICANON | ECHO);
+    tcsetattr(STDIN_FILENO, TCSANOW, &rawAttrs);
+    int ch = getchar();
+    tcsetattr(STDIN_FILENO, TCSANOW, &oldAttrs);
+    return ch;
+#endif
+}
+
+// 获取控制台窗口宽度（字符数），获取失败时返回默认值
+int platformGetConsoleWidth(int defaultWidth) {
+#ifdef _WIN32
+    CONSOLE_SCREEN_BUFFER_INFO csbi;
+    if (GetConsoleScreenBufferInfo(GetStdHandle(STD_OUTPUT_HANDLE), &csbi)) {
+        return csbi.srWindow.Right - csbi.srWindow.Left + 1;
+    }
+#else
+    struct winsize ws;
+    if (ioctl(STDOUT_FILENO, TIOCGWINSZ, &ws) == 0 && ws.ws_col > 0) {
+        return ws.ws_col;
+    }
+#endif
+    return defaultWidth;
+}
+
+// 获取控制台窗口高度
+int platformGetConsoleHeight(int defaultHeight) {
+#ifdef _WIN32
+    CONSOLE_SCREEN_BUFFER_INFO csbi;
+    if (GetConsoleScreenBufferInfo(GetStdHandle(STD_OUTPUT_HANDLE), &csbi)) {
+        return csbi.srWindow.Bottom - csbi.srWindow.Top + 1;
+    }
+#else
+    struct winsize ws;
+    if (ioctl(STDOUT_FILENO, TIOCGWINSZ, &ws) == 0 && ws.ws_row > 0) {
+        return ws.ws_row;
+    }
+#endif
+    return defaultHeight;
+}
+
+// 移动光标到指定位置（从0开始的列和行）
+void platformSetCursorPosition(int column, int row) {
+#ifdef _WIN32
+    fflush(stdout);
+    COORD pos = {(SHORT)column, (SHORT)row};
+    SetConsoleCursorPosition(GetStdHandle(STD_OUTPUT_HANDLE), pos);
+#else
+    // ANSI转义序列的行列从1开始
+    printf("\033[%d;%dH", row + 1, column + 1);
+#endif
+}
+
+// 设置文字颜色
+void platformSetTextColor(ConsoleColor color) {
+#ifdef _WIN32
+    static WORD originalAttrs = 0;
+    static int originalSaved = 0;
+    HANDLE hConsole = GetStdHandle(STD_OUTPUT_HANDLE);
+    fflush(stdout);
+
+    // 首次调用时保存原始颜色属性，用于恢复
+    if (!originalSaved) {
+        CONSOLE_SCREEN_BUFFER_INFO consoleInfo;
+        if (GetConsoleScreenBufferInfo(hConsole, &consoleInfo)) {
+            originalAttrs = consoleInfo.wAttributes;
+        } else {
+            originalAttrs = FOREGROUND_RED | FOREGROUND_GREEN | FOREGROUND_BLUE;
+        }
+        originalSaved = 1;
+    }
+
+    switch (color) {
+        case CONSOLE_COLOR_RED:
+            SetConsoleTextAttribute(hConsole, FOREGROUND_RED | FOREGROUND_INTENSITY);
+            break;
+        case CONSOLE_COLOR_BLUE:
+            SetConsoleTextAttribute(hConsole, FOREGROUND_BLUE | FOREGROUND_INTENSITY);
+            break;
+        default:
+            SetConsoleTextAttribute(hConsole, originalAttrs);
+            break;
+    }
+#else
+    switch (color) {
+        case CONSOLE_COLOR_RED:
+            printf("\033[1;31m");
+            break;
+        case CONSOLE_COLOR_BLUE:
+            printf("\033[1;34m");
+            break;
+        default:
+            printf("\033[0m");
+            break;
+    }
+#endif
+}
+
+// 获取可用的CPU核心数
+int platformGetCpuCount(void) {
+#ifdef _WIN32
+    SYSTEM_INFO systemInfo;
+    GetSystemInfo(&systemInfo);
+    return systemInfo.dwNumberOfProcessors > 0 ? (int)systemInfo.dwNumberOfProcessors : 1;
+#else
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+    return count > 0 ? (int)count : 1;
+#endif
+}
+
+// 把文件只读映射到内存
+const void* platformMapFile(const char* filename, size_t* size) {
+    *size = 0;
+#ifdef _WIN32
+    HANDLE file = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE) {
+        return NULL;
+    }
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0) {
+        CloseHandle(file);
+        return NULL;
+    }
+    HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    CloseHandle(file);
+    if (!mapping) {
+        return NULL;
+    }
+    // 映射视图会保持对文件映射对象的引用，句柄可以立即关闭
+    const void* data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    CloseHandle(mapping);
+    if (!data) {
+        return NULL;
+    }
+    *size = (size_t)fileSize.QuadPart;
+    return data;
+#else
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) {
+        return NULL;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+        close(fd);
+        return NULL;
+    }
+    void* data = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        return NULL;
+    }
+    *size = (size_t)st.st_size;
+    return data;
+#endif
+}
+
+// 解除文件映射
+void platformUnmapFile(const void* data, size_t size) {
+    if (!data) {
+        return;
+    }
+#ifdef _WIN32
+    (void)size;
+    UnmapViewOfFile(data);
+#else
+    munmap((void*)data, size);
+#endif
+}
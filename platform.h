@@ -0,0 +1,49 @@
+#ifndef PLATFORM_H
+#define PLATFORM_H
+
+#include <stddef.h>
+
+// 平台相关的控制台功能封装
+// Windows下使用控制台API和conio.h，其他平台使用POSIX终端和ANSI转义序列
+
+// 控制台文字颜色
+typedef enum {
+    CONSOLE_COLOR_DEFAULT,
+    CONSOLE_COLOR_RED,
+    CONSOLE_COLOR_BLUE
+} ConsoleColor;
+
+// 初始化控制台（设置UTF-8输出等）
+void platformInitConsole(void);
+
+// 清屏
+void platformClearScreen(void);
+
+// 暂停指定毫秒数
+void platformSleep(int milliseconds);
+
+// 读取一个按键（不回显）
+int platformGetch(void);
+
+// 获取控制台窗口宽度（字符数），获取失败时返回默认值
+int platformGetConsoleWidth(int defaultWidth);
+
+// 获取控制台窗口高度（行数），获取失败（如输出被重定向）时返回默认值
+int platformGetConsoleHeight(int defaultHeight);
+
+// 移动光标到指定位置（从0开始的列和行）
+void platformSetCursorPosition(int column, int row);
+
+// 设置文字颜色
+void platformSetTextColor(ConsoleColor color);
+
+// 获取可用的CPU核心数
+int platformGetCpuCount(void);
+
+// 把文件只读映射到内存，size返回文件长度；失败（或文件为空）时返回NULL
+const void* platformMapFile(const char* filename, size_t* size);
+
+// 解除platformMapFile的映射
+void platformUnmapFile(const void* data, size_t size);
+
+#endif // PLATFORM_H
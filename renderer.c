@@ -0,0 +1,348 @@
+#include "renderer.h"
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "battlefield.h"
+#include "platform.h"
+
+// 格子区域在屏幕上的位置
+#define GRID_TOP_ROW (BATTLEFIELD_HEADER_LINES + BATTLEFIELD_GRID_HEADER_LINES) // 第一行格子所在的屏幕行
+
+// 初始化文本缓冲区
+int initTextBuffer(TextBuffer* buffer, size_t capacity) {
+    buffer->data = (char*)malloc(capacity);
+    buffer->length = 0;
+    buffer->capacity = buffer->data ? capacity : 0;
+    return buffer->data != NULL;
+}
+
+// 释放文本缓冲区
+void freeTextBuffer(TextBuffer* buffer) {
+    free(buffer->data);
+    buffer->data = NULL;
+    buffer->length = 0;
+    buffer->capacity = 0;
+}
+
+// 在缓冲区末尾预留length字节
+char* textBufferReserve(TextBuffer* buffer, size_t length) {
+    if (buffer->length + length > buffer->capacity) {
+        size_t newCapacity = buffer->capacity > 0 ? buffer->capacity * 2 : 4096;
+        while (newCapacity < buffer->length + length) {
+            newCapacity *= 2;
+        }
+        char* data = (char*)realloc(buffer->data, newCapacity);
+        if (!data) {
+            return NULL; // 内存不足时丢弃这部分输出
+        }
+        buffer->data = data;
+        buffer->capacity = newCapacity;
+    }
+
+    char* position = buffer->data + buffer->length;
+    buffer->length += length;
+    return position;
+}
+
+// 追加length字节
+void textBufferAppend(TextBuffer* buffer, const char* text, size_t length) {
+    char* position = textBufferReserve(buffer, length);
+    if (position) {
+        memcpy(position, text, length);
+    }
+}
+
+// 追加字符串
+void textBufferPuts(TextBuffer* buffer, const char* text) {
+    textBufferAppend(buffer, text, strlen(text));
+}
+
+// 追加count个相同的字符
+void textBufferRepeat(TextBuffer* buffer, char c, int count) {
+    char* position = count > 0 ? textBufferReserve(buffer, (size_t)count) : NULL;
+    if (position) {
+        memset(position, c, (size_t)count);
+    }
+}
+
+// 按格式追加文本
+void textBufferPrintf(TextBuffer* buffer, const char* format, ...) {
+    char line[512];
+    va_list args;
+    va_start(args, format);
+    int length = vsnprintf(line, sizeof(line), format, args);
+    va_end(args);
+    if (length < 0) {
+        return;
+    }
+    if ((size_t)length < sizeof(line)) {
+        textBufferAppend(buffer, line, (size_t)length);
+        return;
+    }
+
+    // 超过一行的长文本直接格式化到缓冲区中
+    char* position = textBufferReserve(buffer, (size_t)length + 1);
+    if (position) {
+        va_start(args, format);
+        vsnprintf(position, (size_t)length + 1, format, args);
+        va_end(args);
+        buffer->length--; // 不保留结尾的'\0'
+    }
+}
+
+// 把缓冲区内容一次写入file并清空缓冲区
+void textBufferFlush(TextBuffer* buffer, FILE* file) {
+    if (buffer->length > 0) {
+        fwrite(buffer->data, 1, buffer->length, file);
+        fflush(file);
+    }
+    buffer->length = 0;
+}
+
+// 一行格子前Y坐标占用的列数（与renderGridRowLabel的输出一致）
+static int getGridLeftColumn(int y) {
+    int digits = 1;
+    for (int v = y; v >= 10; v /= 10) {
+        digits++;
+    }
+    return y < 10 ? 3 : digits + 1;
+}
+
+// 初始化渲染器
+int initRenderer(Renderer* renderer, int width, int height) {
+    size_t cells = (size_t)width * height;
+    renderer->width = width;
+    renderer->height = height;
+    renderer->shownChars = (char*)malloc(cells);
+    renderer->shownColors = (unsigned char*)malloc(cells);
+    renderer->frameChars = (char*)malloc(cells);
+    renderer->frameColors = (unsigned char*)malloc(cells);
+    renderer->arrowRanks = (unsigned char*)malloc(cells);
+    renderer->hasFrame = 0;
+    renderer->trails = NULL;
+    renderer->trailCount = 0;
+    renderer->trailCapacity = 0;
+
+    // 输出缓冲区按一帧的大致大小预先分配（每个格子最多需要光标移动和颜色切换）
+    int textReady = initTextBuffer(&renderer->text, cells * 4 + 16 * 1024);
+
+    if (!renderer->shownChars || !renderer->shownColors || !renderer->frameChars || !renderer->frameColors ||
+        !renderer->arrowRanks || !textReady) {
+        freeRenderer(renderer);
+        return 0;
+    }
+    return 1;
+}
+
+// 释放渲染器资源
+void freeRenderer(Renderer* renderer) {
+    free(renderer->shownChars);
+    free(renderer->shownColors);
+    free(renderer->frameChars);
+    free(renderer->frameColors);
+    free(renderer->arrowRanks);
+    free(renderer->trails);
+    freeTextBuffer(&renderer->text);
+    renderer->shownChars = NULL;
+    renderer->shownColors = NULL;
+    renderer->frameChars = NULL;
+    renderer->frameColors = NULL;
+    renderer->arrowRanks = NULL;
+    renderer->trails = NULL;
+    renderer->trailCount = 0;
+    renderer->trailCapacity = 0;
+}
+
+// 记录一次射击
+void rendererAddTrail(Renderer* renderer, Team team, int fromX, int fromY, int toX, int toY, int isHit) {
+    if (renderer->trailCount == renderer->trailCapacity) {
+        int newCapacity = renderer->trailCapacity > 0 ? renderer->trailCapacity * 2 : 64;
+        ProjectileTrail* trails = (ProjectileTrail*)realloc(renderer->trails, newCapacity * sizeof(ProjectileTrail));
+        if (!trails) {
+            return; // 内存不足时放弃这条弹道，不影响模拟
+        }
+        renderer->trails = trails;
+        renderer->trailCapacity = newCapacity;
+    }
+
+    ProjectileTrail* trail = &renderer->trails[renderer->trailCount++];
+    trail->team = team;
+    trail->fromX = fromX;
+    trail->fromY = fromY;
+    trail->toX = toX;
+    trail->toY = toY;
+    trail->isHit = isHit;
+}
+
+// 使屏幕内容失效
+void rendererInvalidate(Renderer* renderer) {
+    renderer->hasFrame = 0;
+}
+
+// 在新一帧上叠加一条弹道（Bresenham直线，跳过起点和被占用的中间格子）
+static void overlayTrail(Renderer* renderer, Battlefield* battlefield, const ProjectileTrail* trail) {
+    unsigned char color = (unsigned char)(trail->team == TEAM_RED ? CONSOLE_COLOR_RED : CONSOLE_COLOR_BLUE);
+    LineWalk line;
+    initLineWalk(&line, trail->fromX, trail->fromY, trail->toX, trail->toY);
+
+    while (lineWalkStep(&line)) {
+        int x = line.x;
+        int y = line.y;
+        int isEnd = (x == trail->toX && y == trail->toY);
+        if (!isPositionValid(battlefield, x, y) || (!isEnd && isCellOccupied(battlefield, x, y))) {
+            continue;
+        }
+
+        int offset = y * renderer->width + x;
+        // 终点显示命中效果，其余为弹道轨迹
+        renderer->frameChars[offset] = isEnd ? (trail->isHit ? 'X' : 'O') : '*';
+        renderer->frameColors[offset] = color;
+    }
+}
+
+// 合成新一帧的格子内容
+static void composeFrame(Renderer* renderer, Battlefield* battlefield) {
+    composeBattlefieldGrid(battlefield, TEAM_NONE, renderer->frameChars, renderer->arrowRanks);
+    memset(renderer->frameColors, CONSOLE_COLOR_DEFAULT, (size_t)renderer->width * renderer->height);
+
+    for (int i = 0; i < renderer->trailCount; i++) {
+        overlayTrail(renderer, battlefield, &renderer->trails[i]);
+    }
+}
+
+// 输出改变颜色的ANSI转义序列
+static void emitColor(TextBuffer* out, int color) {
+    switch (color) {
+        case CONSOLE_COLOR_RED: textBufferPuts(out, "\033[1;31m"); break;
+        case CONSOLE_COLOR_BLUE: textBufferPuts(out, "\033[1;34m"); break;
+        default: textBufferPuts(out, "\033[0m"); break;
+    }
+}
+
+// 把光标移动到指定位置（从0开始的列和行）
+static void emitCursor(TextBuffer* out, int column, int row) {
+    textBufferPrintf(out, "\033[%d;%dH", row + 1, column + 1);
+}
+
+// 完整绘制一帧
+static void drawFullFrame(Renderer* renderer, Battlefield* battlefield) {
+    TextBuffer* out = &renderer->text;
+    textBufferPuts(out, "\033[2J\033[H");
+    renderBattlefieldHeader(battlefield, out);
+    renderGridHeader(battlefield, out);
+
+    // 格子：同色的一段连续输出，颜色变化时才插入转义序列
+    for (int y = 0; y < renderer->height; y++) {
+        renderGridRowLabel(y, out);
+        const char* chars = renderer->frameChars + (size_t)y * renderer->width;
+        const unsigned char* colors = renderer->frameColors + (size_t)y * renderer->width;
+        int x = 0;
+        while (x < renderer->width) {
+            int end = x + 1;
+            while (end < renderer->width && colors[end] == colors[x]) {
+                end++;
+            }
+            if (colors[x] != CONSOLE_COLOR_DEFAULT) {
+                emitColor(out, colors[x]);
+            }
+            textBufferAppend(out, chars + x, (size_t)(end - x));
+            if (colors[x] != CONSOLE_COLOR_DEFAULT) {
+                emitColor(out, CONSOLE_COLOR_DEFAULT);
+            }
+            x = end;
+        }
+        textBufferPuts(out, "|\n");
+    }
+    renderGridBorder(battlefield, out);
+}
+
+// 只更新变化的格子
+static void drawChangedCells(Renderer* renderer) {
+    TextBuffer* out = &renderer->text;
+    int color = CONSOLE_COLOR_DEFAULT;
+    int cursorX = -1;
+    int cursorY = -1;
+
+    for (int y = 0; y < renderer->height; y++) {
+        const char* frameRow = renderer->frameChars + (size_t)y * renderer->width;
+        const char* shownRow = renderer->shownChars + (size_t)y * renderer->width;
+        const unsigned char* frameColorRow = renderer->frameColors + (size_t)y * renderer->width;
+        const unsigned char* shownColorRow = renderer->shownColors + (size_t)y * renderer->width;
+
+        // 整行都没有变化时跳过
+        if (memcmp(frameRow, shownRow, (size_t)renderer->width) == 0 &&
+            memcmp(frameColorRow, shownColorRow, (size_t)renderer->width) == 0) {
+            continue;
+        }
+
+        for (int x = 0; x < renderer->width; x++) {
+            if (frameRow[x] == shownRow[x] && frameColorRow[x] == shownColorRow[x]) {
+                continue;
+            }
+
+            // 光标刚好在该格子上时（同一行连续变化）无需移动
+            if (cursorX != x || cursorY != y) {
+                emitCursor(out, getGridLeftColumn(y) + x, GRID_TOP_ROW + y);
+            }
+            if (frameColorRow[x] != color) {
+                color = frameColorRow[x];
+                emitColor(out, color);
+            }
+            textBufferAppend(out, &frameRow[x], 1);
+            cursorX = x + 1;
+            cursorY = y;
+        }
+    }
+
+    if (color != CONSOLE_COLOR_DEFAULT) {
+        emitColor(out, CONSOLE_COLOR_DEFAULT);
+    }
+}
+
+// 绘制一帧
+void rendererDrawFrame(Renderer* renderer, Battlefield* battlefield) {
+    BattleStats* stats = battlefield->stats;
+    STATS_COUNT(stats, renderCalls, 1);
+    STATS_TIMER_BEGIN(stats, timer);
+
+    TextBuffer* out = &renderer->text;
+    syncEquipmentViews(battlefield);
+    composeFrame(renderer, battlefield);
+
+    if (!renderer->hasFrame) {
+        drawFullFrame(renderer, battlefield);
+        renderer->hasFrame = 1;
+    } else {
+        // 重写标题行
+        for (int row = 0; row < BATTLEFIELD_HEADER_LINES; row++) {
+            emitCursor(out, 0, row);
+            textBufferPuts(out, "\033[2K");
+        }
+        emitCursor(out, 0, 0);
+        renderBattlefieldHeader(battlefield, out);
+
+        drawChangedCells(renderer);
+
+        // 光标移到下边框之后，清除旧的装备列表
+        emitCursor(out, 0, GRID_TOP_ROW + renderer->height + 1);
+        textBufferPuts(out, "\033[J");
+    }
+
+    // 装备列表只显示控制台装得下的部分
+    renderUnitList(battlefield, TEAM_NONE, getUnitListMaxLines(battlefield), out);
+
+    // 整帧一次写出
+    textBufferFlush(out, stdout);
+
+    // 交换两帧的缓冲区，新一帧成为屏幕上显示的内容
+    char* chars = renderer->shownChars;
+    unsigned char* colors = renderer->shownColors;
+    renderer->shownChars = renderer->frameChars;
+    renderer->shownColors = renderer->frameColors;
+    renderer->frameChars = chars;
+    renderer->frameColors = colors;
+
+    renderer->trailCount = 0;
+    STATS_TIMER_END(stats, STATS_PHASE_RENDER, timer);
+}
@@ -0,0 +1,89 @@
+#ifndef RENDERER_H
+#define RENDERER_H
+
+#include <stddef.h>
+#include <stdio.h>
+#include "equipment.h"
+
+// 前向声明，避免与battlefield.h互相包含
+struct Battlefield;
+
+// 文本输出缓冲区：一帧的全部输出先合成到这里，再用一次fwrite写出
+// 缓冲区在多帧之间复用，只在一帧的内容超过容量时扩大
+typedef struct {
+    char* data;         // 文本内容（不以'\0'结尾）
+    size_t length;      // 当前长度
+    size_t capacity;    // 容量
+} TextBuffer;
+
+// 初始化文本缓冲区，成功返回1，内存分配失败返回0
+int initTextBuffer(TextBuffer* buffer, size_t capacity);
+
+// 释放文本缓冲区
+void freeTextBuffer(TextBuffer* buffer);
+
+// 在缓冲区末尾预留length字节，返回写入位置；内存不足时返回NULL
+char* textBufferReserve(TextBuffer* buffer, size_t length);
+
+// 追加length字节
+void textBufferAppend(TextBuffer* buffer, const char* text, size_t length);
+
+// 追加字符串
+void textBufferPuts(TextBuffer* buffer, const char* text);
+
+// 追加count个相同的字符
+void textBufferRepeat(TextBuffer* buffer, char c, int count);
+
+// 按格式追加文本
+void textBufferPrintf(TextBuffer* buffer, const char* format, ...)
+#if defined(__GNUC__)
+    __attribute__((format(printf, 2, 3)))
+#endif
+    ;
+
+// 把缓冲区内容一次写入file并清空缓冲区
+void textBufferFlush(TextBuffer* buffer, FILE* file);
+
+// 一次射击的弹道
+typedef struct {
+    Team team;              // 攻击方队伍（决定弹道颜色）
+    int fromX, fromY;       // 攻击方位置
+    int toX, toY;           // 目标位置
+    int isHit;              // 是否命中
+} ProjectileTrail;
+
+// 增量战场渲染器
+// 保存上一帧屏幕上显示的每个格子，新一帧只用ANSI光标移动输出发生变化的格子；
+// 一步模拟中的所有射击先记录下来，在下一帧作为覆盖层统一绘制，而不是每次射击都重绘整个屏幕
+typedef struct {
+    int width;                  // 战场宽度
+    int height;                 // 战场高度
+    char* shownChars;           // 屏幕上当前显示的格子字符
+    unsigned char* shownColors; // 屏幕上当前显示的格子颜色（ConsoleColor）
+    char* frameChars;           // 正在合成的新一帧
+    unsigned char* frameColors;
+    unsigned char* arrowRanks;  // 合成方向指示时使用的临时数组
+    TextBuffer text;            // 一帧的输出缓冲区
+    int hasFrame;               // 屏幕上是否已有完整的一帧
+    ProjectileTrail* trails;    // 本步记录的弹道
+    int trailCount;
+    int trailCapacity;
+} Renderer;
+
+// 初始化渲染器，成功返回1，内存分配失败返回0
+int initRenderer(Renderer* renderer, int width, int height);
+
+// 释放渲染器资源
+void freeRenderer(Renderer* renderer);
+
+// 记录一次射击，在下一帧中作为弹道覆盖层绘制
+void rendererAddTrail(Renderer* renderer, Team team, int fromX, int fromY, int toX, int toY, int isHit);
+
+// 使屏幕内容失效，下一帧清屏后完整重绘（屏幕被其他输出覆盖后调用）
+void rendererInvalidate(Renderer* renderer);
+
+// 绘制一帧：第一帧完整绘制，之后只更新变化的格子；绘制后清空弹道记录
+// 绘制结束后光标位于整个画面的下方
+void rendererDrawFrame(Renderer* renderer, struct Battlefield* battlefield);
+
+#endif // RENDERER_H
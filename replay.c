@@ -0,0 +1,300 @@
+#include "replay.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "platform.h"
+
+// 回放战场的内存池初始大小（不够时内存池会自动扩展）
+#define REPLAY_ARENA_SIZE (256 * 1024)
+
+// 按记录中的数据构造一个装备，名称取自装备类型
+static void makeReplayEquipment(Equipment* equipment, int id, int typeId, Team team) {
+    memset(equipment, 0, sizeof(*equipment));
+    equipment->id = id;
+    equipment->typeId = typeId;
+    equipment->team = team;
+
+    EquipmentType* type = getEquipmentTypeById(typeId);
+    if (type) {
+        copyEquipmentName(equipment, type);
+    }
+}
+
+// 重新初始化回放战场（重置内存池，之前的战场数据全部失效），内存分配失败时返回0
+// 重置后的内存池保留第一次初始化时扩大的容量，因此只有第一次初始化可能失败
+static int resetReplayBattlefield(Replay* replay) {
+    resetArena(&replay->arena);
+    if (!initBattlefieldInArena(&replay->battlefield, replay->reader.width, replay->reader.height, &replay->arena)) {
+        return 0;
+    }
+    replay->battlefield.headless = 1;
+    return 1;
+}
+
+// 从第index个关键帧恢复战场，之后从关键帧后面的数据块继续读取事件
+static int restoreKeyframe(Replay* replay, int index) {
+    replay->reader.offset = replay->keyframes[index].offset;
+
+    EventBlock block;
+    KeyframeInfo info;
+    if (!eventLogNextBlock(&replay->reader, &block) || !eventBlockReadKeyframe(&block, &info)) {
+        return 0;
+    }
+
+    if (!resetReplayBattlefield(replay)) {
+        return 0;
+    }
+    Battlefield* battlefield = &replay->battlefield;
+    battlefield->redBudget = info.redBudget;
+    battlefield->blueBudget = info.blueBudget;
+    battlefield->redRemainingBudget = info.redRemainingBudget;
+    battlefield->blueRemainingBudget = info.blueRemainingBudget;
+    battlefield->redHQUnit = info.redHQUnit;
+    battlefield->blueHQUnit = info.blueHQUnit;
+    memcpy(battlefield->rng.state, info.rngState, sizeof(battlefield->rng.state));
+
+    // 按下标顺序放回单元，下标与记录时一致，之后的事件可以直接引用
+    int total = info.redCount + info.blueCount;
+    for (int i = 0; i < total; i++) {
+        KeyframeUnit unit;
+        Equipment equipment;
+        eventBlockKeyframeUnit(&block, i, &unit);
+        makeReplayEquipment(&equipment, unit.id, unit.typeId, i < info.redCount ? TEAM_RED : TEAM_BLUE);
+        equipment.currentHealth = unit.health;
+        equipment.currentAmmo = unit.ammo;
+        equipment.x = unit.x;
+        equipment.y = unit.y;
+        equipment.directionX = unit.dirX;
+        equipment.directionY = unit.dirY;
+        equipment.isActive = unit.alive;
+        if (placeUnitOnBattlefield(battlefield, &equipment) < 0) {
+            return 0;
+        }
+    }
+
+    replay->tick = replay->keyframes[index].tick;
+    replay->hasBlock = 0;
+    replay->hasPending = 0;
+    return 1;
+}
+
+// 回到记录开头（没有关键帧时从空战场开始，应用部署事件），内存分配失败时返回0
+static int restoreStart(Replay* replay) {
+    int ok = resetReplayBattlefield(replay);
+    initEventLogReader(&replay->reader, replay->data, replay->size);
+    replay->tick = -1;
+    replay->hasBlock = 0;
+    replay->hasPending = 0;
+    return ok;
+}
+
+// 读取下一个事件（跳过关键帧数据块），没有更多事件时返回0
+static int nextReplayEvent(Replay* replay, BattleEvent* event) {
+    if (replay->hasPending) {
+        *event = replay->pending;
+        replay->hasPending = 0;
+        return 1;
+    }
+
+    while (1) {
+        if (replay->hasBlock && eventBlockNextEvent(&replay->block, event)) {
+            return 1;
+        }
+        if (!eventLogNextBlock(&replay->reader, &replay->block)) {
+            replay->hasBlock = 0;
+            return 0;
+        }
+        replay->hasBlock = 1;
+    }
+}
+
+// 把一个事件应用到回放战场上（下标或位置无效的事件被忽略）
+static void applyReplayEvent(Replay* replay, const BattleEvent* event) {
+    Battlefield* battlefield = &replay->battlefield;
+    UnitStore* units = getTeamUnits(battlefield, event->team);
+    if (event->type != EVENT_SPAWN && event->type != EVENT_VICTORY &&
+        (event->unit < 0 || event->unit >= units->count)) {
+        return;
+    }
+
+    switch (event->type) {
+        case EVENT_SPAWN: {
+            if (event->unit != units->count || !isPositionValid(battlefield, event->x, event->y)) {
+                return;
+            }
+            // 部署事件不带ID，按部署顺序从1开始编号
+            Equipment equipment;
+            int id = battlefield->redUnits.count + battlefield->blueUnits.count + 1;
+            makeReplayEquipment(&equipment, id, event->typeId, event->team);
+            equipment.currentHealth = event->health;
+            equipment.currentAmmo = event->ammo;
+            equipment.x = event->x;
+            equipment.y = event->y;
+            equipment.directionX = event->dirX;
+            equipment.directionY = event->dirY;
+            equipment.isActive = 1;
+            placeUnitOnBattlefield(battlefield, &equipment);
+            break;
+        }
+
+        case EVENT_MOVE: {
+            int unit = event->unit;
+            int newX = units->x[unit] + event->dx;
+            int newY = units->y[unit] + event->dy;
+            if ((event->dx || event->dy) && isPositionValid(battlefield, newX, newY)) {
+                moveUnitOnBattlefield(battlefield, event->team, unit, newX, newY);
+            }
+            units->dirX[unit] = (signed char)event->dirX;
+            units->dirY[unit] = (signed char)event->dirY;
+            break;
+        }
+
+        case EVENT_SHOT: {
+            UnitStore* enemies = getTeamUnits(battlefield, getEnemyTeam(event->team));
+            units->ammo[event->unit]--;
+            if (event->isHit && event->target >= 0 && event->target < enemies->count) {
+                enemies->health[event->target] -= event->damage;
+                if (enemies->health[event->target] < 0) {
+                    enemies->health[event->target] = 0;
+                }
+            }
+            break;
+        }
+
+        case EVENT_KILL:
+            if (units->alive[event->unit]) {
+                removeUnitFromBattlefield(battlefield, event->team, event->unit);
+            }
+            break;
+
+        default:
+            break;
+    }
+}
+
+// 从当前步向后应用事件，直到第tick步结束
+static void advanceReplay(Replay* replay, int tick) {
+    BattleEvent event;
+    while (nextReplayEvent(replay, &event)) {
+        if (event.tick > tick) {
+            replay->pending = event;
+            replay->hasPending = 1;
+            break;
+        }
+        applyReplayEvent(replay, &event);
+    }
+    replay->tick = tick;
+}
+
+// 找到步数不晚于tick的最后一个关键帧，没有时返回-1
+static int findKeyframe(const Replay* replay, int tick) {
+    int low = 0;
+    int high = replay->keyframeCount - 1;
+    int found = -1;
+    while (low <= high) {
+        int middle = (low + high) / 2;
+        if (replay->keyframes[middle].tick <= tick) {
+            found = middle;
+            low = middle + 1;
+        } else {
+            high = middle - 1;
+        }
+    }
+    return found;
+}
+
+// 扫描全部块头建立关键帧索引，并解码最后一个事件数据块得到最后一步和胜负结果
+static int indexReplay(Replay* replay) {
+    EventLogReader reader = replay->reader;
+    EventBlock block;
+    EventBlock lastEvents;
+    int hasEvents = 0;
+    int capacity = 0;
+
+    while (eventLogNextBlock(&reader, &block)) {
+        if (block.kind == EVENT_BLOCK_KEYFRAME) {
+            if (replay->keyframeCount >= capacity) {
+                capacity = capacity ? capacity * 2 : 16;
+                ReplayKeyframe* keyframes = (ReplayKeyframe*)realloc(replay->keyframes, capacity * sizeof(ReplayKeyframe));
+                if (!keyframes) {
+                    return 0;
+                }
+                replay->keyframes = keyframes;
+            }
+            ReplayKeyframe* keyframe = &replay->keyframes[replay->keyframeCount++];
+            keyframe->tick = block.tick;
+            keyframe->offset = (size_t)(block.data - replay->reader.data) - EVENT_BLOCK_HEADER_SIZE;
+            if (block.tick > replay->lastTick) {
+                replay->lastTick = block.tick;
+            }
+        } else if (block.kind == EVENT_BLOCK_EVENTS) {
+            lastEvents = block;
+            hasEvents = 1;
+        }
+    }
+
+    if (hasEvents) {
+        BattleEvent event;
+        while (eventBlockNextEvent(&lastEvents, &event)) {
+            if (event.tick > replay->lastTick) {
+                replay->lastTick = event.tick;
+            }
+            if (event.type == EVENT_VICTORY) {
+                replay->result = event.result;
+            }
+        }
+    }
+    return 1;
+}
+
+// 映射事件记录文件并建立关键帧索引
+int openReplay(Replay* replay, const char* filename) {
+    memset(replay, 0, sizeof(*replay));
+
+    replay->data = platformMapFile(filename, &replay->size);
+    if (!replay->data) {
+        printf("无法打开回放文件: %s\n", filename);
+        return 0;
+    }
+    if (!initEventLogReader(&replay->reader, replay->data, replay->size)) {
+        printf("回放文件格式不正确: %s\n", filename);
+        platformUnmapFile(replay->data, replay->size);
+        return 0;
+    }
+    if (!indexReplay(replay) || !initArena(&replay->arena, REPLAY_ARENA_SIZE) || !restoreStart(replay)) {
+        printf("内存分配失败！\n");
+        freeArena(&replay->arena);
+        free(replay->keyframes);
+        platformUnmapFile(replay->data, replay->size);
+        return 0;
+    }
+
+    replaySeek(replay, 0);
+    return 1;
+}
+
+// 关闭回放
+void closeReplay(Replay* replay) {
+    freeArena(&replay->arena);
+    free(replay->keyframes);
+    platformUnmapFile(replay->data, replay->size);
+    memset(replay, 0, sizeof(*replay));
+}
+
+// 跳转到第tick步结束时的状态
+int replaySeek(Replay* replay, int tick) {
+    if (tick > replay->lastTick) tick = replay->lastTick;
+    if (tick < 0) tick = 0;
+
+    // 向后跳转，或者中间隔着关键帧时，从最近的关键帧恢复；否则直接从当前步向前应用事件
+    int keyframe = findKeyframe(replay, tick);
+    if (tick < replay->tick || (keyframe >= 0 && replay->keyframes[keyframe].tick > replay->tick)) {
+        if (keyframe < 0 || !restoreKeyframe(replay, keyframe)) {
+            restoreStart(replay);
+        }
+    }
+
+    advanceReplay(replay, tick);
+    syncEquipmentViews(&replay->battlefield);
+    return tick;
+}
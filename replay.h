@@ -0,0 +1,44 @@
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include <stddef.h>
+#include "battlefield.h"
+#include "eventlog.h"
+
+// 关键帧索引项
+typedef struct {
+    int tick;               // 关键帧对应的步数
+    size_t offset;          // 关键帧数据块在文件中的位置
+} ReplayKeyframe;
+
+// 战斗回放
+// 事件记录文件映射到内存后只建立关键帧索引；跳转到某一步时先恢复不晚于该步的最近关键帧，
+// 再向后应用事件，因此跳转的耗时只取决于关键帧间隔，与战斗长度无关
+typedef struct {
+    const void* data;               // 映射到内存的事件记录文件
+    size_t size;
+    EventLogReader reader;
+    ReplayKeyframe* keyframes;      // 关键帧索引（按步数递增）
+    int keyframeCount;
+    int lastTick;                   // 记录中的最后一步
+    int result;                     // 记录中的胜负结果（0表示没有分出胜负，如超时）
+    Arena arena;                    // 回放战场的内存池，每次恢复关键帧时重置
+    Battlefield battlefield;        // 第tick步结束时的战场状态
+    int tick;                       // 当前步数（-1表示还没有部署）
+    EventBlock block;               // 正在应用的数据块
+    int hasBlock;
+    BattleEvent pending;            // 已解码但属于更晚一步的事件
+    int hasPending;
+} Replay;
+
+// 映射事件记录文件并建立关键帧索引，回放停在第0步（部署完成）
+// 成功返回1，文件无法打开或格式不正确时返回0
+int openReplay(Replay* replay, const char* filename);
+
+// 关闭回放，释放战场并解除文件映射
+void closeReplay(Replay* replay);
+
+// 跳转到第tick步结束时的状态（超出范围时限制到[0, lastTick]），返回实际到达的步数
+int replaySeek(Replay* replay, int tick);
+
+#endif // REPLAY_H
@@ -0,0 +1,46 @@
+#include "rng.h"
+
+// SplitMix64：用于把种子扩展为xoshiro的初始状态
+static uint64_t splitMix64(uint64_t* x) {
+    uint64_t z = (*x += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+static uint64_t rotateLeft(uint64_t x, int k) {
+    return (x << k) | (x >> (64 - k));
+}
+
+// 用主种子和流编号初始化随机数流
+void rngSeed(Rng* rng, uint64_t masterSeed, uint64_t streamId) {
+    // 先把流编号混合进种子，再展开为256位状态
+    uint64_t mix = masterSeed;
+    uint64_t streamKey = splitMix64(&mix) ^ streamId;
+    uint64_t seed = splitMix64(&streamKey);
+    for (int i = 0; i < 4; i++) {
+        rng->state[i] = splitMix64(&seed);
+    }
+}
+
+// 生成下一个32位随机数
+uint32_t rngNext(Rng* rng) {
+    uint64_t* s = rng->state;
+    uint64_t result = rotateLeft(s[1] * 5, 7) * 9;
+    uint64_t t = s[1] << 17;
+
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = rotateLeft(s[3], 45);
+
+    return (uint32_t)(result >> 32);
+}
+
+// 生成[0, bound)范围内的随机整数
+int rngNextBelow(Rng* rng, int bound) {
+    // 乘法映射代替取模，bound很小时偏差可忽略
+    return (int)(((uint64_t)rngNext(rng) * (uint32_t)bound) >> 32);
+}
@@ -0,0 +1,23 @@
+#ifndef RNG_H
+#define RNG_H
+
+#include <stdint.h>
+
+// 可分流的伪随机数发生器 (xoshiro256**)
+// 每场战斗拥有独立的随机数流，由主种子和流编号唯一确定，
+// 保证战斗结果可复现，且多线程并行时互不干扰
+typedef struct {
+    uint64_t state[4];
+} Rng;
+
+// 用主种子和流编号初始化随机数流
+// 相同的(masterSeed, streamId)总是产生相同的序列，不同流编号之间相互独立
+void rngSeed(Rng* rng, uint64_t masterSeed, uint64_t streamId);
+
+// 生成下一个32位随机数
+uint32_t rngNext(Rng* rng);
+
+// 生成[0, bound)范围内的随机整数
+int rngNextBelow(Rng* rng, int bound);
+
+#endif // RNG_H
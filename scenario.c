@@ -0,0 +1,417 @@
+#include "scenario.h"
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "distance.h"
+#include "platform.h"
+
+// 整数字段的绝对值上限，避免溢出
+#define SCENARIO_MAX_VALUE 1000000000
+
+// 想定文件的读取位置
+typedef struct {
+    const char* p;
+    const char* end;
+    int line;           // 当前行号
+} ScenarioCursor;
+
+// 跳过空格和制表符
+static void skipSpaces(ScenarioCursor* cursor) {
+    while (cursor->p < cursor->end && (*cursor->p == ' ' || *cursor->p == '\t' || *cursor->p == '\r')) {
+        cursor->p++;
+    }
+}
+
+// 当前行是否已经结束（只剩空白或注释）
+static int atLineEnd(ScenarioCursor* cursor) {
+    skipSpaces(cursor);
+    return cursor->p >= cursor->end || *cursor->p == '\n' || *cursor->p == '#';
+}
+
+// 跳到下一行的开头
+static void nextLine(ScenarioCursor* cursor) {
+    const char* newline = memchr(cursor->p, '\n', cursor->end - cursor->p);
+    cursor->p = newline ? newline + 1 : cursor->end;
+    cursor->line++;
+}
+
+// 读取一个字符
+static int readChar(ScenarioCursor* cursor, char expected) {
+    skipSpaces(cursor);
+    if (cursor->p < cursor->end && *cursor->p == expected) {
+        cursor->p++;
+        return 1;
+    }
+    return 0;
+}
+
+// 读取一个十进制整数
+static int readInt(ScenarioCursor* cursor, int* value) {
+    skipSpaces(cursor);
+    int negative = 0;
+    if (cursor->p < cursor->end && (*cursor->p == '-' || *cursor->p == '+')) {
+        negative = (*cursor->p == '-');
+        cursor->p++;
+    }
+    if (cursor->p >= cursor->end || *cursor->p < '0' || *cursor->p > '9') {
+        return 0;
+    }
+
+    int result = 0;
+    while (cursor->p < cursor->end && *cursor->p >= '0' && *cursor->p <= '9') {
+        result = result * 10 + (*cursor->p - '0');
+        if (result > SCENARIO_MAX_VALUE) {
+            return 0;
+        }
+        cursor->p++;
+    }
+    *value = negative ? -result : result;
+    return 1;
+}
+
+// 读取逗号和一个整数
+static int readField(ScenarioCursor* cursor, int* value) {
+    return readChar(cursor, ',') && readInt(cursor, value);
+}
+
+// 读取队伍（R或B）
+static int readTeam(ScenarioCursor* cursor, Team* team) {
+    skipSpaces(cursor);
+    if (cursor->p >= cursor->end) {
+        return 0;
+    }
+    char c = *cursor->p;
+    if (c == 'R' || c == 'r') {
+        *team = TEAM_RED;
+    } else if (c == 'B' || c == 'b') {
+        *team = TEAM_BLUE;
+    } else {
+        return 0;
+    }
+    cursor->p++;
+    return 1;
+}
+
+// 读取一个关键字（后面必须跟逗号）
+static int readKeyword(ScenarioCursor* cursor, const char* keyword) {
+    size_t length = strlen(keyword);
+    if ((size_t)(cursor->end - cursor->p) > length && memcmp(cursor->p, keyword, length) == 0 &&
+        (cursor->p[length] == ',' || cursor->p[length] == ' ' || cursor->p[length] == '\t')) {
+        cursor->p += length;
+        return 1;
+    }
+    return 0;
+}
+
+// 读取装备字段 typeId,x,y,dirX,dirY，前面的队伍已经读入entry
+static const char* readUnitFields(ScenarioCursor* cursor, DeploymentEntry* entry) {
+    if (!readField(cursor, &entry->typeId) || !readField(cursor, &entry->x) || !readField(cursor, &entry->y) ||
+        !readField(cursor, &entry->dirX) || !readField(cursor, &entry->dirY)) {
+        return "格式错误，装备应为 R|B,typeId,x,y,dirX,dirY";
+    }
+    if (entry->dirX < -1 || entry->dirX > 1 || entry->dirY < -1 || entry->dirY > 1) {
+        return "方向只能是-1、0或1";
+    }
+    return NULL;
+}
+
+// 追加一个装备条目（容量不够时加倍扩大）
+static DeploymentEntry* appendScenarioEntry(Scenario* scenario, int* capacity) {
+    Deployment* units = &scenario->units;
+    if (units->count >= *capacity) {
+        int newCapacity = *capacity > 0 ? *capacity * 2 : 256;
+        DeploymentEntry* entries = (DeploymentEntry*)realloc(units->entries, newCapacity * sizeof(DeploymentEntry));
+        if (!entries) {
+            return NULL;
+        }
+        units->entries = entries;
+        *capacity = newCapacity;
+    }
+    return &units->entries[units->count];
+}
+
+// 解析一行设置或装备，成功返回NULL，否则返回错误原因
+static const char* parseScenarioLine(ScenarioCursor* cursor, Scenario* scenario, int* capacity) {
+    Team team;
+
+    if (readKeyword(cursor, "map")) {
+        if (!readField(cursor, &scenario->width) || !readField(cursor, &scenario->height)) {
+            return "格式错误，应为 map,宽度,高度";
+        }
+        if (scenario->width < 2 || scenario->height < 1 ||
+            scenario->width > MAX_DISTANCE_COORDINATE || scenario->height > MAX_DISTANCE_COORDINATE) {
+            return "战场尺寸无效";
+        }
+        return NULL;
+    }
+
+    if (readKeyword(cursor, "max_units")) {
+        if (!readField(cursor, &scenario->maxEquipments) || scenario->maxEquipments < 0) {
+            return "格式错误，应为 max_units,N（0表示不限）";
+        }
+        return NULL;
+    }
+
+    if (readKeyword(cursor, "budget")) {
+        int budget;
+        if (!readChar(cursor, ',') || !readTeam(cursor, &team) || !readField(cursor, &budget)) {
+            return "格式错误，应为 budget,R|B,预算";
+        }
+        if (budget < 0) {
+            return "预算不能为负数";
+        }
+        if (team == TEAM_RED) {
+            scenario->redBudget = budget;
+        } else {
+            scenario->blueBudget = budget;
+        }
+        return NULL;
+    }
+
+    int isHQ = readKeyword(cursor, "hq");
+    if (isHQ && !readChar(cursor, ',')) {
+        return "格式错误，应为 hq,R|B,typeId,x,y,dirX,dirY";
+    }
+    if (!readTeam(cursor, &team)) {
+        return "无法识别的行";
+    }
+
+    DeploymentEntry* entry = appendScenarioEntry(scenario, capacity);
+    if (!entry) {
+        return "内存分配失败";
+    }
+    entry->team = team;
+    entry->line = cursor->line;
+    const char* error = readUnitFields(cursor, entry);
+    if (error) {
+        return error;
+    }
+
+    if (isHQ) {
+        int* hqEntry = (team == TEAM_RED) ? &scenario->redHQEntry : &scenario->blueHQEntry;
+        if (*hqEntry >= 0) {
+            return "每方只能有一个大本营";
+        }
+        *hqEntry = scenario->units.count;
+    }
+    if (team == TEAM_RED) {
+        scenario->redCount++;
+    } else {
+        scenario->blueCount++;
+    }
+    scenario->units.count++;
+    return NULL;
+}
+
+// 解析想定文件
+int parseScenario(Scenario* scenario, const char* filename) {
+    scenario->width = g_battlefieldConfig.width;
+    scenario->height = g_battlefieldConfig.height;
+    scenario->redBudget = g_battlefieldConfig.redBudget;
+    scenario->blueBudget = g_battlefieldConfig.blueBudget;
+    scenario->maxEquipments = g_battlefieldConfig.maxEquipments;
+    scenario->units.entries = NULL;
+    scenario->units.count = 0;
+    scenario->redHQEntry = -1;
+    scenario->blueHQEntry = -1;
+    scenario->redCount = 0;
+    scenario->blueCount = 0;
+
+    size_t size;
+    const char* data = (const char*)platformMapFile(filename, &size);
+    if (!data) {
+        printf("无法打开想定文件: %s\n", filename);
+        return 0;
+    }
+
+    ScenarioCursor cursor = { data, data + size, 1 };
+    if (size >= 3 && memcmp(data, "\xEF\xBB\xBF", 3) == 0) {
+        cursor.p += 3; // 跳过UTF-8 BOM
+    }
+
+    int capacity = 0;
+    const char* error = NULL;
+    while (cursor.p < cursor.end) {
+        if (!atLineEnd(&cursor)) {
+            error = parseScenarioLine(&cursor, scenario, &capacity);
+            if (!error && !atLineEnd(&cursor)) {
+                error = "行尾有多余的内容";
+            }
+            if (error) {
+                break;
+            }
+        }
+        nextLine(&cursor);
+    }
+
+    platformUnmapFile(data, size);
+    if (error) {
+        printf("想定文件 %s 第%d行: %s\n", filename, cursor.line, error);
+        freeScenario(scenario);
+        return 0;
+    }
+    return 1;
+}
+
+// 释放想定资源
+void freeScenario(Scenario* scenario) {
+    freeDeployment(&scenario->units);
+}
+
+// 部署想定需要的单元存储容量
+int getScenarioCapacity(const Scenario* scenario) {
+    return scenario->redCount > scenario->blueCount ? scenario->redCount : scenario->blueCount;
+}
+
+// 按想定部署全部装备
+int applyScenario(Battlefield* battlefield, const Scenario* scenario) {
+    battlefield->redBudget = scenario->redBudget;
+    battlefield->blueBudget = scenario->blueBudget;
+    battlefield->redRemainingBudget = scenario->redBudget;
+    battlefield->blueRemainingBudget = scenario->blueBudget;
+    battlefield->maxEquipments = scenario->maxEquipments;
+
+    // 每个装备的检查和放置都是O(1)，整个想定的部署时间与装备数量成正比
+    int rejected = 0;
+    for (int i = 0; i < scenario->units.count; i++) {
+        const DeploymentEntry* entry = &scenario->units.entries[i];
+        Equipment equipment;
+        const char* error = NULL;
+        if (!initEquipment(&equipment, entry->typeId, entry->team, entry->x, entry->y, entry->dirX, entry->dirY)) {
+            error = "无效的装备类型ID！";
+        } else {
+            error = checkEquipmentPlacement(battlefield, &equipment);
+        }
+
+        if (error || !addEquipmentToBattlefield(battlefield, &equipment)) {
+            if (!battlefield->headless) {
+                printf("想定第%d行: %s\n", entry->line, error ? error : "部署装备失败！");
+            }
+            rejected++;
+            continue;
+        }
+
+        // 大本营记录为刚放入的单元下标
+        int index = getTeamUnits(battlefield, entry->team)->count - 1;
+        if (i == scenario->redHQEntry) {
+            battlefield->redHQUnit = index;
+        } else if (i == scenario->blueHQEntry) {
+            battlefield->blueHQUnit = index;
+        }
+    }
+    return rejected;
+}
+
+// 按想定文件初始化战场并部署装备
+int loadScenario(Battlefield* battlefield, const char* filename) {
+    Scenario scenario;
+    if (!parseScenario(&scenario, filename)) {
+        return 0;
+    }
+
+    if (!initBattlefieldWithCapacity(battlefield, scenario.width, scenario.height, getScenarioCapacity(&scenario),
+                                     NULL)) {
+        printf("内存分配失败（战场 %dx%d）\n", scenario.width, scenario.height);
+        freeScenario(&scenario);
+        return 0;
+    }
+    applyScenario(battlefield, &scenario);
+    freeScenario(&scenario);
+    return 1;
+}
+
+// 生成随机想定
+int generateScenario(Scenario* scenario, int width, int height, int unitsPerSide, Rng* rng) {
+    // 可以移动和攻击的装备类型
+    int typeIds[RANDOM_SCENARIO_MAX_TYPE_ID];
+    int typeCount = 0;
+    for (int id = 1; id <= RANDOM_SCENARIO_MAX_TYPE_ID; id++) {
+        EquipmentType* type = getEquipmentTypeById(id);
+        if (type && type->maxSpeed > 0 && type->maxAttackRadius > 0) {
+            typeIds[typeCount++] = id;
+        }
+    }
+
+    // 红方半场为x < width / 2，蓝方半场为其余部分
+    int halfWidths[2] = { width / 2, width - width / 2 };
+    if (typeCount == 0 || unitsPerSide < 0 || width > MAX_DISTANCE_COORDINATE || height > MAX_DISTANCE_COORDINATE ||
+        (long long)halfWidths[0] * height < unitsPerSide) {
+        return 0;
+    }
+
+    scenario->width = width;
+    scenario->height = height;
+    scenario->redBudget = INT_MAX;
+    scenario->blueBudget = INT_MAX;
+    scenario->maxEquipments = 0;
+    scenario->redHQEntry = -1;
+    scenario->blueHQEntry = -1;
+    scenario->redCount = unitsPerSide;
+    scenario->blueCount = unitsPerSide;
+    scenario->units.count = 2 * unitsPerSide;
+    scenario->units.entries = (DeploymentEntry*)malloc((2 * (size_t)unitsPerSide + 1) * sizeof(DeploymentEntry));
+    int* order = (int*)malloc(((size_t)halfWidths[1] * height + 1) * sizeof(int));
+    if (!scenario->units.entries || !order) {
+        free(scenario->units.entries);
+        free(order);
+        return 0;
+    }
+
+    for (int side = 0; side < 2; side++) {
+        // 部分洗牌：前unitsPerSide个格子就是随机选出的互不相同的位置
+        int halfWidth = halfWidths[side];
+        int halfCells = halfWidth * height;
+        for (int i = 0; i < halfCells; i++) {
+            order[i] = i;
+        }
+        for (int i = 0; i < unitsPerSide; i++) {
+            int j = i + rngNextBelow(rng, halfCells - i);
+            int cell = order[j];
+            order[j] = order[i];
+            order[i] = cell;
+
+            DeploymentEntry* entry = &scenario->units.entries[side * unitsPerSide + i];
+            entry->team = side == 0 ? TEAM_RED : TEAM_BLUE;
+            entry->typeId = typeIds[rngNextBelow(rng, typeCount)];
+            entry->x = side * halfWidths[0] + cell % halfWidth;
+            entry->y = cell / halfWidth;
+            entry->dirX = rngNextBelow(rng, 3) - 1;
+            entry->dirY = rngNextBelow(rng, 3) - 1;
+            entry->line = 0;
+        }
+    }
+    free(order);
+    return 1;
+}
+
+// 从设置文件加载战场设置
+int loadBattlefieldConfig(const char* filename) {
+    Scenario settings;
+    if (!parseScenario(&settings, filename)) {
+        return 0;
+    }
+
+    int hasUnits = settings.units.count > 0;
+    if (hasUnits) {
+        printf("设置文件 %s 中不能包含装备\n", filename);
+    } else {
+        g_battlefieldConfig.width = settings.width;
+        g_battlefieldConfig.height = settings.height;
+        g_battlefieldConfig.redBudget = settings.redBudget;
+        g_battlefieldConfig.blueBudget = settings.blueBudget;
+        g_battlefieldConfig.maxEquipments = settings.maxEquipments;
+    }
+    freeScenario(&settings);
+    return !hasUnits;
+}
+
+// 加载默认设置文件（如果存在）
+int loadDefaultBattlefieldConfig(void) {
+    FILE* file = fopen(DEFAULT_SETTINGS_FILE, "r");
+    if (!file) {
+        return 1;
+    }
+    fclose(file);
+    return loadBattlefieldConfig(DEFAULT_SETTINGS_FILE);
+}
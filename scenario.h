@@ -0,0 +1,61 @@
+#ifndef SCENARIO_H
+#define SCENARIO_H
+
+#include "battlefield.h"
+
+// 默认的设置文件，存在时由交互模式和批量模式在启动时加载
+#define DEFAULT_SETTINGS_FILE "settings.txt"
+
+// 想定文件（声明式的战场设置，代替交互式部署）
+// 文本格式，每行一条，#之后为注释，字段用逗号分隔：
+//   map,宽度,高度                         战场尺寸
+//   budget,R|B,预算                       一方的预算
+//   max_units,N                           每方最大装备数量（0表示不限）
+//   hq,R|B,typeId,x,y,dirX,dirY           一方的大本营（每方最多一个）
+//   R|B,typeId,x,y,dirX,dirY              一个装备（与部署文件的格式相同，因此部署文件也是合法的想定文件）
+// 设置行可以出现在任意位置，没有设置的项取g_battlefieldConfig中的值；装备按文件中的顺序部署，规则与交互式部署相同
+// 设置文件（见loadBattlefieldConfig）使用同样的格式，但只能包含设置行
+typedef struct {
+    int width, height;
+    int redBudget, blueBudget;
+    int maxEquipments;          // 每方最大装备数量（0表示不限）
+    Deployment units;           // 全部装备（包括大本营），按文件中的顺序
+    int redHQEntry;             // 红方大本营在units中的下标（-1表示没有）
+    int blueHQEntry;            // 蓝方大本营在units中的下标（-1表示没有）
+    int redCount, blueCount;    // 双方的装备数
+} Scenario;
+
+// 解析想定文件（一次遍历，不部署装备），格式错误时报告行号并返回0，成功返回1
+int parseScenario(Scenario* scenario, const char* filename);
+
+// 释放想定资源
+void freeScenario(Scenario* scenario);
+
+// 部署想定需要的单元存储容量（初始化战场时预留，避免部署过程中反复扩大）
+int getScenarioCapacity(const Scenario* scenario);
+
+// 按想定设置预算和装备数量上限并部署全部装备和大本营，战场应按想定的尺寸和容量初始化
+// 每个装备按addEquipmentToBattlefield的规则检查，无法部署的被跳过（非无界面模式下报告行号和原因）
+// 返回无法部署的装备数量，0表示全部部署成功
+int applyScenario(Battlefield* battlefield, const Scenario* scenario);
+
+// 按想定文件初始化战场并部署装备，成功返回1
+// 文件无法打开、格式错误或内存分配失败时返回0，此时战场没有被初始化
+int loadScenario(Battlefield* battlefield, const char* filename);
+
+// 随机想定可选用的装备类型ID范围
+#define RANDOM_SCENARIO_MAX_TYPE_ID 64
+
+// 生成随机想定（用于压力测试和性能测试）：width x height的战场，两个半场各随机放置unitsPerSide个装备，
+// 位置互不相同，类型从可以移动和攻击的装备类型中随机选取，方向随机；没有大本营，预算和装备数量不受限制
+// 成功返回1；半场放不下、没有可用的装备类型或内存分配失败时返回0
+int generateScenario(Scenario* scenario, int width, int height, int unitsPerSide, Rng* rng);
+
+// 从设置文件加载g_battlefieldConfig（战场尺寸、双方预算、装备数量上限）
+// 成功返回1；文件无法打开、格式错误或包含装备时返回0，设置保持不变
+int loadBattlefieldConfig(const char* filename);
+
+// 默认设置文件存在时加载它，不存在时使用内置的默认值；设置文件有错误时返回0
+int loadDefaultBattlefieldConfig(void);
+
+#endif // SCENARIO_H
@@ -0,0 +1,135 @@
+#include "scheduler.h"
+#include <stdlib.h>
+
+// 工作线程上下文
+typedef struct {
+    int id;
+    int workerCount;
+    JobQueue* queues;
+    JobFunction function;
+    void* context;
+    JobStats stats;         // 本线程的窃取统计，结束后汇总
+    char padding[64];
+} JobWorker;
+
+// 从自己队列的前端取一个任务，队列为空时返回-1
+static int popJob(JobQueue* queue) {
+    int job = -1;
+    pthread_mutex_lock(&queue->mutex);
+    if (queue->begin < queue->end) {
+        job = queue->begin++;
+    }
+    pthread_mutex_unlock(&queue->mutex);
+    return job;
+}
+
+// 从其他线程的队列后端窃取剩余任务的一半（向上取整）放入自己的队列，并取出其中第一个
+// 从下一个线程开始轮流尝试，所有队列都为空时返回-1
+static int stealJob(JobWorker* worker) {
+    for (int k = 1; k < worker->workerCount; k++) {
+        JobQueue* victim = &worker->queues[(worker->id + k) % worker->workerCount];
+
+        pthread_mutex_lock(&victim->mutex);
+        int remaining = victim->end - victim->begin;
+        int begin = victim->end - (remaining + 1) / 2;
+        int end = victim->end;
+        if (remaining > 0) {
+            victim->end = begin;
+        }
+        pthread_mutex_unlock(&victim->mutex);
+
+        if (remaining > 0) {
+            worker->stats.steals++;
+            worker->stats.stolenJobs += end - begin;
+
+            // 自己的队列此时为空，其他线程只会看到空队列或窃取来的新范围
+            JobQueue* own = &worker->queues[worker->id];
+            pthread_mutex_lock(&own->mutex);
+            own->begin = begin + 1;
+            own->end = end;
+            pthread_mutex_unlock(&own->mutex);
+            return begin;
+        }
+    }
+    return -1;
+}
+
+// 工作线程主循环：先处理自己的队列，空了就窃取，直到所有队列都为空
+// 任务不会在运行中新增，因此一轮窃取全部失败后就可以结束
+static void* jobWorkerMain(void* arg) {
+    JobWorker* worker = (JobWorker*)arg;
+    JobQueue* own = &worker->queues[worker->id];
+
+    while (1) {
+        int job = popJob(own);
+        if (job < 0) {
+            job = stealJob(worker);
+            if (job < 0) {
+                break;
+            }
+        }
+        worker->function(worker->context, job);
+    }
+    return NULL;
+}
+
+// 用多个线程处理全部任务
+int runJobs(int jobCount, int workerCount, JobFunction function, void* const* contexts, JobStats* stats) {
+    if (workerCount < 1) {
+        workerCount = 1;
+    }
+
+    JobQueue* queues = (JobQueue*)malloc(workerCount * sizeof(JobQueue));
+    JobWorker* workers = (JobWorker*)malloc(workerCount * sizeof(JobWorker));
+    pthread_t* threads = (pthread_t*)malloc(workerCount * sizeof(pthread_t));
+    int* started = (int*)calloc(workerCount, sizeof(int));
+    if (!queues || !workers || !threads || !started) {
+        free(queues);
+        free(workers);
+        free(threads);
+        free(started);
+        return 0;
+    }
+
+    // 按编号平均分段
+    for (int i = 0; i < workerCount; i++) {
+        pthread_mutex_init(&queues[i].mutex, NULL);
+        queues[i].begin = (int)((long long)jobCount * i / workerCount);
+        queues[i].end = (int)((long long)jobCount * (i + 1) / workerCount);
+
+        workers[i].id = i;
+        workers[i].workerCount = workerCount;
+        workers[i].queues = queues;
+        workers[i].function = function;
+        workers[i].context = contexts[i];
+        workers[i].stats.steals = 0;
+        workers[i].stats.stolenJobs = 0;
+    }
+
+    // 主线程自己充当0号工作线程；没有启动的线程的队列会被其他线程窃取完
+    for (int i = 1; i < workerCount; i++) {
+        started[i] = (pthread_create(&threads[i], NULL, jobWorkerMain, &workers[i]) == 0);
+    }
+    jobWorkerMain(&workers[0]);
+
+    if (stats) {
+        stats->steals = 0;
+        stats->stolenJobs = 0;
+    }
+    for (int i = 0; i < workerCount; i++) {
+        if (i > 0 && started[i]) {
+            pthread_join(threads[i], NULL);
+        }
+        if (stats) {
+            stats->steals += workers[i].stats.steals;
+            stats->stolenJobs += workers[i].stats.stolenJobs;
+        }
+        pthread_mutex_destroy(&queues[i].mutex);
+    }
+
+    free(queues);
+    free(workers);
+    free(threads);
+    free(started);
+    return 1;
+}
@@ -0,0 +1,31 @@
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include <pthread.h>
+
+// 处理编号为job的任务，workerContext为执行它的工作线程的上下文
+typedef void (*JobFunction)(void* workerContext, int job);
+
+// 一个工作线程的任务队列：尚未处理的任务编号范围[begin, end)
+// 所有者从begin端逐个取任务，其他线程从end端窃取后一半，因此相邻编号的任务倾向于在同一个线程上执行
+typedef struct {
+    pthread_mutex_t mutex;
+    int begin;
+    int end;
+    char padding[64];       // 避免相邻队列共享缓存行
+} JobQueue;
+
+// 调度统计
+typedef struct {
+    long long steals;       // 窃取次数
+    long long stolenJobs;   // 被窃取的任务总数
+} JobStats;
+
+// 用workerCount个线程（主线程是0号）处理编号[0, jobCount)的任务，第i个线程使用上下文contexts[i]
+// 任务起初按编号平均分成连续的段分给各线程；一个线程的队列空了就从其他线程的队列窃取一半，
+// 耗时差异很大的任务也不会让线程在末尾空闲等待
+// 每个任务恰好执行一次，执行顺序和所在线程不确定，任务应只写自己编号对应的结果
+// 成功返回1，内存分配失败返回0；部分线程创建失败时由已启动的线程完成全部任务
+int runJobs(int jobCount, int workerCount, JobFunction function, void* const* contexts, JobStats* stats);
+
+#endif // SCHEDULER_H
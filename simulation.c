@@ -1,78 +1,446 @@
 #include "simulation.h"
-#include <math.h>
-#include <windows.h>
+#include <limits.h>
+#include "distance.h"
+#include "stencil.h"
+
+// 两阶段模式中每次从线程池领取的装备数
+#define INTENT_CHUNK 256
+
+// 射击方所在的空间索引桶内至少有这么多台敌方装备时，认为附近的敌方装备足够密集，
+// 沿攻击范围模板由近到远逐格查找目标（通常走过几格就能找到），否则用空间索引查找
+#define STENCIL_MIN_BUCKET_ENEMIES 4
+
+// 一个装备在两阶段模式中本步的意图
+typedef struct {
+    signed char dirX, dirY;     // 本步之后的方向
+    unsigned char moves;        // 是否要移动到(destX, destY)
+    unsigned char destroyed;    // 本步被摧毁（结算阶段填写）
+    int destX, destY;
+    int target;                 // 攻击目标在敌方单元存储中的下标（-1表示不攻击）
+} UnitIntent;
+
+// 两阶段模式的意图缓冲区
+struct TickIntents {
+    UnitIntent* red;            // 红方每个装备的意图
+    UnitIntent* blue;           // 蓝方每个装备的意图
+    int redCapacity, blueCapacity;
+    int* claims;                // 每个格子的移动申请：申请者所在格子的编号+1，0表示没有申请
+};
+
+// 一个装备缓存的攻击目标
+typedef struct {
+    int target;                 // 上次查找的结果（-1表示没有能攻击的目标）
+    int x, y;                   // 上次查找时射击方的位置
+    unsigned long long epoch;   // 上次查找时战场的格子变化计数，0表示没有缓存
+} CachedTarget;
+
+// 攻击目标缓存
+struct TargetCache {
+    CachedTarget* red;          // 红方每个装备的缓存
+    CachedTarget* blue;         // 蓝方每个装备的缓存
+    int redCapacity, blueCapacity;
+    long long mismatches;       // 校验模式中缓存查找与完整查找结果不同的次数
+};
 
 // 计算两个装备之间的距离
 int calculateEquipmentDistance(Equipment* e1, Equipment* e2) {
     if (!e1 || !e2) {
         return INT_MAX;
     }
-    return (int)sqrt((e2->x - e1->x) * (e2->x - e1->x) + (e2->y - e1->y) * (e2->y - e1->y));
+    return integerSqrt(squaredDistance(e1->x, e1->y, e2->x, e2->y));
 }
 
-// 查找最近的敌方装备
-Equipment* findNearestEnemy(Battlefield* battlefield, Equipment* equipment) {
-    if (!equipment || !equipment->isActive) {
-        return NULL;
+// 计算两个装备之间的平方距离
+int calculateEquipmentSquaredDistance(Equipment* e1, Equipment* e2) {
+    if (!e1 || !e2) {
+        return INT_MAX;
     }
+    return squaredDistance(e1->x, e1->y, e2->x, e2->y);
+}
 
-    Equipment** enemyEquipments;
-    int enemyCount;
-    Equipment* enemyHQ = NULL;
+// 选择攻击目标时的通视检查
+typedef struct {
+    Battlefield* battlefield;
+    const UnitStore* enemies;
+    int x, y;                   // 射击方的位置
+    BattleStats* stats;
+} SightCheck;
 
-    if (equipment->team == TEAM_RED) {
-        enemyEquipments = battlefield->blueEquipments;
-        enemyCount = battlefield->blueCount;
-        enemyHQ = battlefield->blueHeadquarters;
-    } else {
-        enemyEquipments = battlefield->redEquipments;
-        enemyCount = battlefield->redCount;
-        enemyHQ = battlefield->redHeadquarters;
+// 检查射击方能否看到一批敌方装备：飞行装备不受栅栏阻挡，其余成批检查
+static void checkTargetsVisible(void* context, const int* entries, const int* xs, const int* ys, int count,
+                                unsigned char* visible) {
+    SightCheck* sight = (SightCheck*)context;
+    int groundXs[SPATIAL_VISIBILITY_BATCH];
+    int groundYs[SPATIAL_VISIBILITY_BATCH];
+    int groundSlots[SPATIAL_VISIBILITY_BATCH];
+    unsigned char blocked[SPATIAL_VISIBILITY_BATCH];
+
+    int groundCount = 0;
+    for (int i = 0; i < count; i++) {
+        EquipmentType* type = getEquipmentTypeById(sight->enemies->typeId[entries[i]]);
+        visible[i] = 1;
+        if (!type || !type->canFly) {
+            groundXs[groundCount] = xs[i];
+            groundYs[groundCount] = ys[i];
+            groundSlots[groundCount] = i;
+            groundCount++;
+        }
+    }
+
+    // 全部是飞行装备时都能看到
+    if (groundCount == 0) {
+        return;
+    }
+
+    if (findPathObstacles(sight->battlefield, sight->x, sight->y, groundXs, groundYs, groundCount, blocked,
+                          sight->stats) > 0) {
+        for (int i = 0; i < groundCount; i++) {
+            visible[groundSlots[i]] = !blocked[i];
+        }
+    }
+}
+
+// 在敌方的空间索引中查找最近的装备，sight不为NULL时只考虑能看到的装备
+// 收集统计时记录检查过的候选装备数
+static int findNearestInIndex(const SpatialGrid* grid, int x, int y, int limitSquared, SightCheck* sight,
+                              BattleStats* stats) {
+    if (sight) {
+        int visited;
+        int nearest = spatialFindNearestVisible(grid, x, y, limitSquared, checkTargetsVisible, sight, &visited);
+        STATS_COUNT(stats, nearestCalls, 1);
+        STATS_COUNT(stats, candidatesExamined, visited);
+        return nearest;
     }
+#ifdef BATTLE_STATS
+    if (stats) {
+        int visited;
+        int nearest = spatialFindNearestCounted(grid, x, y, limitSquared, &visited);
+        stats->nearestCalls++;
+        stats->candidatesExamined += visited;
+        return nearest;
+    }
+#endif
+    (void)stats;
+    return spatialFindNearest(grid, x, y, limitSquared);
+}
+
+// 对一批候选装备检查通视，返回nearest和其中能看到的装备中下标最小的一个
+static int pickVisibleTarget(SightCheck* sight, const int* entries, const int* xs, const int* ys, int count,
+                             int nearest) {
+    unsigned char visible[SPATIAL_VISIBILITY_BATCH];
+    checkTargetsVisible(sight, entries, xs, ys, count, visible);
+    for (int i = 0; i < count; i++) {
+        if (visible[i] && (nearest < 0 || entries[i] < nearest)) {
+            nearest = entries[i];
+        }
+    }
+    return nearest;
+}
 
-    Equipment* nearest = NULL;
-    int minDistance = INT_MAX;
+// 沿攻击范围模板由近到远逐格查找最近的敌方装备，结果与findNearestInIndex相同：
+// 只返回距离键值小于limitSquared键值的装备，同样近时取下标最小的，sight不为NULL时只考虑能看到的装备
+// 格子直接记录占据它的装备，密集的战场上通常走过几格就能找到目标，不必检查附近桶内的全部装备
+static int findNearestInStencil(Battlefield* battlefield, Team enemyTeam, const RangeStencil* stencil, int x, int y,
+                                int limitSquared, SightCheck* sight, BattleStats* stats) {
+    int entries[SPATIAL_VISIBILITY_BATCH];
+    int xs[SPATIAL_VISIBILITY_BATCH];
+    int ys[SPATIAL_VISIBILITY_BATCH];
+    int limitKey = distanceKey(limitSquared);
+    int nearest = -1;
+    int visited = 0;
+
+    // 每次处理距离键值相同的一组格子，组内有目标时就是结果
+    int i = 0;
+    while (nearest < 0 && i < stencil->count && stencil->keys[i] < limitKey) {
+        int key = stencil->keys[i];
+        int count = 0;
+        for (; i < stencil->count && stencil->keys[i] == key; i++) {
+            int cx = x + stencil->dx[i];
+            int cy = y + stencil->dy[i];
+            if (!isPositionValid(battlefield, cx, cy)) {
+                continue;
+            }
+            Cell cell = getCell(battlefield, cx, cy);
+            if (cell == 0 || getCellTeam(cell) != enemyTeam) {
+                continue;
+            }
+
+            int unit = getCellUnit(cell);
+            visited++;
+            if (!sight) {
+                if (nearest < 0 || unit < nearest) {
+                    nearest = unit;
+                }
+                continue;
+            }
+            // 需要检查通视时先收集起来，批满或这一组结束时成批检查
+            entries[count] = unit;
+            xs[count] = cx;
+            ys[count] = cy;
+            count++;
+            if (count == SPATIAL_VISIBILITY_BATCH) {
+                nearest = pickVisibleTarget(sight, entries, xs, ys, count, nearest);
+                count = 0;
+            }
+        }
+        if (count > 0) {
+            nearest = pickVisibleTarget(sight, entries, xs, ys, count, nearest);
+        }
+    }
+
+    STATS_COUNT(stats, nearestCalls, 1);
+    STATS_COUNT(stats, candidatesExamined, visited);
+    return nearest;
+}
+
+// 查找指定装备最近的敌方装备
+int findNearestEnemyIndex(Battlefield* battlefield, Team team, int index) {
+    UnitStore* units = getTeamUnits(battlefield, team);
+    if (!units->alive[index]) {
+        return -1;
+    }
+
+    Team enemyTeam = getEnemyTeam(team);
+    UnitStore* enemies = getTeamUnits(battlefield, enemyTeam);
+    int enemyHQ = getTeamHQUnit(battlefield, enemyTeam);
+    int x = units->x[index];
+    int y = units->y[index];
+
+    int nearest = -1;
+    int minSquared = INT_MAX;
 
     // 先考虑敌方指挥部（如果存在且激活）
-    if (enemyHQ && enemyHQ->isActive) {
-        int distance = calculateEquipmentDistance(equipment, enemyHQ);
-        if (distance < minDistance) {
-            minDistance = distance;
+    if (enemyHQ >= 0 && enemies->alive[enemyHQ]) {
+        minSquared = squaredDistance(x, y, enemies->x[enemyHQ], enemies->y[enemyHQ]);
+        nearest = enemyHQ;
+    }
+
+    // 再通过空间索引查找比指挥部更近的敌方装备
+    // 距离相同时指挥部优先，其余按装备数组中的先后顺序
+    int enemy = findNearestInIndex(getTeamIndex(battlefield, enemyTeam), x, y, minSquared, NULL, battlefield->stats);
+    if (enemy >= 0) {
+        nearest = enemy;
+    }
+
+    return nearest;
+}
+
+// 查找攻击范围内最近的、没有被栅栏挡住的敌方装备
+// 没有栅栏时结果与“先找最近的敌方装备，再检查是否在攻击范围内”相同
+// 空间搜索限制在平方距离maxSquared以内（不超过攻击半径radius对应的最大平方距离），
+// 两军相距很远时不必逐圈扫描中间大片的空桶
+// 意图阶段可能在多个线程上调用，统计记录到调用者指定的stats中
+static int findNearestEnemyInRange(Battlefield* battlefield, Team team, int index, int radius, int maxSquared,
+                                   BattleStats* stats) {
+    UnitStore* units = getTeamUnits(battlefield, team);
+    Team enemyTeam = getEnemyTeam(team);
+    UnitStore* enemies = getTeamUnits(battlefield, enemyTeam);
+    int enemyHQ = getTeamHQUnit(battlefield, enemyTeam);
+    int x = units->x[index];
+    int y = units->y[index];
+
+    int nearest = -1;
+    int limitSquared = maxSquared < INT_MAX ? maxSquared + 1 : INT_MAX;
+
+    // 射击方不会飞、攻击范围内有栅栏时才需要检查通视，否则范围内的目标都能看到
+    SightCheck check;
+    SightCheck* sight = NULL;
+    EquipmentType* type = getEquipmentTypeById(units->typeId[index]);
+    if (maxSquared >= 0 && (!type || !type->canFly) && hasFenceNear(battlefield, x, y, integerSqrt(maxSquared))) {
+        check.battlefield = battlefield;
+        check.enemies = enemies;
+        check.x = x;
+        check.y = y;
+        check.stats = stats;
+        sight = &check;
+    }
+
+    // 指挥部在攻击范围内且能看到时，只有比指挥部更近的装备才能取代它；
+    // 指挥部不在攻击范围内时，最近的敌方装备要么在范围内，要么比指挥部更远，都不需要考虑指挥部
+    if (enemyHQ >= 0 && enemies->alive[enemyHQ]) {
+        int hqSquared = squaredDistance(x, y, enemies->x[enemyHQ], enemies->y[enemyHQ]);
+        unsigned char visible = 1;
+        if (sight && hqSquared <= maxSquared) {
+            checkTargetsVisible(sight, &enemyHQ, &enemies->x[enemyHQ], &enemies->y[enemyHQ], 1, &visible);
+        }
+        if (hqSquared <= maxSquared && visible) {
             nearest = enemyHQ;
+            limitSquared = hqSquared;
         }
     }
 
-    // 再遍历敌方普通装备，找到最近的一个
-    for (int i = 0; i < enemyCount; i++) {
-        Equipment* enemy = enemyEquipments[i];
-        if (!enemy->isActive) {
-            continue;
+    // 附近的敌方装备足够密集时沿攻击范围模板查找，否则用空间索引查找
+    const SpatialGrid* enemyIndex = getTeamIndex(battlefield, enemyTeam);
+    const RangeStencil* stencil = getRangeStencil(radius);
+    int enemy;
+    if (stencil && spatialCountBucket(enemyIndex, x, y) >= STENCIL_MIN_BUCKET_ENEMIES) {
+        enemy = findNearestInStencil(battlefield, enemyTeam, stencil, x, y, limitSquared, sight, stats);
+    } else {
+        enemy = findNearestInIndex(enemyIndex, x, y, limitSquared, sight, stats);
+    }
+    if (enemy >= 0) {
+        nearest = enemy;
+    }
+    return nearest;
+}
+
+// 检查射击方能否看到敌方下标为target的装备（规则与findNearestEnemyInRange相同）
+static int isTargetVisible(Battlefield* battlefield, Team team, int index, int target, BattleStats* stats) {
+    UnitStore* units = getTeamUnits(battlefield, team);
+    UnitStore* enemies = getTeamUnits(battlefield, getEnemyTeam(team));
+    EquipmentType* type = getEquipmentTypeById(units->typeId[index]);
+    EquipmentType* targetType = getEquipmentTypeById(enemies->typeId[target]);
+    if ((type && type->canFly) || (targetType && targetType->canFly)) {
+        return 1;
+    }
+    unsigned char blocked = 0;
+    findPathObstacles(battlefield, units->x[index], units->y[index], &enemies->x[target], &enemies->y[target], 1,
+                      &blocked, stats);
+    return !blocked;
+}
+
+// 使用缓存查找攻击目标，结果与findNearestEnemyInRange完全相同：
+// 查找结果只取决于射击方的位置、攻击范围内的敌方装备和栅栏，
+// 射击方没有移动、范围内的格子块在上次查找之后都没有敌方装备或栅栏的变化时直接使用上次的结果；
+// 否则上次的目标仍然存活、在范围内并且能看到时，更近的目标只可能在它的距离以内，只在这个距离内重新查找
+static int findCachedTarget(Battlefield* battlefield, Team team, int index, int radius, CachedTarget* entry,
+                            BattleStats* stats) {
+    UnitStore* units = getTeamUnits(battlefield, team);
+    int x = units->x[index];
+    int y = units->y[index];
+    int maxSquared = squaredAttackRadius(radius);
+    if (entry->epoch > 0 && entry->x == x && entry->y == y) {
+        int reach = maxSquared > 0 ? integerSqrt(maxSquared) : 0;
+        if (!hasCellsChangedSince(battlefield, getEnemyTeam(team), x, y, reach, entry->epoch)) {
+            STATS_COUNT(stats, targetCacheHits, 1);
+            return entry->target;
         }
+    }
 
-        int distance = calculateEquipmentDistance(equipment, enemy);
-        if (distance < minDistance) {
-            minDistance = distance;
-            nearest = enemy;
+    // 快照恢复后缓存的下标可能已经不存在或换了装备，只要满足条件，任何装备的距离都是有效的上限
+    int boundSquared = maxSquared;
+    int target = entry->target;
+    UnitStore* enemies = getTeamUnits(battlefield, getEnemyTeam(team));
+    if (entry->epoch > 0 && target >= 0 && target < enemies->count && enemies->alive[target]) {
+        int squared = squaredDistance(x, y, enemies->x[target], enemies->y[target]);
+        if (squared <= maxSquared && isTargetVisible(battlefield, team, index, target, stats)) {
+            boundSquared = maxSquaredForKey(distanceKey(squared));
+            if (boundSquared > maxSquared) {
+                boundSquared = maxSquared;
+            }
+            STATS_COUNT(stats, targetCacheBounded, 1);
         }
     }
 
+    int nearest = findNearestEnemyInRange(battlefield, team, index, radius, boundSquared, stats);
+    entry->target = nearest;
+    entry->x = x;
+    entry->y = y;
+    entry->epoch = battlefield->cellEpoch;
     return nearest;
 }
 
-// 处理装备移动
-void handleMovement(Battlefield* battlefield, Equipment* equipment) {
-    if (!equipment || !equipment->isActive) {
-        return;
+// 查找攻击范围内最近的敌方装备，按battlefield->targetCacheMode决定是否使用攻击目标缓存
+// 校验模式同时进行完整查找，结果不同时计数并使用完整查找的结果；每个装备只读写自己的缓存，可以在多个线程上调用
+static int findTarget(Battlefield* battlefield, Team team, int index, int radius, BattleStats* stats) {
+    TargetCache* cache = battlefield->targetCache;
+    if (battlefield->targetCacheMode == TARGET_CACHE_OFF || !cache) {
+        return findNearestEnemyInRange(battlefield, team, index, radius, squaredAttackRadius(radius), stats);
+    }
+
+    CachedTarget* entry = team == TEAM_RED ? &cache->red[index] : &cache->blue[index];
+    int target = findCachedTarget(battlefield, team, index, radius, entry, stats);
+    if (battlefield->targetCacheMode == TARGET_CACHE_VERIFY) {
+        int expected = findNearestEnemyInRange(battlefield, team, index, radius, squaredAttackRadius(radius), stats);
+        if (target != expected) {
+            __atomic_fetch_add(&cache->mismatches, 1, __ATOMIC_RELAXED);
+            entry->target = expected;
+            target = expected;
+        }
+    }
+    return target;
+}
+
+// 保证攻击目标缓存能容纳双方的全部装备，内存分配失败时返回0
+// 扩大时重新分配的缓存为空，这些装备下一次完整查找
+static int prepareTargetCache(Battlefield* battlefield) {
+    TargetCache* cache = battlefield->targetCache;
+    if (!cache) {
+        cache = (TargetCache*)arenaCalloc(battlefield->arena, 1, sizeof(TargetCache));
+        if (!cache) {
+            return 0;
+        }
+        battlefield->targetCache = cache;
+    }
+
+    if (cache->redCapacity < battlefield->redUnits.count) {
+        int capacity = battlefield->redUnits.capacity;
+        CachedTarget* red = (CachedTarget*)arenaCalloc(battlefield->arena, (size_t)capacity, sizeof(CachedTarget));
+        if (!red) {
+            return 0;
+        }
+        cache->red = red;
+        cache->redCapacity = capacity;
+    }
+    if (cache->blueCapacity < battlefield->blueUnits.count) {
+        int capacity = battlefield->blueUnits.capacity;
+        CachedTarget* blue = (CachedTarget*)arenaCalloc(battlefield->arena, (size_t)capacity, sizeof(CachedTarget));
+        if (!blue) {
+            return 0;
+        }
+        cache->blue = blue;
+        cache->blueCapacity = capacity;
+    }
+    return 1;
+}
+
+// 获取校验模式中缓存查找与完整查找结果不同的次数
+long long getTargetCacheMismatches(const Battlefield* battlefield) {
+    return battlefield->targetCache ? battlefield->targetCache->mismatches : 0;
+}
+
+// 查找最近的敌方装备
+Equipment* findNearestEnemy(Battlefield* battlefield, Equipment* equipment) {
+    if (!equipment) {
+        return NULL;
     }
 
-    EquipmentType* type = getEquipmentTypeById(equipment->typeId);
+    int index = findUnitIndex(getTeamUnits(battlefield, equipment->team), equipment);
+    if (index < 0) {
+        return NULL;
+    }
+
+    int nearest = findNearestEnemyIndex(battlefield, equipment->team, index);
+    if (nearest < 0) {
+        return NULL;
+    }
+
+    UnitStore* enemies = getTeamUnits(battlefield, getEnemyTeam(equipment->team));
+    syncUnitView(enemies, nearest);
+    return &enemies->views[nearest];
+}
+
+// 计算一个装备本步的移动（只读取战场状态，不做修改）
+// dirX/dirY返回移动后的方向；返回1表示移动到(destX, destY)，0表示不移动（方向仍可能改变）
+static int planUnitMove(Battlefield* battlefield, Team team, int index,
+                        int* dirX, int* dirY, int* destX, int* destY, BattleStats* stats) {
+    UnitStore* units = getTeamUnits(battlefield, team);
+
+    int x = units->x[index];
+    int y = units->y[index];
+    int directionX = units->dirX[index];
+    int directionY = units->dirY[index];
+    *dirX = directionX;
+    *dirY = directionY;
+
+    EquipmentType* type = getEquipmentTypeById(units->typeId[index]);
     if (!type || type->maxSpeed == 0) { // 固定装备不移动
-        return;
+        return 0;
     }
 
     // 计算新位置
-    int newX = equipment->x + equipment->directionX;
-    int newY = equipment->y + equipment->directionY;
+    int newX = x + directionX;
+    int newY = y + directionY;
 
     // 检查水平和垂直方向上的碰撞
     int hitLeft = (newX < 0);                       // 左边界碰撞
@@ -84,372 +452,579 @@ void handleMovement(Battlefield* battlefield, Equipment* equipment) {
     int hitEquipment = 0;
     // 只有在不碰到边界的情况下才检查装备碰撞
     if (!hitLeft && !hitRight && !hitTop && !hitBottom) {
-        Cell* cell = getCell(battlefield, newX, newY);
-        hitEquipment = (cell->status != CELL_EMPTY);
+        hitEquipment = isCellOccupied(battlefield, newX, newY);
     }
 
     // 是否发生碰撞的标志
     int collisionOccurred = hitLeft || hitRight || hitTop || hitBottom || hitEquipment;
+    STATS_COUNT(stats, collisions, collisionOccurred);
 
     // 计算反弹方向
-    if (hitLeft || hitRight || (hitEquipment && equipment->directionX != 0)) {
+    if (hitLeft || hitRight || (hitEquipment && directionX != 0)) {
         // 水平方向反弹
-        equipment->directionX = -equipment->directionX;
+        directionX = -directionX;
     }
     
-    if (hitTop || hitBottom || (hitEquipment && equipment->directionY != 0)) {
+    if (hitTop || hitBottom || (hitEquipment && directionY != 0)) {
         // 垂直方向反弹
-        equipment->directionY = -equipment->directionY;
+        directionY = -directionY;
     }
 
     // 对于斜向移动的装备，处理角落碰撞（可能同时碰到两个边界）
     if ((hitLeft && hitTop) || (hitLeft && hitBottom) || 
         (hitRight && hitTop) || (hitRight && hitBottom)) {
         // 同时碰到两个边界，两个方向都反向
-        equipment->directionX = -equipment->directionX;
-        equipment->directionY = -equipment->directionY;
+        directionX = -directionX;
+        directionY = -directionY;
     }
+
+    *dirX = directionX;
+    *dirY = directionY;
     
     // 如果发生碰撞，向敌方大本营偏移一格
     if (collisionOccurred) {
         // 根据队伍确定敌方大本营位置
-        Equipment* enemyHQ = NULL;
-        if (equipment->team == TEAM_RED) {
-            enemyHQ = battlefield->blueHeadquarters;
-        } else {
-            enemyHQ = battlefield->redHeadquarters;
-        }
+        Team enemyTeam = getEnemyTeam(team);
+        UnitStore* enemies = getTeamUnits(battlefield, enemyTeam);
+        int enemyHQ = getTeamHQUnit(battlefield, enemyTeam);
 
-        if (enemyHQ && enemyHQ->isActive) {
+        if (enemyHQ >= 0 && enemies->alive[enemyHQ]) {
             // 计算向敌方大本营的方向
             int dx = 0;
             int dy = 0;
             
             // 决定x方向的偏移
-            if (enemyHQ->x > equipment->x) {
+            if (enemies->x[enemyHQ] > x) {
                 dx = 1; // 向右偏移
-            } else if (enemyHQ->x < equipment->x) {
+            } else if (enemies->x[enemyHQ] < x) {
                 dx = -1; // 向左偏移
             }
             
             // 决定y方向的偏移
-            if (enemyHQ->y > equipment->y) {
+            if (enemies->y[enemyHQ] > y) {
                 dy = 1; // 向下偏移
-            } else if (enemyHQ->y < equipment->y) {
+            } else if (enemies->y[enemyHQ] < y) {
                 dy = -1; // 向上偏移
             }
             
             // 确定偏移后的位置
-            int shiftX = equipment->x + dx;
-            int shiftY = equipment->y + dy;
+            int shiftX = x + dx;
+            int shiftY = y + dy;
             
             // 检查偏移位置是否有效且为空
             if (isPositionValid(battlefield, shiftX, shiftY)) {
-                Cell* shiftCell = getCell(battlefield, shiftX, shiftY);
-                if (shiftCell->status == CELL_EMPTY) {
-                    // 先从原位置移除
-                    Cell* oldCell = getCell(battlefield, equipment->x, equipment->y);
-                    oldCell->status = CELL_EMPTY;
-                    oldCell->equipment = NULL;
-                    
-                    // 更新位置
-                    equipment->x = shiftX;
-                    equipment->y = shiftY;
-                    
-                    // 添加到新位置
-                    shiftCell->equipment = equipment;
-                    shiftCell->status = equipment->team == TEAM_RED ? CELL_OCCUPIED_RED : CELL_OCCUPIED_BLUE;
+                if (!isCellOccupied(battlefield, shiftX, shiftY)) {
+                    *destX = shiftX;
+                    *destY = shiftY;
                     
                     // 已经移动，不需要继续常规移动
-                    return;
+                    return 1;
                 }
             }
         }
     }
     
     // 检查碰撞后的新位置（常规移动）
-    newX = equipment->x + equipment->directionX;
-    newY = equipment->y + equipment->directionY;
+    newX = x + directionX;
+    newY = y + directionY;
     
     // 确保新位置有效，如果无效则不移动
     if (!isPositionValid(battlefield, newX, newY)) {
-        return;
+        return 0;
     }
     
     // 确保新位置未被占用
-    Cell* cell = getCell(battlefield, newX, newY);
-    if (cell->status != CELL_EMPTY) {
+    if (isCellOccupied(battlefield, newX, newY)) {
+        return 0;
+    }
+
+    *destX = newX;
+    *destY = newY;
+    return 1;
+}
+
+// 移动一个装备（可能只改变方向）
+static void moveUnit(Battlefield* battlefield, Team team, int index) {
+    UnitStore* units = getTeamUnits(battlefield, team);
+    int dirX, dirY, destX, destY;
+    int moves = planUnitMove(battlefield, team, index, &dirX, &dirY, &destX, &destY, battlefield->stats);
+
+    units->dirX[index] = (signed char)dirX;
+    units->dirY[index] = (signed char)dirY;
+    if (moves) {
+        moveUnitOnBattlefield(battlefield, team, index, destX, destY);
+    }
+}
+
+// 处理指定装备的移动
+void handleUnitMovement(Battlefield* battlefield, Team team, int index) {
+    UnitStore* units = getTeamUnits(battlefield, team);
+    if (!units->alive[index]) {
         return;
     }
 
-    // 执行移动
-    // 先从原位置移除
-    Cell* oldCell = getCell(battlefield, equipment->x, equipment->y);
-    oldCell->status = CELL_EMPTY;
-    oldCell->equipment = NULL;
+    BattleStats* stats = battlefield->stats;
+    STATS_COUNT(stats, movementCalls, 1);
+    STATS_TIMER_BEGIN(stats, timer);
 
-    // 更新装备位置
-    equipment->x = newX;
-    equipment->y = newY;
+    if (!battlefield->eventLog) {
+        moveUnit(battlefield, team, index);
+        STATS_TIMER_END(stats, STATS_PHASE_MOVEMENT, timer);
+        return;
+    }
 
-    // 添加到新位置
-    cell->equipment = equipment;
-    cell->status = equipment->team == TEAM_RED ? CELL_OCCUPIED_RED : CELL_OCCUPIED_BLUE;
+    // 记录事件时比较移动前后的位置和方向
+    int oldX = units->x[index];
+    int oldY = units->y[index];
+    int oldDirX = units->dirX[index];
+    int oldDirY = units->dirY[index];
+    moveUnit(battlefield, team, index);
+    if (units->x[index] != oldX || units->y[index] != oldY ||
+        units->dirX[index] != oldDirX || units->dirY[index] != oldDirY) {
+        eventLogMove(battlefield->eventLog, team, index, units->x[index] - oldX, units->y[index] - oldY,
+                     units->dirX[index], units->dirY[index]);
+    }
+    STATS_TIMER_END(stats, STATS_PHASE_MOVEMENT, timer);
 }
 
-// 在控制台上绘制弹道
-void drawProjectilePath(Battlefield* battlefield, Equipment* attacker, Equipment* target, int isHit) {
-    if (!attacker || !target || !battlefield) {
+// 处理装备移动
+void handleMovement(Battlefield* battlefield, Equipment* equipment) {
+    if (!equipment) {
         return;
     }
-    
-    // 创建一个临时战场数据结构来绘制弹道
-    // 保存原始战场的单元格状态
-    Cell** originalCells = (Cell**)malloc(battlefield->height * sizeof(Cell*));
-    for (int i = 0; i < battlefield->height; i++) {
-        originalCells[i] = (Cell*)malloc(battlefield->width * sizeof(Cell));
-        for (int j = 0; j < battlefield->width; j++) {
-            // 复制单元格状态
-            originalCells[i][j] = battlefield->cells[i][j];
-        }
+
+    UnitStore* units = getTeamUnits(battlefield, equipment->team);
+    int index = findUnitIndex(units, equipment);
+    if (index < 0) {
+        return;
+    }
+
+    handleUnitMovement(battlefield, equipment->team, index);
+    syncUnitView(units, index);
+}
+
+// 装备向攻击范围内的敌方装备target开火：消耗弹药、按命中率结算伤害并记录事件，目标生命值最低减到0
+// 返回造成的伤害，没有交互数据（不能攻击）时返回-1；被摧毁的目标由调用者移除
+static int fireAtTarget(Battlefield* battlefield, Team team, int index, int target) {
+    UnitStore* units = getTeamUnits(battlefield, team);
+    UnitStore* enemies = getTeamUnits(battlefield, getEnemyTeam(team));
+
+    // 获取交互数据
+    EquipmentInteraction* interaction = getInteraction(units->typeId[index], enemies->typeId[target]);
+    if (!interaction) {
+        return -1;
     }
     
-    // 使用Bresenham算法计算弹道路径
-    int x1 = attacker->x;
-    int y1 = attacker->y;
-    int x2 = target->x;
-    int y2 = target->y;
+    // 减少弹药量（无论是否命中都消耗弹药）
+    units->ammo[index]--;
     
-    // 计算直线坐标差异
-    int dx = abs(x2 - x1);
-    int dy = abs(y2 - y1);
-    int sx = (x1 < x2) ? 1 : -1;
-    int sy = (y1 < y2) ? 1 : -1;
-    int err = dx - dy;
-    int e2;
+    // 根据命中率决定是否命中
+    int randomValue = rngNextBelow(&battlefield->rng, 100);
+    int isHit = (randomValue < interaction->accuracy);
+    STATS_COUNT(battlefield->stats, shotsFired, 1);
+    STATS_COUNT(battlefield->stats, shotsHit, isHit);
     
-    // 计算所有弹道点位置，存储到数组中
-    int maxPathLength = battlefield->width + battlefield->height; // 最大可能的路径长度
-    int* pathX = (int*)malloc(maxPathLength * sizeof(int));
-    int* pathY = (int*)malloc(maxPathLength * sizeof(int));
-    int pathLength = 0;
+    // 记录弹道（无论是否命中都显示弹道），在下一帧统一绘制；没有实时显示时跳过
+    if (battlefield->renderer) {
+        rendererAddTrail(battlefield->renderer, team, units->x[index], units->y[index],
+                         enemies->x[target], enemies->y[target], isHit);
+    }
     
-    int currentX = x1;
-    int currentY = y1;
-    while (currentX != x2 || currentY != y2) {
-        // 跳过起点
-        if (currentX != x1 || currentY != y1) {
-            // 只存储战场内的有效点
-            if (isPositionValid(battlefield, currentX, currentY)) {
-                pathX[pathLength] = currentX;
-                pathY[pathLength] = currentY;
-                pathLength++;
-            }
+    // 只有命中才计算伤害
+    int damage = 0;
+    if (isHit) {
+        // 计算伤害（与calculateDamage相同，按精确度再判定一次）
+        if (rngNextBelow(&battlefield->rng, 100) < interaction->accuracy) {
+            damage = interaction->damage;
         }
-        
-        // 计算下一个点
-        e2 = 2 * err;
-        if (e2 > -dy) {
-            err -= dy;
-            currentX += sx;
-        }
-        if (e2 < dx) {
-            err += dx;
-            currentY += sy;
+    }
+    if (battlefield->eventLog) {
+        eventLogShot(battlefield->eventLog, team, index, target, isHit, damage);
+    }
+
+    if (damage > 0) {
+        // 减少目标生命值
+        enemies->health[target] -= damage;
+        if (enemies->health[target] < 0) {
+            enemies->health[target] = 0;
         }
-        
-        // 防止无限循环
-        if (pathLength >= maxPathLength - 1) {
-            break;
+    }
+    return damage;
+}
+
+// 处理指定装备的攻击
+int handleUnitAttack(Battlefield* battlefield, Team team, int index) {
+    UnitStore* units = getTeamUnits(battlefield, team);
+    if (!units->alive[index] || units->ammo[index] <= 0) {
+        return -1;
+    }
+
+    EquipmentType* attackerType = getEquipmentTypeById(units->typeId[index]);
+    if (!attackerType) {
+        return -1;
+    }
+
+    BattleStats* stats = battlefield->stats;
+    STATS_COUNT(stats, attackCalls, 1);
+
+    // 查找攻击范围内最近的敌方装备，范围规则与canAttack相同
+    STATS_TIMER_BEGIN(stats, targetingTimer);
+    int target = findTarget(battlefield, team, index, attackerType->maxAttackRadius, stats);
+    STATS_TIMER_END(stats, STATS_PHASE_TARGETING, targetingTimer);
+    if (target < 0) {
+        return -1;
+    }
+
+    // 开火，目标被摧毁时从战场移除
+    STATS_TIMER_BEGIN(stats, attackTimer);
+    int damage = fireAtTarget(battlefield, team, index, target);
+    if (damage < 0) {
+        STATS_TIMER_END(stats, STATS_PHASE_ATTACK, attackTimer);
+        return -1;
+    }
+
+    Team enemyTeam = getEnemyTeam(team);
+    UnitStore* enemies = getTeamUnits(battlefield, enemyTeam);
+    if (damage > 0 && enemies->health[target] <= 0) {
+        removeUnitFromBattlefield(battlefield, enemyTeam, target);
+        markUnitDestroyed(enemies, target);
+        STATS_COUNT(stats, kills, 1);
+        if (battlefield->eventLog) {
+            eventLogKill(battlefield->eventLog, enemyTeam, target);
         }
     }
-    
-    // 为终点添加特殊标记
-    pathX[pathLength] = x2;
-    pathY[pathLength] = y2;
-    pathLength++;
-    
-    // 清屏以准备绘制战场和弹道
-    system("cls");
-    
-    // 先绘制战场
-    renderBattlefield(battlefield, TEAM_NONE);
-    
-    // 获取控制台句柄用于单独设置弹道字符颜色
-    HANDLE hConsole = GetStdHandle(STD_OUTPUT_HANDLE);
-    CONSOLE_SCREEN_BUFFER_INFO consoleInfo;
-    GetConsoleScreenBufferInfo(hConsole, &consoleInfo);
-    WORD originalAttrs = consoleInfo.wAttributes;
-    
-    // 准确计算战场在控制台中的渲染位置
-    // 根据战场渲染逻辑分析:
-    // Line 0: 战场状态
-    // Line 1: 预算信息
-    // Line 2: 红方大本营血量
-    // Line 3: 蓝方大本营血量
-    // Line 4: X坐标十位
-    // Line 5: X坐标个位
-    // Line 6: 上边框
-    // Line 7 onwards: Grid rows (e.g., "0 |cellcell...")
-    int lineNumberWidth = 3; // Y坐标及"|" (e.g., "0 |" or "10|")
-    int firstRowHeight = 7;  // 战场网格内容前的总行数
-
-    // 直接绘制整条弹道线
-    for (int i = 0; i < pathLength; i++) {
-        int x = pathX[i];
-        int y = pathY[i];
-        
-        // 跳过起点和被占用的非终点位置
-        if ((x == x1 && y == y1) || 
-            (i < pathLength - 1 && getCell(battlefield, x, y)->status != CELL_EMPTY)) {
-            continue;
+    STATS_TIMER_END(stats, STATS_PHASE_ATTACK, attackTimer);
+
+    return target;
+}
+
+// 处理装备攻击
+void handleAttack(Battlefield* battlefield, Equipment* equipment) {
+    if (!equipment) {
+        return;
+    }
+
+    UnitStore* units = getTeamUnits(battlefield, equipment->team);
+    int index = findUnitIndex(units, equipment);
+    if (index < 0) {
+        return;
+    }
+
+    int target = handleUnitAttack(battlefield, equipment->team, index);
+    syncUnitView(units, index);
+    if (target >= 0) {
+        syncUnitView(getTeamUnits(battlefield, getEnemyTeam(equipment->team)), target);
+    }
+}
+
+// 检查是否有一方获胜
+int checkVictory(Battlefield* battlefield) {
+    // 双方活跃装备数量由单元存储随部署和摧毁维护
+    int redActive = battlefield->redUnits.aliveCount;
+    int blueActive = battlefield->blueUnits.aliveCount;
+
+    // 判断胜负
+    if (redActive == 0 && blueActive > 0) {
+        return 2; // 蓝方获胜
+    } else if (blueActive == 0 && redActive > 0) {
+        return 1; // 红方获胜
+    } else if (redActive == 0 && blueActive == 0) {
+        return 3; // 平局
+    }
+
+    return 0; // 继续
+}
+
+// 获取胜负结果的说明文字
+const char* getVictoryMessage(int result) {
+    switch (result) {
+        case 1: return "红方获胜！";
+        case 2: return "蓝方获胜！";
+        case 3: return "平局！";
+        default: return "战斗尚未结束";
+    }
+}
+
+// 保证意图缓冲区能容纳双方的全部装备，内存分配失败时返回0
+static int prepareTickIntents(Battlefield* battlefield) {
+    TickIntents* intents = battlefield->intents;
+    if (!intents) {
+        intents = (TickIntents*)arenaCalloc(battlefield->arena, 1, sizeof(TickIntents));
+        if (!intents) {
+            return 0;
         }
-        
-        // 计算控制台坐标
-        COORD pos = {lineNumberWidth + x, firstRowHeight + y};
-        SetConsoleCursorPosition(hConsole, pos);
-        
-        // 根据攻击方队伍设置弹道字符颜色
-        if (attacker->team == TEAM_RED) {
-            SetConsoleTextAttribute(hConsole, FOREGROUND_RED | FOREGROUND_INTENSITY);
-        } else {
-            SetConsoleTextAttribute(hConsole, FOREGROUND_BLUE | FOREGROUND_INTENSITY);
+        intents->claims = (int*)arenaCalloc(battlefield->arena, (size_t)battlefield->width * battlefield->height,
+                                            sizeof(int));
+        if (!intents->claims) {
+            return 0;
         }
-        
-        // 绘制弹道字符
-        if (i == pathLength - 1) {
-            // 终点 - 命中效果
-            printf("%s", isHit ? "X" : "O");
-        } else {
-            // 弹道轨迹
-            printf("*");
+        battlefield->intents = intents;
+    }
+
+    // 意图每步重新计算，不需要保留旧内容
+    if (intents->redCapacity < battlefield->redUnits.count) {
+        int capacity = battlefield->redUnits.capacity;
+        UnitIntent* red = (UnitIntent*)arenaAlloc(battlefield->arena, (size_t)capacity * sizeof(UnitIntent));
+        if (!red) {
+            return 0;
         }
-        
-        // 恢复控制台颜色属性
-        SetConsoleTextAttribute(hConsole, originalAttrs);
+        intents->red = red;
+        intents->redCapacity = capacity;
     }
-    
-    // 短暂停留以便观察
-    Sleep(500);
-    
-    // 释放资源
-    free(pathX);
-    free(pathY);
-    
-    // 释放临时战场内存
-    for (int i = 0; i < battlefield->height; i++) {
-        free(originalCells[i]);
+    if (intents->blueCapacity < battlefield->blueUnits.count) {
+        int capacity = battlefield->blueUnits.capacity;
+        UnitIntent* blue = (UnitIntent*)arenaAlloc(battlefield->arena, (size_t)capacity * sizeof(UnitIntent));
+        if (!blue) {
+            return 0;
+        }
+        intents->blue = blue;
+        intents->blueCapacity = capacity;
     }
-    free(originalCells);
+    return 1;
 }
 
-// 处理装备攻击
-void handleAttack(Battlefield* battlefield, Equipment* equipment) {
-    if (!equipment || !equipment->isActive || equipment->currentAmmo <= 0) {
+// 计算一个装备本步的移动和攻击目标，只读取上一步结束时的战场状态，统计记录到stats中
+static void planUnitIntent(Battlefield* battlefield, Team team, int index, UnitIntent* intent, BattleStats* stats) {
+    UnitStore* units = getTeamUnits(battlefield, team);
+    intent->dirX = units->dirX[index];
+    intent->dirY = units->dirY[index];
+    intent->moves = 0;
+    intent->destroyed = 0;
+    intent->target = -1;
+    if (!units->alive[index]) {
         return;
     }
 
-    // 查找最近的敌方装备
-    Equipment* target = findNearestEnemy(battlefield, equipment);
-    if (!target) {
-        return;
+    int dirX, dirY;
+    STATS_COUNT(stats, movementCalls, 1);
+    STATS_TIMER_BEGIN(stats, movementTimer);
+    intent->moves = (unsigned char)planUnitMove(battlefield, team, index, &dirX, &dirY,
+                                                &intent->destX, &intent->destY, stats);
+    intent->dirX = (signed char)dirX;
+    intent->dirY = (signed char)dirY;
+    STATS_TIMER_END(stats, STATS_PHASE_MOVEMENT, movementTimer);
+
+    // 攻击目标按本步开始时的位置选择，范围规则与handleUnitAttack相同
+    EquipmentType* type = getEquipmentTypeById(units->typeId[index]);
+    if (type && units->ammo[index] > 0) {
+        STATS_COUNT(stats, attackCalls, 1);
+        STATS_TIMER_BEGIN(stats, targetingTimer);
+        intent->target = findTarget(battlefield, team, index, type->maxAttackRadius, stats);
+        STATS_TIMER_END(stats, STATS_PHASE_TARGETING, targetingTimer);
     }
+}
 
-    // 计算距离
-    int distance = calculateEquipmentDistance(equipment, target);
+// 意图阶段的并行任务：下标[0, 红方装备数)为红方，之后为蓝方
+// 收集统计时每个任务先记录到局部变量，最后一次合并到战场的统计中，线程之间不争抢同一组计数器
+static void planIntentRange(void* context, int begin, int end) {
+    Battlefield* battlefield = (Battlefield*)context;
+    BattleStats* stats = NULL;
+#ifdef BATTLE_STATS
+    BattleStats local;
+    if (battlefield->stats) {
+        resetBattleStats(&local);
+        stats = &local;
+    }
+#endif
 
-    // 检查是否可以攻击（在攻击范围内）
-    if (canAttack(equipment, target, distance)) {
-        // 获取交互数据
-        EquipmentInteraction* interaction = getInteraction(equipment->typeId, target->typeId);
-        if (!interaction) {
-            return;
+    // 下标i依次对应红方和蓝方存活列表中的装备
+    const UnitStore* red = &battlefield->redUnits;
+    const UnitStore* blue = &battlefield->blueUnits;
+    for (int i = begin; i < end; i++) {
+        if (i < red->activeCount) {
+            int index = red->active[i];
+            planUnitIntent(battlefield, TEAM_RED, index, &battlefield->intents->red[index], stats);
+        } else {
+            int index = blue->active[i - red->activeCount];
+            planUnitIntent(battlefield, TEAM_BLUE, index, &battlefield->intents->blue[index], stats);
         }
-        
-        // 减少弹药量（无论是否命中都消耗弹药）
-        equipment->currentAmmo--;
-        
-        // 根据命中率决定是否命中
-        int randomValue = rand() % 100;
-        int isHit = (randomValue < interaction->accuracy);
-        
-        // 绘制弹道（无论是否命中都显示弹道）
-        drawProjectilePath(battlefield, equipment, target, isHit);
-        
-        // 只有命中才计算伤害
-        if (isHit) {
-            // 计算伤害
-            int damage = calculateDamage(equipment, target);
-            if (damage > 0) {
-                // 减少目标生命值
-                target->currentHealth -= damage;
-
-                // 检查目标是否被摧毁
-                if (target->currentHealth <= 0) {
-                    target->currentHealth = 0;
-                    target->isActive = 0;
-                    
-                    // 从战场移除
-                    removeEquipmentFromBattlefield(battlefield, target);
+    }
+
+#ifdef BATTLE_STATS
+    if (stats) {
+        mergeBattleStats(battlefield->stats, stats);
+    }
+#endif
+}
+
+// 获取指定队伍的意图数组
+static UnitIntent* getTeamIntents(Battlefield* battlefield, Team team) {
+    return team == TEAM_RED ? battlefield->intents->red : battlefield->intents->blue;
+}
+
+// 结算移动：多个装备要进入同一个空格子时，原来所在格子编号（y*宽度+x）最小的装备进入，其余原地不动
+// 目标格子在本步开始时都是空的，因此移动之间没有先后依赖
+static void resolveMoves(Battlefield* battlefield) {
+    int* claims = battlefield->intents->claims;
+    int width = battlefield->width;
+    Team teams[2] = { TEAM_RED, TEAM_BLUE };
+
+    // 登记每个目标格子的申请，保留编号最小的申请者
+    for (int t = 0; t < 2; t++) {
+        UnitStore* units = getTeamUnits(battlefield, teams[t]);
+        UnitIntent* intents = getTeamIntents(battlefield, teams[t]);
+        for (int k = 0; k < units->activeCount; k++) {
+            int i = units->active[k];
+            if (intents[i].moves) {
+                int cell = intents[i].destY * width + intents[i].destX;
+                int source = units->y[i] * width + units->x[i] + 1;
+                if (claims[cell] == 0 || source < claims[cell]) {
+                    claims[cell] = source;
                 }
             }
         }
     }
+
+    // 按红方、蓝方的下标顺序更新方向并执行移动，同时清除申请
+    for (int t = 0; t < 2; t++) {
+        Team team = teams[t];
+        UnitStore* units = getTeamUnits(battlefield, team);
+        UnitIntent* intents = getTeamIntents(battlefield, team);
+        for (int k = 0; k < units->activeCount; k++) {
+            int i = units->active[k];
+            if (!units->alive[i]) {
+                continue;
+            }
+            const UnitIntent* intent = &intents[i];
+            int oldX = units->x[i];
+            int oldY = units->y[i];
+            int oldDirX = units->dirX[i];
+            int oldDirY = units->dirY[i];
+
+            units->dirX[i] = intent->dirX;
+            units->dirY[i] = intent->dirY;
+            if (intent->moves && claims[intent->destY * width + intent->destX] == oldY * width + oldX + 1) {
+                moveUnitOnBattlefield(battlefield, team, i, intent->destX, intent->destY);
+            } else {
+                STATS_COUNT(battlefield->stats, moveConflicts, intent->moves);
+            }
+
+            if (battlefield->eventLog && (units->x[i] != oldX || units->y[i] != oldY ||
+                                          units->dirX[i] != oldDirX || units->dirY[i] != oldDirY)) {
+                eventLogMove(battlefield->eventLog, team, i, units->x[i] - oldX, units->y[i] - oldY,
+                             units->dirX[i], units->dirY[i]);
+            }
+        }
+    }
+
+    for (int t = 0; t < 2; t++) {
+        UnitStore* units = getTeamUnits(battlefield, teams[t]);
+        UnitIntent* intents = getTeamIntents(battlefield, teams[t]);
+        for (int k = 0; k < units->activeCount; k++) {
+            int i = units->active[k];
+            if (intents[i].moves) {
+                claims[intents[i].destY * width + intents[i].destX] = 0;
+            }
+        }
+    }
 }
 
-// 检查是否有一方获胜
-int checkVictory(Battlefield* battlefield) {
-    int redActive = 0;
-    int blueActive = 0;
+// 结算攻击：按红方、蓝方的下标顺序开火（随机数按此顺序抽取），同时开火，本步被摧毁的装备仍然开火；
+// 全部开火之后再统一移除被摧毁的装备
+static void resolveAttacks(Battlefield* battlefield) {
+    Team teams[2] = { TEAM_RED, TEAM_BLUE };
 
-    // 统计双方活跃装备数量
-    for (int i = 0; i < battlefield->redCount; i++) {
-        if (battlefield->redEquipments[i]->isActive) {
-            redActive++;
+    for (int t = 0; t < 2; t++) {
+        Team team = teams[t];
+        UnitStore* units = getTeamUnits(battlefield, team);
+        UnitIntent* intents = getTeamIntents(battlefield, team);
+        UnitStore* enemies = getTeamUnits(battlefield, getEnemyTeam(team));
+        UnitIntent* enemyIntents = getTeamIntents(battlefield, getEnemyTeam(team));
+        for (int k = 0; k < units->activeCount; k++) {
+            int i = units->active[k];
+            int target = intents[i].target;
+            if (target >= 0 && fireAtTarget(battlefield, team, i, target) > 0 && enemies->health[target] <= 0) {
+                enemyIntents[target].destroyed = 1;
+            }
         }
     }
 
-    for (int i = 0; i < battlefield->blueCount; i++) {
-        if (battlefield->blueEquipments[i]->isActive) {
-            blueActive++;
+    for (int t = 0; t < 2; t++) {
+        Team team = teams[t];
+        UnitStore* units = getTeamUnits(battlefield, team);
+        UnitIntent* intents = getTeamIntents(battlefield, team);
+        for (int k = 0; k < units->activeCount; k++) {
+            int i = units->active[k];
+            if (intents[i].destroyed) {
+                removeUnitFromBattlefield(battlefield, team, i);
+                markUnitDestroyed(units, i);
+                STATS_COUNT(battlefield->stats, kills, 1);
+                if (battlefield->eventLog) {
+                    eventLogKill(battlefield->eventLog, team, i);
+                }
+            }
         }
     }
+}
 
-    // 判断胜负
-    if (redActive == 0 && blueActive > 0) {
-        printf("\n蓝方获胜！\n");
-        return 2; // 蓝方获胜
-    } else if (blueActive == 0 && redActive > 0) {
-        printf("\n红方获胜！\n");
-        return 1; // 红方获胜
-    } else if (redActive == 0 && blueActive == 0) {
-        printf("\n平局！\n");
-        return 3; // 平局
+// 两阶段模拟一步：意图阶段所有装备并行地按上一步的状态计算移动和攻击目标，
+// 结算阶段在调用者线程中按固定顺序执行，因此结果与线程数无关
+static void simulateTwoPhaseStep(Battlefield* battlefield) {
+    BattleStats* stats = battlefield->stats;
+    int total = battlefield->redUnits.activeCount + battlefield->blueUnits.activeCount;
+    STATS_TIMER_BEGIN(stats, intentTimer);
+    if (battlefield->threadPool) {
+        threadPoolRun(battlefield->threadPool, planIntentRange, battlefield, total, INTENT_CHUNK);
+    } else {
+        planIntentRange(battlefield, 0, total);
     }
+    STATS_TIMER_END(stats, STATS_PHASE_INTENT, intentTimer);
 
-    return 0; // 继续
+    STATS_TIMER_BEGIN(stats, resolveTimer);
+    resolveMoves(battlefield);
+    STATS_TIMER_BEGIN(stats, attackTimer);
+    resolveAttacks(battlefield);
+    STATS_TIMER_END(stats, STATS_PHASE_ATTACK, attackTimer);
+    STATS_TIMER_END(stats, STATS_PHASE_RESOLVE, resolveTimer);
 }
 
 // 模拟一步对抗
 int simulateStep(Battlefield* battlefield) {
-    // 处理红方装备
-    for (int i = 0; i < battlefield->redCount; i++) {
-        Equipment* equipment = battlefield->redEquipments[i];
-        if (equipment->isActive) {
-            handleMovement(battlefield, equipment);
-            handleAttack(battlefield, equipment);
-        }
+    STATS_COUNT(battlefield->stats, steps, 1);
+
+    // 先把上一步被摧毁的装备移出存活列表，之后的遍历只涉及存活的装备，顺序仍是下标顺序
+    compactActiveUnits(&battlefield->redUnits);
+    compactActiveUnits(&battlefield->blueUnits);
+
+    // 缓存分配失败时清空指针，本步不使用缓存
+    if (battlefield->targetCacheMode != TARGET_CACHE_OFF && !prepareTargetCache(battlefield)) {
+        battlefield->targetCache = NULL;
     }
 
-    // 处理蓝方装备
-    for (int i = 0; i < battlefield->blueCount; i++) {
-        Equipment* equipment = battlefield->blueEquipments[i];
-        if (equipment->isActive) {
-            handleMovement(battlefield, equipment);
-            handleAttack(battlefield, equipment);
+    // 两阶段模式的缓冲区分配失败时，本步按顺序模式处理
+    if (battlefield->tickMode == TICK_TWO_PHASE && prepareTickIntents(battlefield)) {
+        simulateTwoPhaseStep(battlefield);
+    } else {
+        // 处理红方装备（本步中被摧毁的装备仍在列表中，由alive标志跳过）
+        const UnitStore* red = &battlefield->redUnits;
+        for (int k = 0; k < red->activeCount; k++) {
+            int i = red->active[k];
+            if (red->alive[i]) {
+                handleUnitMovement(battlefield, TEAM_RED, i);
+                handleUnitAttack(battlefield, TEAM_RED, i);
+            }
+        }
+
+        // 处理蓝方装备
+        const UnitStore* blue = &battlefield->blueUnits;
+        for (int k = 0; k < blue->activeCount; k++) {
+            int i = blue->active[k];
+            if (blue->alive[i]) {
+                handleUnitMovement(battlefield, TEAM_BLUE, i);
+                handleUnitAttack(battlefield, TEAM_BLUE, i);
+            }
         }
     }
 
     // 检查胜负
-    return checkVictory(battlefield);
-} 
\ No newline at end of file
+    STATS_TIMER_BEGIN(battlefield->stats, victoryTimer);
+    int result = checkVictory(battlefield);
+    STATS_TIMER_END(battlefield->stats, STATS_PHASE_VICTORY, victoryTimer);
+    if (battlefield->eventLog) {
+        if (result) {
+            eventLogVictory(battlefield->eventLog, result);
+        }
+        eventLogEndTick(battlefield->eventLog, battlefield);
+    }
+    return result;
+}
@@ -3,7 +3,12 @@
 
 #include "battlefield.h"
 
-// 模拟一步对抗
+// 模拟一步对抗，处理方式由battlefield->tickMode决定：
+//   TICK_SEQUENTIAL  先红方后蓝方，每个装备依次移动并攻击，后行动的装备能看到先行动的装备的结果
+//   TICK_TWO_PHASE   意图阶段每个装备只读取上一步结束时的状态，计算移动和攻击目标
+//                    （设置了battlefield->threadPool时在线程池上并行）；结算阶段先执行移动
+//                    （争抢同一格子时原来所在格子编号最小的装备进入），再按红方、蓝方的下标顺序同时开火，
+//                    最后移除被摧毁的装备。双方没有先手优势，结果与线程数无关
 // 返回值：0表示继续，1表示游戏结束
 int simulateStep(Battlefield* battlefield);
 
@@ -13,14 +18,35 @@ void handleMovement(Battlefield* battlefield, Equipment* equipment);
 // 处理装备攻击
 void handleAttack(Battlefield* battlefield, Equipment* equipment);
 
-// 检查是否有一方获胜
-// 返回值：0表示没有，1表示红方获胜，2表示蓝方获胜
+// 检查是否有一方获胜（只比较双方的存活装备数，耗时与装备数无关，不输出任何信息）
+// 返回值：0表示没有，1表示红方获胜，2表示蓝方获胜，3表示平局（双方同时全部被摧毁）
 int checkVictory(Battlefield* battlefield);
 
+// 获取checkVictory返回值对应的说明文字（如"红方获胜！"），由调用者在战斗结束时显示
+const char* getVictoryMessage(int result);
+
+// 获取校验模式（TARGET_CACHE_VERIFY）中攻击目标缓存的结果与完整查找不同的次数，正常情况下始终为0
+long long getTargetCacheMismatches(const Battlefield* battlefield);
+
 // 查找最近的敌方装备
 Equipment* findNearestEnemy(Battlefield* battlefield, Equipment* equipment);
 
-// 计算两个装备之间的距离
+// 计算两个装备之间的距离（向下取整）
 int calculateEquipmentDistance(Equipment* e1, Equipment* e2);
 
+// 计算两个装备之间的平方距离
+int calculateEquipmentSquaredDistance(Equipment* e1, Equipment* e2);
+
+// 以下为按单元下标操作的版本，直接读写单元存储中的结构数组，供模拟循环使用；
+// 上面以Equipment*为参数的版本是对它们的封装，并在调用后刷新相关的Equipment视图
+
+// 处理指定队伍中下标为index的装备的移动
+void handleUnitMovement(Battlefield* battlefield, Team team, int index);
+
+// 处理指定队伍中下标为index的装备的攻击，返回攻击目标的下标，未攻击时返回-1
+int handleUnitAttack(Battlefield* battlefield, Team team, int index);
+
+// 查找指定队伍中下标为index的装备最近的敌方装备，返回其在敌方单元存储中的下标，没有时返回-1
+int findNearestEnemyIndex(Battlefield* battlefield, Team team, int index);
+
 #endif // SIMULATION_H 
\ No newline at end of file
@@ -0,0 +1,150 @@
+#include "snapshot.h"
+#include <stdlib.h>
+#include <string.h>
+
+// 单元存储中需要保存的字节数
+static size_t getUnitStoreSize(int count) {
+    return (size_t)count * (4 * sizeof(int) + 2 * sizeof(signed char) + sizeof(int) +
+                            sizeof(unsigned char) + sizeof(Equipment));
+}
+
+// 位图的字节数
+static size_t getBitboardSize(const Bitboard* board) {
+    return (size_t)board->wordsPerRow * board->height * sizeof(uint64_t);
+}
+
+// 快照数组部分的总字节数
+static size_t getSnapshotDataSize(Battlefield* battlefield) {
+    return (size_t)battlefield->width * battlefield->height * sizeof(Cell) +
+           getUnitStoreSize(battlefield->redUnits.count) +
+           getUnitStoreSize(battlefield->blueUnits.count) +
+           4 * getBitboardSize(&battlefield->fenceOccupancy);
+}
+
+// 保存单元存储的前count个单元，返回写入后的位置
+static unsigned char* saveUnitStore(unsigned char* p, const UnitStore* units) {
+    int n = units->count;
+    memcpy(p, units->x, n * sizeof(int)); p += n * sizeof(int);
+    memcpy(p, units->y, n * sizeof(int)); p += n * sizeof(int);
+    memcpy(p, units->health, n * sizeof(int)); p += n * sizeof(int);
+    memcpy(p, units->ammo, n * sizeof(int)); p += n * sizeof(int);
+    memcpy(p, units->typeId, n * sizeof(int)); p += n * sizeof(int);
+    memcpy(p, units->dirX, n); p += n;
+    memcpy(p, units->dirY, n); p += n;
+    memcpy(p, units->alive, n); p += n;
+    memcpy(p, units->views, n * sizeof(Equipment)); p += n * sizeof(Equipment);
+    return p;
+}
+
+// 恢复单元存储的前count个单元，返回读取后的位置
+static const unsigned char* loadUnitStore(const unsigned char* p, UnitStore* units, int count) {
+    int n = count;
+    units->count = n;
+    memcpy(units->x, p, n * sizeof(int)); p += n * sizeof(int);
+    memcpy(units->y, p, n * sizeof(int)); p += n * sizeof(int);
+    memcpy(units->health, p, n * sizeof(int)); p += n * sizeof(int);
+    memcpy(units->ammo, p, n * sizeof(int)); p += n * sizeof(int);
+    memcpy(units->typeId, p, n * sizeof(int)); p += n * sizeof(int);
+    memcpy(units->dirX, p, n); p += n;
+    memcpy(units->dirY, p, n); p += n;
+    memcpy(units->alive, p, n); p += n;
+    memcpy(units->views, p, n * sizeof(Equipment)); p += n * sizeof(Equipment);
+    rebuildActiveUnits(units);
+    return p;
+}
+
+// 按存活单元重建一方的空间索引（按下标顺序插入），内存分配失败时返回0
+static int rebuildSpatialIndex(SpatialGrid* grid, const UnitStore* units) {
+    spatialClear(grid);
+    for (int i = 0; i < units->count; i++) {
+        if (units->alive[i] && !spatialInsert(grid, i, units->x[i], units->y[i])) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+// 初始化一个空快照
+void initBattlefieldSnapshot(BattlefieldSnapshot* snapshot) {
+    memset(snapshot, 0, sizeof(*snapshot));
+}
+
+// 释放快照的内存
+void freeBattlefieldSnapshot(BattlefieldSnapshot* snapshot) {
+    free(snapshot->data);
+    memset(snapshot, 0, sizeof(*snapshot));
+}
+
+// 保存战场的当前状态
+int snapshotBattlefield(Battlefield* battlefield, BattlefieldSnapshot* snapshot) {
+    size_t size = getSnapshotDataSize(battlefield);
+    if (size > snapshot->capacity) {
+        unsigned char* data = (unsigned char*)realloc(snapshot->data, size);
+        if (!data) {
+            return 0;
+        }
+        snapshot->data = data;
+        snapshot->capacity = size;
+    }
+
+    snapshot->width = battlefield->width;
+    snapshot->height = battlefield->height;
+    snapshot->redCount = battlefield->redUnits.count;
+    snapshot->blueCount = battlefield->blueUnits.count;
+    snapshot->redBudget = battlefield->redBudget;
+    snapshot->blueBudget = battlefield->blueBudget;
+    snapshot->redRemainingBudget = battlefield->redRemainingBudget;
+    snapshot->blueRemainingBudget = battlefield->blueRemainingBudget;
+    snapshot->redHQUnit = battlefield->redHQUnit;
+    snapshot->blueHQUnit = battlefield->blueHQUnit;
+    snapshot->nextEquipmentId = getNextEquipmentId();
+    snapshot->rng = battlefield->rng;
+    snapshot->size = size;
+
+    // 数组部分依次为：格子、红方单元、蓝方单元、四张占用位图
+    unsigned char* p = snapshot->data;
+    size_t cellBytes = (size_t)battlefield->width * battlefield->height * sizeof(Cell);
+    size_t boardBytes = getBitboardSize(&battlefield->fenceOccupancy);
+    memcpy(p, battlefield->cells, cellBytes); p += cellBytes;
+    p = saveUnitStore(p, &battlefield->redUnits);
+    p = saveUnitStore(p, &battlefield->blueUnits);
+    memcpy(p, battlefield->redOccupancy.words, boardBytes); p += boardBytes;
+    memcpy(p, battlefield->blueOccupancy.words, boardBytes); p += boardBytes;
+    memcpy(p, battlefield->fenceOccupancy.words, boardBytes); p += boardBytes;
+    memcpy(p, battlefield->flyerOccupancy.words, boardBytes);
+    return 1;
+}
+
+// 把战场恢复到快照时的状态
+int restoreBattlefield(Battlefield* battlefield, const BattlefieldSnapshot* snapshot) {
+    if (!snapshot->data || battlefield->width != snapshot->width || battlefield->height != snapshot->height ||
+        !reserveUnits(&battlefield->redUnits, snapshot->redCount) ||
+        !reserveUnits(&battlefield->blueUnits, snapshot->blueCount)) {
+        return 0;
+    }
+
+    battlefield->redBudget = snapshot->redBudget;
+    battlefield->blueBudget = snapshot->blueBudget;
+    battlefield->redRemainingBudget = snapshot->redRemainingBudget;
+    battlefield->blueRemainingBudget = snapshot->blueRemainingBudget;
+    battlefield->redHQUnit = snapshot->redHQUnit;
+    battlefield->blueHQUnit = snapshot->blueHQUnit;
+    battlefield->rng = snapshot->rng;
+    setNextEquipmentId(snapshot->nextEquipmentId);
+
+    const unsigned char* p = snapshot->data;
+    size_t cellBytes = (size_t)battlefield->width * battlefield->height * sizeof(Cell);
+    size_t boardBytes = getBitboardSize(&battlefield->fenceOccupancy);
+    memcpy(battlefield->cells, p, cellBytes); p += cellBytes;
+    invalidateCellEpochs(battlefield); // 格子整体替换，之前缓存的攻击目标都要重新查找
+    p = loadUnitStore(p, &battlefield->redUnits, snapshot->redCount);
+    p = loadUnitStore(p, &battlefield->blueUnits, snapshot->blueCount);
+    memcpy(battlefield->redOccupancy.words, p, boardBytes); p += boardBytes;
+    memcpy(battlefield->blueOccupancy.words, p, boardBytes); p += boardBytes;
+    memcpy(battlefield->fenceOccupancy.words, p, boardBytes); p += boardBytes;
+    memcpy(battlefield->flyerOccupancy.words, p, boardBytes);
+
+    // 空间索引查找时距离相同取下标最小的装备，与桶内顺序无关，重建后查找结果不变
+    return rebuildSpatialIndex(&battlefield->redIndex, &battlefield->redUnits) &&
+           rebuildSpatialIndex(&battlefield->blueIndex, &battlefield->blueUnits);
+}
@@ -0,0 +1,40 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <stddef.h>
+#include "battlefield.h"
+
+// 战场快照
+// 保存某一步结束时战场的完整状态：格子、双方单元存储、占用位图、预算、大本营下标、
+// 装备ID计数器和随机数发生器状态。战场中的装备都按下标引用，没有需要重新映射的指针，
+// 因此数组部分按固定顺序逐段memcpy到一块连续内存中；空间索引可以由存活单元重建，不保存
+// 从同一个快照恢复后继续模拟，结果与从快照那一步直接继续模拟完全相同，
+// 一段共同的前缀只需模拟一次，就可以分出多个分支
+typedef struct {
+    int width, height;
+    int redCount, blueCount;        // 双方单元数
+    int redBudget, blueBudget;
+    int redRemainingBudget, blueRemainingBudget;
+    int redHQUnit, blueHQUnit;
+    int nextEquipmentId;            // 装备ID计数器
+    Rng rng;                        // 随机数发生器状态
+    unsigned char* data;            // 数组部分（格子、单元存储、占用位图）
+    size_t size;
+    size_t capacity;
+} BattlefieldSnapshot;
+
+// 初始化一个空快照
+void initBattlefieldSnapshot(BattlefieldSnapshot* snapshot);
+
+// 释放快照的内存
+void freeBattlefieldSnapshot(BattlefieldSnapshot* snapshot);
+
+// 保存战场的当前状态（快照的内存可重复使用，只在不够时扩大），成功返回1，内存分配失败返回0
+int snapshotBattlefield(Battlefield* battlefield, BattlefieldSnapshot* snapshot);
+
+// 把战场恢复到快照时的状态（单元存储容量不够时自动扩大），战场尺寸不同或内存分配失败时返回0
+// 重建空间索引时内存分配失败的战场只恢复了一部分，调用者应重新初始化后再使用
+// 渲染器、事件记录和无界面模式等设置保持不变
+int restoreBattlefield(Battlefield* battlefield, const BattlefieldSnapshot* snapshot);
+
+#endif // SNAPSHOT_H
@@ -0,0 +1,302 @@
+#include "spatial.h"
+#include <limits.h>
+#include "distance.h"
+
+// 最近装备搜索的中间状态
+typedef struct {
+    int x, y;               // 搜索中心
+    int best;               // 当前最近装备的下标，无结果时为-1
+    int bestKey;            // 当前最近距离键值，无结果时为距离上限的键值
+    int visited;            // 已检查的装备数量
+    SpatialVisibility visibility;   // 可见性检查，NULL表示不检查
+    void* context;
+} NearestSearch;
+
+// 获取坐标所在的桶
+static SpatialBucket* getBucket(const SpatialGrid* grid, int x, int y) {
+    return &grid->buckets[(y / SPATIAL_BUCKET_SIZE) * grid->bucketsX + x / SPATIAL_BUCKET_SIZE];
+}
+
+// 初始化空间索引
+int initSpatialGrid(SpatialGrid* grid, int width, int height, Arena* arena) {
+    grid->bucketsX = (width + SPATIAL_BUCKET_SIZE - 1) / SPATIAL_BUCKET_SIZE;
+    grid->bucketsY = (height + SPATIAL_BUCKET_SIZE - 1) / SPATIAL_BUCKET_SIZE;
+    grid->buckets = (SpatialBucket*)arenaCalloc(arena, (size_t)grid->bucketsX * grid->bucketsY, sizeof(SpatialBucket));
+    grid->unitCount = 0;
+    grid->arena = arena;
+    return grid->buckets != NULL;
+}
+
+// 保证桶内至少还能追加一个装备，内存分配失败时返回0（桶保持不变）
+static int bucketReserve(SpatialGrid* grid, SpatialBucket* bucket) {
+    if (bucket->count < bucket->capacity) {
+        return 1;
+    }
+    int newCapacity = bucket->capacity > 0 ? bucket->capacity * 2 : 4;
+    size_t oldSize = bucket->capacity * sizeof(int);
+    size_t newSize = newCapacity * sizeof(int);
+    int* entries = (int*)arenaGrow(grid->arena, bucket->entries, oldSize, newSize);
+    int* xs = (int*)arenaGrow(grid->arena, bucket->xs, oldSize, newSize);
+    int* ys = (int*)arenaGrow(grid->arena, bucket->ys, oldSize, newSize);
+    if (!entries || !xs || !ys) {
+        return 0;
+    }
+    bucket->entries = entries;
+    bucket->xs = xs;
+    bucket->ys = ys;
+    bucket->capacity = newCapacity;
+    return 1;
+}
+
+// 向桶中追加一个装备，内存分配失败时返回0
+static int bucketAppend(SpatialGrid* grid, SpatialBucket* bucket, int index, int x, int y) {
+    if (!bucketReserve(grid, bucket)) {
+        return 0;
+    }
+    bucket->entries[bucket->count] = index;
+    bucket->xs[bucket->count] = x;
+    bucket->ys[bucket->count] = y;
+    bucket->count++;
+    return 1;
+}
+
+// 查找装备在桶中的位置，不存在时返回-1
+static int bucketFind(const SpatialBucket* bucket, int index) {
+    for (int i = 0; i < bucket->count; i++) {
+        if (bucket->entries[i] == index) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+// 从桶中删除一个装备（与末尾元素交换），成功返回1，不存在时返回0
+static int bucketRemove(SpatialBucket* bucket, int index) {
+    int position = bucketFind(bucket, index);
+    if (position < 0) {
+        return 0;
+    }
+
+    int last = --bucket->count;
+    bucket->entries[position] = bucket->entries[last];
+    bucket->xs[position] = bucket->xs[last];
+    bucket->ys[position] = bucket->ys[last];
+    return 1;
+}
+
+// 清空索引
+void spatialClear(SpatialGrid* grid) {
+    int bucketCount = grid->bucketsX * grid->bucketsY;
+    for (int i = 0; i < bucketCount; i++) {
+        grid->buckets[i].count = 0;
+    }
+    grid->unitCount = 0;
+}
+
+// 将装备加入索引
+int spatialInsert(SpatialGrid* grid, int index, int x, int y) {
+    if (!bucketAppend(grid, getBucket(grid, x, y), index, x, y)) {
+        return 0;
+    }
+    grid->unitCount++;
+    return 1;
+}
+
+// 将装备从索引中移除
+void spatialRemove(SpatialGrid* grid, int index, int x, int y) {
+    if (bucketRemove(getBucket(grid, x, y), index)) {
+        grid->unitCount--;
+    }
+}
+
+// 装备移动后更新索引
+int spatialMove(SpatialGrid* grid, int index, int oldX, int oldY, int newX, int newY) {
+    SpatialBucket* oldBucket = getBucket(grid, oldX, oldY);
+    SpatialBucket* newBucket = getBucket(grid, newX, newY);
+    if (oldBucket == newBucket) {
+        // 仍在同一个桶内，只更新坐标副本
+        int position = bucketFind(oldBucket, index);
+        if (position >= 0) {
+            oldBucket->xs[position] = newX;
+            oldBucket->ys[position] = newY;
+        }
+        return 1;
+    }
+
+    // 先保证新桶有空间，再从原来的桶中移除，追加时不会再失败
+    if (!bucketReserve(grid, newBucket)) {
+        return 0;
+    }
+    if (bucketRemove(oldBucket, index)) {
+        bucketAppend(grid, newBucket, index, newX, newY);
+    }
+    return 1;
+}
+
+// 距离键值为key、下标为index的装备是否比当前结果更近
+static int isCloser(const NearestSearch* search, int key, int index) {
+    return key < search->bestKey || (key == search->bestKey && search->best >= 0 && index < search->best);
+}
+
+// 检查一个桶内的所有装备，只考虑通过可见性检查的装备
+// 先挑出比当前结果更近的候选装备，再成批做可见性检查
+static void scanBucketVisible(const SpatialGrid* grid, int bx, int by, NearestSearch* search) {
+    const SpatialBucket* bucket = &grid->buckets[by * grid->bucketsX + bx];
+    if (bucket->count == 0) {
+        return;
+    }
+    search->visited += bucket->count;
+
+    int minSquared;
+    findNearestPoint(bucket->xs, bucket->ys, bucket->count, search->x, search->y, &minSquared);
+    int minKey = distanceKey(minSquared);
+    if (minKey > search->bestKey || (minKey == search->bestKey && search->best < 0)) {
+        return;
+    }
+
+    int entries[SPATIAL_VISIBILITY_BATCH];
+    int xs[SPATIAL_VISIBILITY_BATCH];
+    int ys[SPATIAL_VISIBILITY_BATCH];
+    int keys[SPATIAL_VISIBILITY_BATCH];
+    unsigned char visible[SPATIAL_VISIBILITY_BATCH];
+    for (int start = 0; start < bucket->count; start += SPATIAL_VISIBILITY_BATCH) {
+        int end = start + SPATIAL_VISIBILITY_BATCH < bucket->count ? start + SPATIAL_VISIBILITY_BATCH : bucket->count;
+        int count = 0;
+        for (int i = start; i < end; i++) {
+            int key = distanceKey(squaredDistance(search->x, search->y, bucket->xs[i], bucket->ys[i]));
+            if (isCloser(search, key, bucket->entries[i])) {
+                entries[count] = bucket->entries[i];
+                xs[count] = bucket->xs[i];
+                ys[count] = bucket->ys[i];
+                keys[count] = key;
+                count++;
+            }
+        }
+        if (count == 0) {
+            continue;
+        }
+
+        search->visibility(search->context, entries, xs, ys, count, visible);
+        for (int i = 0; i < count; i++) {
+            if (visible[i] && isCloser(search, keys[i], entries[i])) {
+                search->best = entries[i];
+                search->bestKey = keys[i];
+            }
+        }
+    }
+}
+
+// 检查一个桶内的所有装备
+static void scanBucket(const SpatialGrid* grid, int bx, int by, NearestSearch* search) {
+    if (search->visibility) {
+        scanBucketVisible(grid, bx, by, search);
+        return;
+    }
+
+    const SpatialBucket* bucket = &grid->buckets[by * grid->bucketsX + bx];
+    if (bucket->count == 0) {
+        return;
+    }
+    search->visited += bucket->count;
+
+    // 批量计算桶内的最小平方距离
+    int minSquared;
+    findNearestPoint(bucket->xs, bucket->ys, bucket->count, search->x, search->y, &minSquared);
+    int key = distanceKey(minSquared);
+    if (key > search->bestKey || (key == search->bestKey && search->best < 0)) {
+        return;
+    }
+
+    // 桶内可能有多个装备的距离键值与最小值相同，按数组顺序取下标最小的装备
+    int candidate = (key == search->bestKey) ? search->best : -1;
+    int maxSquared = maxSquaredForKey(key);
+    for (int i = 0; i < bucket->count; i++) {
+        int index = bucket->entries[i];
+        if ((candidate < 0 || index < candidate) &&
+            squaredDistance(search->x, search->y, bucket->xs[i], bucket->ys[i]) <= maxSquared) {
+            candidate = index;
+        }
+    }
+    search->best = candidate;
+    search->bestKey = key;
+}
+
+// 查找距离(x, y)最近的装备
+int spatialFindNearest(const SpatialGrid* grid, int x, int y, int limitSquared) {
+    int visited;
+    return spatialFindNearestCounted(grid, x, y, limitSquared, &visited);
+}
+
+// 查找距离(x, y)最近的装备，并返回检查过的装备数
+int spatialFindNearestCounted(const SpatialGrid* grid, int x, int y, int limitSquared, int* visited) {
+    return spatialFindNearestVisible(grid, x, y, limitSquared, NULL, NULL, visited);
+}
+
+// 查找距离(x, y)最近的可见装备，visibility为NULL时不检查可见性
+int spatialFindNearestVisible(const SpatialGrid* grid, int x, int y, int limitSquared,
+                              SpatialVisibility visibility, void* context, int* visited) {
+    *visited = 0;
+    if (grid->unitCount == 0 || limitSquared <= 0) {
+        return -1;
+    }
+
+    NearestSearch search;
+    search.x = x;
+    search.y = y;
+    search.best = -1;
+    search.bestKey = distanceKey(limitSquared);
+    search.visited = 0;
+    search.visibility = visibility;
+    search.context = context;
+
+    int centerX = x / SPATIAL_BUCKET_SIZE;
+    int centerY = y / SPATIAL_BUCKET_SIZE;
+    int maxRing = grid->bucketsX > grid->bucketsY ? grid->bucketsX : grid->bucketsY;
+
+    for (int ring = 0; ring <= maxRing && search.visited < grid->unitCount; ring++) {
+        if (ring > 0) {
+            // 第ring圈的桶与中心格子的横向或纵向间隔至少为(ring-1)*桶边长+1，
+            // 平方距离不会小于该间隔的平方
+            long long gap = (long long)(ring - 1) * SPATIAL_BUCKET_SIZE + 1;
+            int minKey = distanceKey(gap * gap > INT_MAX ? INT_MAX : (int)(gap * gap));
+            if (minKey > search.bestKey ||
+                (minKey == search.bestKey && search.best < 0)) {
+                break;
+            }
+        }
+
+        int left = centerX - ring;
+        int right = centerX + ring;
+        int top = centerY - ring;
+        int bottom = centerY + ring;
+
+        // 上下两行
+        for (int bx = left; bx <= right; bx++) {
+            if (bx < 0 || bx >= grid->bucketsX) {
+                continue;
+            }
+            if (top >= 0) {
+                scanBucket(grid, bx, top, &search);
+            }
+            if (ring > 0 && bottom < grid->bucketsY) {
+                scanBucket(grid, bx, bottom, &search);
+            }
+        }
+
+        // 左右两列（不含角上的桶）
+        for (int by = top + 1; by <= bottom - 1; by++) {
+            if (by < 0 || by >= grid->bucketsY) {
+                continue;
+            }
+            if (left >= 0) {
+                scanBucket(grid, left, by, &search);
+            }
+            if (right < grid->bucketsX) {
+                scanBucket(grid, right, by, &search);
+            }
+        }
+    }
+
+    *visited = search.visited;
+    return search.best;
+}
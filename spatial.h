@@ -0,0 +1,73 @@
+#ifndef SPATIAL_H
+#define SPATIAL_H
+
+#include "arena.h"
+
+// 空间索引的桶边长（格子数）
+#define SPATIAL_BUCKET_SIZE 8
+
+// 空间索引桶：覆盖 SPATIAL_BUCKET_SIZE x SPATIAL_BUCKET_SIZE 个格子
+// 桶内记录的是装备在本方单元存储中的下标，以及装备坐标的副本（结构数组），
+// 最近装备查找时按块批量计算平方距离
+typedef struct {
+    int* entries;
+    int* xs;
+    int* ys;
+    int count;
+    int capacity;
+} SpatialBucket;
+
+// 单个队伍的均匀网格空间索引
+// 只包含活跃装备，随装备的部署、移动和摧毁增量更新
+typedef struct {
+    int bucketsX;           // 横向桶数量
+    int bucketsY;           // 纵向桶数量
+    SpatialBucket* buckets; // 桶数组（按行存储）
+    int unitCount;          // 索引中的装备总数
+    Arena* arena;           // 桶数组所在的内存池
+} SpatialGrid;
+
+// 初始化空间索引，所有内存从内存池中分配，随内存池一起释放
+// 成功返回1，内存分配失败返回0
+int initSpatialGrid(SpatialGrid* grid, int width, int height, Arena* arena);
+
+// 清空索引（保留桶的容量，之后重新插入装备时不再分配内存）
+void spatialClear(SpatialGrid* grid);
+
+// 将下标为index、位于(x, y)的装备加入索引，成功返回1，内存分配失败返回0（索引保持不变）
+int spatialInsert(SpatialGrid* grid, int index, int x, int y);
+
+// 将下标为index、位于(x, y)的装备从索引中移除
+void spatialRemove(SpatialGrid* grid, int index, int x, int y);
+
+// 装备从(oldX, oldY)移动到(newX, newY)后更新索引，成功返回1，内存分配失败返回0（装备仍在原来的位置）
+int spatialMove(SpatialGrid* grid, int index, int oldX, int oldY, int newX, int newY);
+
+// (x, y)所在的桶内的装备数（调用者需保证位置有效），可用于估计附近装备的密度
+static inline int spatialCountBucket(const SpatialGrid* grid, int x, int y) {
+    return grid->buckets[(y / SPATIAL_BUCKET_SIZE) * grid->bucketsX + x / SPATIAL_BUCKET_SIZE].count;
+}
+
+// 查找距离(x, y)最近的装备，返回其下标，没有时返回-1
+// 距离按当前距离计算规则(g_distanceMode)比较，只返回距离键值严格小于limitSquared对应键值的装备；
+// 距离键值相同时返回下标最小的装备
+// 由内向外逐圈搜索桶，一旦剩余的桶不可能更近就提前结束
+int spatialFindNearest(const SpatialGrid* grid, int x, int y, int limitSquared);
+
+// 与spatialFindNearest相同，visited返回搜索过程中检查过的装备数（用于统计）
+int spatialFindNearestCounted(const SpatialGrid* grid, int x, int y, int limitSquared, int* visited);
+
+// 可见性检查每次最多检查的装备数
+#define SPATIAL_VISIBILITY_BATCH 64
+
+// 可见性检查：对count个候选装备（下标为entries[i]，位于(xs[i], ys[i])）逐个判断能否选为结果，
+// 结果写入visible[i]（1表示可以）；context为调用者传给spatialFindNearestVisible的数据
+typedef void (*SpatialVisibility)(void* context, const int* entries, const int* xs, const int* ys, int count,
+                                  unsigned char* visible);
+
+// 与spatialFindNearestCounted相同，但只返回通过可见性检查的装备
+// 候选装备按桶分批检查，只有比当前结果更近（或同样近而下标更小）的装备才需要检查
+int spatialFindNearestVisible(const SpatialGrid* grid, int x, int y, int limitSquared,
+                              SpatialVisibility visibility, void* context, int* visited);
+
+#endif // SPATIAL_H
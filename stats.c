@@ -0,0 +1,55 @@
+#include "stats.h"
+#include <string.h>
+
+// 各阶段在JSON中的名称
+static const char* const g_phaseNames[STATS_PHASE_COUNT] = {
+    "movement", "targeting", "attack", "los", "intent", "resolve", "victory", "render"
+};
+
+// 清零统计
+void resetBattleStats(BattleStats* stats) {
+    memset(stats, 0, sizeof(BattleStats));
+}
+
+// 累加统计（原子加法，可以由多个线程同时对同一个total调用）
+void mergeBattleStats(BattleStats* total, const BattleStats* part) {
+    // BattleStats全部由long long组成，按数组逐项累加
+    long long* target = (long long*)total;
+    const long long* source = (const long long*)part;
+    for (size_t i = 0; i < sizeof(BattleStats) / sizeof(long long); i++) {
+        if (source[i]) {
+            __atomic_fetch_add(&target[i], source[i], __ATOMIC_RELAXED);
+        }
+    }
+}
+
+// 以一行JSON写出统计
+void writeBattleStatsJson(FILE* file, const BattleStats* stats, int battle, int tick, int final) {
+    char line[1024];
+    size_t used = 0;
+
+    if (battle >= 0) {
+        used += snprintf(line + used, sizeof(line) - used, "{\"battle\":%d,", battle);
+    } else {
+        used += snprintf(line + used, sizeof(line) - used, "{");
+    }
+    used += snprintf(line + used, sizeof(line) - used,
+                     "\"tick\":%d,\"final\":%s,\"steps\":%lld,"
+                     "\"calls\":{\"movement\":%lld,\"attack\":%lld,\"find_nearest_enemy\":%lld,\"render\":%lld},"
+                     "\"candidates_examined\":%lld,\"shots_fired\":%lld,\"shots_hit\":%lld,\"kills\":%lld,"
+                     "\"collisions\":%lld,\"move_conflicts\":%lld,\"los_checks\":%lld,"
+                     "\"target_cache\":{\"hits\":%lld,\"bounded\":%lld},\"phase_ns\":{",
+                     tick, final ? "true" : "false", stats->steps,
+                     stats->movementCalls, stats->attackCalls, stats->nearestCalls, stats->renderCalls,
+                     stats->candidatesExamined, stats->shotsFired, stats->shotsHit, stats->kills,
+                     stats->collisions, stats->moveConflicts, stats->losChecks,
+                     stats->targetCacheHits, stats->targetCacheBounded);
+    for (int i = 0; i < STATS_PHASE_COUNT && used < sizeof(line); i++) {
+        used += snprintf(line + used, sizeof(line) - used, "%s\"%s\":%lld", i > 0 ? "," : "",
+                         g_phaseNames[i], stats->phaseNanoseconds[i]);
+    }
+    if (used < sizeof(line)) {
+        snprintf(line + used, sizeof(line) - used, "}}\n");
+    }
+    fputs(line, file);
+}
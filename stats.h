@@ -0,0 +1,84 @@
+#ifndef STATS_H
+#define STATS_H
+
+#include <stdio.h>
+
+// 热点路径统计
+// 统计一场战斗中各热点函数的调用次数、最近敌方装备查找检查过的候选装备数、开火和命中次数、
+// 移动碰撞次数，以及各阶段的纳秒计时，用于判断慢的战斗时间花在了哪里。
+// 只有编译时定义了BATTLE_STATS（make STATS=1）才收集，否则下面的宏都展开为空操作，热点路径上没有任何额外代码；
+// 收集时由调用者把battlefield->stats指向一个BattleStats（NULL表示不收集）
+
+// 计时的阶段（可以嵌套：两阶段模式的意图和结算阶段包含其中的移动、目标搜索和攻击时间）
+typedef enum {
+    STATS_PHASE_MOVEMENT,       // 装备移动（包括计算移动）
+    STATS_PHASE_TARGETING,      // 查找攻击范围内最近的敌方装备
+    STATS_PHASE_ATTACK,         // 开火和移除被摧毁的装备
+    STATS_PHASE_LOS,            // 路径障碍（通视）检查
+    STATS_PHASE_INTENT,         // 两阶段模式的意图阶段（墙钟时间）
+    STATS_PHASE_RESOLVE,        // 两阶段模式的结算阶段
+    STATS_PHASE_VICTORY,        // 胜负检查
+    STATS_PHASE_RENDER,         // 绘制战场画面
+    STATS_PHASE_COUNT
+} StatsPhase;
+
+// 一场战斗的统计（意图阶段并行时，移动和目标搜索的计时是各线程时间之和）
+typedef struct {
+    long long steps;                // simulateStep调用次数
+    long long movementCalls;        // 装备移动次数（handleMovement和两阶段模式的移动计算）
+    long long attackCalls;          // 装备攻击次数（handleAttack和两阶段模式的目标选择）
+    long long nearestCalls;         // 最近敌方装备查找次数
+    long long renderCalls;          // 绘制战场画面的次数
+    long long candidatesExamined;   // 最近敌方装备查找中检查过的候选装备数（装备对数）
+    long long shotsFired;           // 开火次数
+    long long shotsHit;             // 命中次数
+    long long kills;                // 摧毁的装备数
+    long long collisions;           // 移动时碰到边界或其他装备的次数
+    long long moveConflicts;        // 两阶段模式中因争抢同一格子而没有移动的次数
+    long long losChecks;            // 路径障碍检查次数
+    long long targetCacheHits;      // 攻击目标缓存直接命中（射击方没有移动、附近没有变化）的次数
+    long long targetCacheBounded;   // 缓存的目标仍然有效、只在它的距离内重新查找的次数
+    long long phaseNanoseconds[STATS_PHASE_COUNT];
+} BattleStats;
+
+#ifdef BATTLE_STATS
+
+#include <time.h>
+
+#define BATTLE_STATS_ENABLED 1
+
+// 获取当前时间（纳秒）
+static inline long long statsNow(void) {
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+// 计数器field加n
+#define STATS_COUNT(stats, field, n) do { if (stats) { (stats)->field += (n); } } while (0)
+// 开始计时，timer为保存开始时间的局部变量名
+#define STATS_TIMER_BEGIN(stats, timer) long long timer = (stats) ? statsNow() : 0
+// 结束计时，把经过的时间计入阶段phase
+#define STATS_TIMER_END(stats, phase, timer) \
+    do { if (stats) { (stats)->phaseNanoseconds[phase] += statsNow() - (timer); } } while (0)
+
+#else
+
+#define BATTLE_STATS_ENABLED 0
+#define STATS_COUNT(stats, field, n) ((void)(stats))
+#define STATS_TIMER_BEGIN(stats, timer) ((void)(stats))
+#define STATS_TIMER_END(stats, phase, timer) ((void)(stats))
+
+#endif // BATTLE_STATS
+
+// 清零统计
+void resetBattleStats(BattleStats* stats);
+
+// 把part累加到total中；total可能被多个线程同时累加（意图阶段每个线程先统计到局部变量，最后合并）
+void mergeBattleStats(BattleStats* total, const BattleStats* part);
+
+// 把统计以一行JSON对象写入file：battle为战斗编号（<0表示不写），tick为当前步数，final表示战斗是否已结束
+// 整行一次写出，多个线程写同一个文件时各行不会交错
+void writeBattleStatsJson(FILE* file, const BattleStats* stats, int battle, int tick, int final);
+
+#endif // STATS_H
@@ -0,0 +1,122 @@
+#include "stencil.h"
+#include <stdlib.h>
+#include "equipment.h"
+
+// 装备目录中各半径的模板，按距离规则和半径索引，count为0表示没有建立
+static RangeStencil g_rangeStencils[2][RANGE_STENCIL_MAX_RADIUS + 1];
+
+// 排序用的偏移
+typedef struct {
+    int dx, dy, key;
+} StencilOffset;
+
+// 按距离键值、行、列的顺序比较两个偏移
+static int compareOffsets(const void* a, const void* b) {
+    const StencilOffset* p = (const StencilOffset*)a;
+    const StencilOffset* q = (const StencilOffset*)b;
+    if (p->key != q->key) return p->key < q->key ? -1 : 1;
+    if (p->dy != q->dy) return p->dy < q->dy ? -1 : 1;
+    return (p->dx > q->dx) - (p->dx < q->dx);
+}
+
+// 建立模板
+int initRangeStencil(RangeStencil* stencil, int radius, DistanceMode mode) {
+    stencil->radius = radius;
+    stencil->maxSquared = squaredAttackRadiusForMode(radius, mode);
+    stencil->count = 0;
+    stencil->dx = NULL;
+    stencil->dy = NULL;
+    stencil->keys = NULL;
+    stencil->halfWidths = NULL;
+    if (radius < 0) {
+        return 0;
+    }
+
+    // 两种规则下范围内的格子都不超出中心周围radius格（取整规则的最大平方距离为(radius+1)²-1）
+    int extent = radius;
+    int side = 2 * extent + 1;
+    StencilOffset* offsets = (StencilOffset*)malloc((size_t)side * side * sizeof(StencilOffset));
+    stencil->halfWidths = (int*)malloc((size_t)side * sizeof(int));
+    if (!offsets || !stencil->halfWidths) {
+        free(offsets);
+        freeRangeStencil(stencil);
+        return 0;
+    }
+
+    int count = 0;
+    for (int dy = -extent; dy <= extent; dy++) {
+        int rest = stencil->maxSquared - dy * dy;
+        int halfWidth = integerSqrt(rest);
+        stencil->halfWidths[dy + extent] = halfWidth;
+        for (int dx = -halfWidth; dx <= halfWidth; dx++) {
+            offsets[count].dx = dx;
+            offsets[count].dy = dy;
+            offsets[count].key = distanceKeyForMode(dx * dx + dy * dy, mode);
+            count++;
+        }
+    }
+    qsort(offsets, (size_t)count, sizeof(StencilOffset), compareOffsets);
+
+    stencil->dx = (int*)malloc((size_t)count * 3 * sizeof(int));
+    if (!stencil->dx) {
+        free(offsets);
+        freeRangeStencil(stencil);
+        return 0;
+    }
+    stencil->dy = stencil->dx + count;
+    stencil->keys = stencil->dy + count;
+    for (int i = 0; i < count; i++) {
+        stencil->dx[i] = offsets[i].dx;
+        stencil->dy[i] = offsets[i].dy;
+        stencil->keys[i] = offsets[i].key;
+    }
+    stencil->count = count;
+    free(offsets);
+    return 1;
+}
+
+// 释放模板
+void freeRangeStencil(RangeStencil* stencil) {
+    free(stencil->dx);
+    free(stencil->halfWidths);
+    stencil->dx = NULL;
+    stencil->dy = NULL;
+    stencil->keys = NULL;
+    stencil->halfWidths = NULL;
+    stencil->count = 0;
+}
+
+// 为装备目录中的各半径建立模板
+int buildRangeStencils(void) {
+    freeRangeStencils();
+    for (int i = 0; i < g_equipmentTypesCount; i++) {
+        int radius = g_equipmentTypes[i].maxAttackRadius;
+        if (radius < 0 || radius > RANGE_STENCIL_MAX_RADIUS || g_rangeStencils[DISTANCE_EXACT][radius].count > 0) {
+            continue;
+        }
+        if (!initRangeStencil(&g_rangeStencils[DISTANCE_EXACT][radius], radius, DISTANCE_EXACT) ||
+            !initRangeStencil(&g_rangeStencils[DISTANCE_TRUNCATED][radius], radius, DISTANCE_TRUNCATED)) {
+            freeRangeStencils();
+            return 0;
+        }
+    }
+    return 1;
+}
+
+// 释放所有模板
+void freeRangeStencils(void) {
+    for (int mode = 0; mode < 2; mode++) {
+        for (int radius = 0; radius <= RANGE_STENCIL_MAX_RADIUS; radius++) {
+            freeRangeStencil(&g_rangeStencils[mode][radius]);
+        }
+    }
+}
+
+// 获取当前距离规则下的模板
+const RangeStencil* getRangeStencil(int radius) {
+    if (radius < 0 || radius > RANGE_STENCIL_MAX_RADIUS) {
+        return NULL;
+    }
+    const RangeStencil* stencil = &g_rangeStencils[g_distanceMode][radius];
+    return stencil->count > 0 ? stencil : NULL;
+}
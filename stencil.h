@@ -0,0 +1,40 @@
+#ifndef STENCIL_H
+#define STENCIL_H
+
+#include "distance.h"
+
+// 攻击范围模板
+// 一个半径的攻击范围（圆盘）内全部格子相对中心的偏移，按距离由近到远排列，同时记录每一行的范围。
+// 加载装备类型时为装备目录中每种不同的最大打击半径按两种距离规则各建立一份，之后只读，所有线程共享：
+// 目标搜索沿模板由近到远逐格查找，攻击范围显示按行绘制
+
+// 建立模板的最大半径，更大的半径没有模板（调用者改用其他方法）
+#define RANGE_STENCIL_MAX_RADIUS 64
+
+typedef struct {
+    int radius;
+    int maxSquared;         // 范围内的最大平方距离（与squaredAttackRadius相同）
+    int count;              // 范围内的格子数（包括中心）
+    int* dx;                // 第i个格子相对中心的偏移，按距离键值递增，键值相同时按行、列递增
+    int* dy;
+    int* keys;              // 第i个格子的距离键值
+    int* halfWidths;        // 每行的半宽：第dy行的范围为|dx| <= halfWidths[dy + radius]
+} RangeStencil;
+
+// 按规则mode建立半径为radius的模板，成功返回1，半径为负或内存分配失败时返回0
+int initRangeStencil(RangeStencil* stencil, int radius, DistanceMode mode);
+
+// 释放模板
+void freeRangeStencil(RangeStencil* stencil);
+
+// 为当前装备目录中每种不同的最大打击半径建立模板（加载装备类型时调用，替换之前的模板）
+// 成功返回1，内存分配失败返回0
+int buildRangeStencils(void);
+
+// 释放所有模板
+void freeRangeStencils(void);
+
+// 获取当前距离规则下半径为radius的模板，装备目录中没有这个半径或半径超过RANGE_STENCIL_MAX_RADIUS时返回NULL
+const RangeStencil* getRangeStencil(int radius);
+
+#endif // STENCIL_H
@@ -0,0 +1,108 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "equipment.h"
+#include "paramsweep.h"
+#include "platform.h"
+
+// 参数扫描模式
+// 读取扫描说明文件，展开为全部扫描点，每个扫描点运行一批完整的战斗，输出结果表
+
+#define DEFAULT_RESULTS_FILE "sweep_results.csv"
+
+// 获取当前时间（秒）
+static double getTimeSeconds(void) {
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// 显示用法说明
+static void printUsage(const char* program) {
+    printf("用法: %s <扫描说明文件> [选项]\n", program);
+    printf("扫描说明文件格式见 paramsweep.h，示例见 sweep_sample.txt\n");
+    printf("选项:\n");
+    printf("  --threads N     工作线程数 (默认使用全部 %d 个CPU核心)\n", platformGetCpuCount());
+    printf("  --output F      结果表文件 (CSV格式，默认 %s，- 表示输出到屏幕)\n", DEFAULT_RESULTS_FILE);
+    printf("  --types F       装备类型文件 (默认 equipment_types.txt)\n");
+    printf("  --interactions F 装备交互文件 (默认 equipment_interactions.txt)\n");
+}
+
+int main(int argc, char* argv[]) {
+    const char* sweepFile = NULL;
+    const char* outputFile = DEFAULT_RESULTS_FILE;
+    const char* typesFile = "equipment_types.txt";
+    const char* interactionsFile = "equipment_interactions.txt";
+    int threads = 0;
+
+    // 解析命令行参数
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            threads = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--output") == 0 && i + 1 < argc) {
+            outputFile = argv[++i];
+        } else if (strcmp(argv[i], "--types") == 0 && i + 1 < argc) {
+            typesFile = argv[++i];
+        } else if (strcmp(argv[i], "--interactions") == 0 && i + 1 < argc) {
+            interactionsFile = argv[++i];
+        } else if (argv[i][0] == '-' || sweepFile) {
+            printUsage(argv[0]);
+            return 1;
+        } else {
+            sweepFile = argv[i];
+        }
+    }
+
+    if (!sweepFile) {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    // 装备数据只加载一次，所有线程共享（扫描的造价在各线程自己的造价表中修改）
+    if (!loadEquipmentTypes(typesFile) || !loadEquipmentInteractions(interactionsFile)) {
+        freeEquipmentTypes();
+        return 1;
+    }
+
+    // 想定文件必须在装备数据之后加载，cost参数要检查装备类型是否存在
+    Sweep sweep;
+    if (!loadDefaultBattlefieldConfig() || !parseSweep(&sweep, sweepFile)) {
+        freeEquipmentTypes();
+        return 1;
+    }
+
+    printf("扫描点: %d，每点 %d 场，共 %lld 场战斗\n", sweep.pointCount, sweep.battles,
+           (long long)sweep.pointCount * sweep.battles);
+
+    JobStats stats;
+    double startTime = getTimeSeconds();
+    if (!runSweep(&sweep, threads, &stats)) {
+        printf("内存分配失败\n");
+        freeSweep(&sweep);
+        freeEquipmentTypes();
+        return 1;
+    }
+    double elapsed = getTimeSeconds() - startTime;
+
+    FILE* output = strcmp(outputFile, "-") == 0 ? stdout : fopen(outputFile, "w");
+    if (!output) {
+        printf("无法写入结果表: %s\n", outputFile);
+        freeSweep(&sweep);
+        freeEquipmentTypes();
+        return 1;
+    }
+    writeSweepResults(&sweep, output);
+    if (output != stdout) {
+        fclose(output);
+        printf("结果表: %s\n", outputFile);
+    }
+
+    long long battles = (long long)sweep.pointCount * sweep.battles;
+    printf("耗时: %.3f 秒 (%.1f 场/秒，窃取 %lld 次共 %lld 场)\n", elapsed, elapsed > 0 ? battles / elapsed : 0.0,
+           stats.steals, stats.stolenJobs);
+
+    freeSweep(&sweep);
+    freeEquipmentTypes();
+    return 0;
+}
@@ -0,0 +1,135 @@
+#include "threadpool.h"
+#include <stdlib.h>
+#include "platform.h"
+
+// 领取并处理下标块，直到本次任务的下标全部被领取
+static void runChunks(ThreadPool* pool) {
+    while (1) {
+        int begin = atomic_fetch_add(&pool->next, pool->chunk);
+        if (begin >= pool->count) {
+            break;
+        }
+        int end = begin + pool->chunk;
+        if (end > pool->count) {
+            end = pool->count;
+        }
+        pool->task(pool->context, begin, end);
+    }
+}
+
+// 工作线程：等待新任务，处理完后通知调用者
+static void* threadPoolWorkerMain(void* arg) {
+    ThreadPool* pool = (ThreadPool*)arg;
+    unsigned seen = 0;
+
+    pthread_mutex_lock(&pool->mutex);
+    while (1) {
+        while (pool->generation == seen && !pool->stopping) {
+            pthread_cond_wait(&pool->startCond, &pool->mutex);
+        }
+        if (pool->stopping) {
+            break;
+        }
+        seen = pool->generation;
+        pthread_mutex_unlock(&pool->mutex);
+
+        runChunks(pool);
+
+        pthread_mutex_lock(&pool->mutex);
+        if (--pool->pending == 0) {
+            pthread_cond_signal(&pool->doneCond);
+        }
+    }
+    pthread_mutex_unlock(&pool->mutex);
+    return NULL;
+}
+
+// 创建线程池
+int initThreadPool(ThreadPool* pool, int threads) {
+    if (threads <= 0) {
+        threads = platformGetCpuCount();
+    }
+
+    pool->threadCount = 1;
+    pool->generation = 0;
+    pool->pending = 0;
+    pool->stopping = 0;
+    pool->task = NULL;
+    pool->context = NULL;
+    pool->count = 0;
+    pool->chunk = 1;
+    atomic_init(&pool->next, 0);
+    pool->threads = (pthread_t*)malloc((threads > 1 ? threads - 1 : 1) * sizeof(pthread_t));
+    if (!pool->threads) {
+        return 0;
+    }
+    pthread_mutex_init(&pool->mutex, NULL);
+    pthread_cond_init(&pool->startCond, NULL);
+    pthread_cond_init(&pool->doneCond, NULL);
+
+    // 调用者线程算作第一个线程；创建失败时停在已启动的线程数
+    for (int i = 0; i < threads - 1; i++) {
+        if (pthread_create(&pool->threads[i], NULL, threadPoolWorkerMain, pool) != 0) {
+            break;
+        }
+        pool->threadCount++;
+    }
+    return 1;
+}
+
+// 停止并回收所有工作线程
+void freeThreadPool(ThreadPool* pool) {
+    if (!pool->threads) {
+        return;
+    }
+
+    pthread_mutex_lock(&pool->mutex);
+    pool->stopping = 1;
+    pthread_cond_broadcast(&pool->startCond);
+    pthread_mutex_unlock(&pool->mutex);
+
+    for (int i = 0; i < pool->threadCount - 1; i++) {
+        pthread_join(pool->threads[i], NULL);
+    }
+    pthread_cond_destroy(&pool->doneCond);
+    pthread_cond_destroy(&pool->startCond);
+    pthread_mutex_destroy(&pool->mutex);
+    free(pool->threads);
+    pool->threads = NULL;
+    pool->threadCount = 1;
+}
+
+// 在线程池上处理下标[0, count)
+void threadPoolRun(ThreadPool* pool, ThreadPoolTask task, void* context, int count, int chunk) {
+    if (chunk < 1) {
+        chunk = 1;
+    }
+
+    // 只有一个线程或者任务不够分时直接在调用者线程中完成，省去唤醒的开销
+    if (pool->threadCount <= 1 || count <= chunk) {
+        if (count > 0) {
+            task(context, 0, count);
+        }
+        return;
+    }
+
+    pthread_mutex_lock(&pool->mutex);
+    pool->task = task;
+    pool->context = context;
+    pool->count = count;
+    pool->chunk = chunk;
+    atomic_store(&pool->next, 0);
+    pool->pending = pool->threadCount - 1;
+    pool->generation++;
+    pthread_cond_broadcast(&pool->startCond);
+    pthread_mutex_unlock(&pool->mutex);
+
+    runChunks(pool);
+
+    // 等待工作线程处理完已领取的块
+    pthread_mutex_lock(&pool->mutex);
+    while (pool->pending > 0) {
+        pthread_cond_wait(&pool->doneCond, &pool->mutex);
+    }
+    pthread_mutex_unlock(&pool->mutex);
+}
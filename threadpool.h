@@ -0,0 +1,40 @@
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <pthread.h>
+#include <stdatomic.h>
+
+// 并行任务：处理下标范围[begin, end)
+typedef void (*ThreadPoolTask)(void* context, int begin, int end);
+
+// 常驻的工作线程池
+// 用于把一步模拟中互不依赖的计算分给多个线程：每次运行时调用者线程也参与计算，
+// 工作线程从共享计数器按块领取下标，全部完成后才返回。线程在两次运行之间等待，不反复创建
+typedef struct {
+    int threadCount;            // 参与计算的线程总数（包括调用者线程）
+    pthread_t* threads;         // 工作线程（threadCount-1个）
+    pthread_mutex_t mutex;
+    pthread_cond_t startCond;   // 有新任务或要求退出
+    pthread_cond_t doneCond;    // 工作线程都已完成本次任务
+    unsigned generation;        // 任务编号，每次运行加1
+    int pending;                // 尚未完成本次任务的工作线程数
+    int stopping;               // 要求工作线程退出
+    ThreadPoolTask task;        // 本次任务
+    void* context;
+    int count;                  // 下标总数
+    int chunk;                  // 每次领取的下标数
+    atomic_int next;            // 下一个未领取的下标
+} ThreadPool;
+
+// 创建线程池，threads为线程总数（<=0表示使用全部CPU核心）
+// 成功返回1；内存分配失败返回0；部分线程创建失败时按实际启动的线程数工作
+int initThreadPool(ThreadPool* pool, int threads);
+
+// 停止并回收所有工作线程
+void freeThreadPool(ThreadPool* pool);
+
+// 在线程池上处理下标[0, count)，每次领取chunk个，全部完成后返回
+// 每个下标恰好被处理一次，任务只应写入自己下标对应的结果，结果与线程数无关
+void threadPoolRun(ThreadPool* pool, ThreadPoolTask task, void* context, int count, int chunk);
+
+#endif // THREADPOOL_H
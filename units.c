@@ -0,0 +1,148 @@
+#include "units.h"
+
+// 初始化单元存储
+int initUnitStore(UnitStore* store, int capacity, Arena* arena) {
+    store->count = 0;
+    store->aliveCount = 0;
+    store->capacity = 0;
+    store->x = NULL;
+    store->y = NULL;
+    store->dirX = NULL;
+    store->dirY = NULL;
+    store->health = NULL;
+    store->ammo = NULL;
+    store->typeId = NULL;
+    store->alive = NULL;
+    store->views = NULL;
+    store->active = NULL;
+    store->activeCount = 0;
+    store->arena = arena;
+    return reserveUnits(store, capacity > 0 ? capacity : 1);
+}
+
+// 把一个数组扩大到newCapacity个元素
+static int growArray(Arena* arena, void** array, size_t elementSize, int oldCapacity, int newCapacity) {
+    void* grown = arenaGrow(arena, *array, (size_t)oldCapacity * elementSize, (size_t)newCapacity * elementSize);
+    if (!grown) {
+        return 0;
+    }
+    *array = grown;
+    return 1;
+}
+
+// 保证容量不少于capacity
+int reserveUnits(UnitStore* store, int capacity) {
+    if (capacity <= store->capacity) {
+        return 1;
+    }
+
+    // 各数组依次扩大，全部成功后才更新容量；中途失败时已扩大的数组仍然有效
+    Arena* arena = store->arena;
+    int old = store->capacity;
+    if (!growArray(arena, (void**)&store->x, sizeof(int), old, capacity) ||
+        !growArray(arena, (void**)&store->y, sizeof(int), old, capacity) ||
+        !growArray(arena, (void**)&store->dirX, sizeof(signed char), old, capacity) ||
+        !growArray(arena, (void**)&store->dirY, sizeof(signed char), old, capacity) ||
+        !growArray(arena, (void**)&store->health, sizeof(int), old, capacity) ||
+        !growArray(arena, (void**)&store->ammo, sizeof(int), old, capacity) ||
+        !growArray(arena, (void**)&store->typeId, sizeof(int), old, capacity) ||
+        !growArray(arena, (void**)&store->alive, sizeof(unsigned char), old, capacity) ||
+        !growArray(arena, (void**)&store->views, sizeof(Equipment), old, capacity) ||
+        !growArray(arena, (void**)&store->active, sizeof(int), old, capacity)) {
+        return 0;
+    }
+    store->capacity = capacity;
+    return 1;
+}
+
+// 追加一个单元
+int appendUnit(UnitStore* store, const Equipment* equipment) {
+    if (store->count >= store->capacity && !reserveUnits(store, store->capacity * 2)) {
+        return -1;
+    }
+
+    int index = store->count++;
+    store->x[index] = equipment->x;
+    store->y[index] = equipment->y;
+    store->dirX[index] = (signed char)equipment->directionX;
+    store->dirY[index] = (signed char)equipment->directionY;
+    store->health[index] = equipment->currentHealth;
+    store->ammo[index] = equipment->currentAmmo;
+    store->typeId[index] = equipment->typeId;
+    store->alive[index] = (unsigned char)(equipment->isActive != 0);
+    store->views[index] = *equipment;
+    if (store->alive[index]) {
+        store->aliveCount++;
+        store->active[store->activeCount++] = index;
+    }
+    return index;
+}
+
+// 撤销最后一次追加
+void removeLastUnit(UnitStore* store) {
+    int index = --store->count;
+    if (store->alive[index]) {
+        store->alive[index] = 0;
+        store->aliveCount--;
+        store->activeCount--;
+    }
+}
+
+// 整理存活列表
+void compactActiveUnits(UnitStore* store) {
+    if (store->activeCount == store->aliveCount) {
+        return;
+    }
+
+    int kept = 0;
+    for (int k = 0; k < store->activeCount; k++) {
+        int index = store->active[k];
+        if (store->alive[index]) {
+            store->active[kept++] = index;
+        } else {
+            syncUnitView(store, index);
+        }
+    }
+    store->activeCount = kept;
+}
+
+// 重建存活列表
+void rebuildActiveUnits(UnitStore* store) {
+    int kept = 0;
+    for (int i = 0; i < store->count; i++) {
+        if (store->alive[i]) {
+            store->active[kept++] = i;
+        } else {
+            syncUnitView(store, i);
+        }
+    }
+    store->activeCount = kept;
+    store->aliveCount = kept;
+}
+
+// 用结构数组中的数据刷新一个单元的Equipment视图
+void syncUnitView(UnitStore* store, int index) {
+    Equipment* view = &store->views[index];
+    view->x = store->x[index];
+    view->y = store->y[index];
+    view->directionX = store->dirX[index];
+    view->directionY = store->dirY[index];
+    view->currentHealth = store->health[index];
+    view->currentAmmo = store->ammo[index];
+    view->isActive = store->alive[index];
+}
+
+// 刷新存活列表中所有单元的Equipment视图
+void syncUnitViews(UnitStore* store) {
+    for (int k = 0; k < store->activeCount; k++) {
+        syncUnitView(store, store->active[k]);
+    }
+}
+
+// 获取Equipment视图对应的单元下标
+int findUnitIndex(const UnitStore* store, const Equipment* equipment) {
+    if (!equipment || equipment < store->views || equipment >= store->views + store->count) {
+        return -1;
+    }
+    return (int)(equipment - store->views);
+}
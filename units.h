@@ -0,0 +1,70 @@
+#ifndef UNITS_H
+#define UNITS_H
+
+#include "equipment.h"
+#include "arena.h"
+
+// 单方装备的结构数组(SoA)存储
+// 模拟循环中频繁访问的字段（位置、方向、生命值、弹药、类型、存活标志）
+// 分别存放在连续数组中，按下标顺序线性访问；
+// views数组为每个单元保留一个Equipment视图，供菜单和渲染等按Equipment*访问的代码使用，
+// 视图中的热数据只在调用syncUnitView/syncUnitViews后才是最新的
+// 数组容量不够时按倍数从内存池中扩大（旧数组直到内存池重置前不会被复用），
+// 因此扩容后之前取得的数组指针和Equipment*都会失效
+typedef struct {
+    int count;              // 单元数量（包括已摧毁的）
+    int capacity;           // 数组容量
+    int* x;                 // 横坐标
+    int* y;                 // 纵坐标
+    signed char* dirX;      // 横向移动方向 (-1/0/1)
+    signed char* dirY;      // 纵向移动方向 (-1/0/1)
+    int* health;            // 当前生命值
+    int* ammo;              // 当前弹药量
+    int* typeId;            // 装备类型ID
+    unsigned char* alive;   // 是否存活 (1表示活跃，0表示已被摧毁)
+    int aliveCount;         // 存活的单元数，随alive标志一起维护（胜负检查不必逐个统计）
+    int* active;            // 存活单元的下标，按下标递增排列；单元被摧毁时不立即移除，
+                            // 由compactActiveUnits统一整理，因此可能含有上次整理之后被摧毁的单元
+    int activeCount;        // active中的下标数
+    Equipment* views;       // Equipment视图（包含ID、名称等冷数据）
+    Arena* arena;           // 数组所在的内存池
+} UnitStore;
+
+// 初始化单元存储，capacity为初始容量，数组从内存池中分配，随内存池一起释放
+// 成功返回1，内存分配失败返回0
+int initUnitStore(UnitStore* store, int capacity, Arena* arena);
+
+// 保证容量不少于capacity，成功返回1，内存分配失败返回0
+int reserveUnits(UnitStore* store, int capacity);
+
+// 追加一个单元（容量不够时自动扩大），返回其下标，内存分配失败时返回-1
+int appendUnit(UnitStore* store, const Equipment* equipment);
+
+// 撤销最后一次appendUnit（追加之后的其他步骤失败时调用），下标和存活计数恢复原样
+void removeLastUnit(UnitStore* store);
+
+// 把单元标记为已摧毁（已摧毁的单元不变），alive标志只应通过它清除，以保持aliveCount正确
+static inline void markUnitDestroyed(UnitStore* store, int index) {
+    if (store->alive[index]) {
+        store->alive[index] = 0;
+        store->aliveCount--;
+    }
+}
+
+// 从存活列表中移除已摧毁的单元，其余单元的先后顺序不变
+// 被移除的单元最后刷新一次Equipment视图，之后它们的数据不再变化，syncUnitViews也不再处理它们
+void compactActiveUnits(UnitStore* store);
+
+// 按alive标志重建存活列表和存活单元数，并刷新已摧毁单元的Equipment视图（整体复制各数组后调用）
+void rebuildActiveUnits(UnitStore* store);
+
+// 用结构数组中的数据刷新一个单元的Equipment视图
+void syncUnitView(UnitStore* store, int index);
+
+// 刷新存活列表中所有单元的Equipment视图（已移出列表的单元的视图已是最终状态）
+void syncUnitViews(UnitStore* store);
+
+// 获取Equipment视图对应的单元下标，不属于该存储时返回-1
+int findUnitIndex(const UnitStore* store, const Equipment* equipment);
+
+#endif // UNITS_H